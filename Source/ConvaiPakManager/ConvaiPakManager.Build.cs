@@ -17,7 +17,7 @@ public class ConvaiPakManager : ModuleRules
 		PrivateDependencyModuleNames.AddRange(
 			new string[]
 			{
-				"CoreUObject", "Engine", "Slate", "SlateCore", "Json", "JsonUtilities", "Projects" }
+				"CoreUObject", "Engine", "Slate", "SlateCore", "Json", "JsonUtilities", "Projects", "HTTP" }
 			);
 			
 		
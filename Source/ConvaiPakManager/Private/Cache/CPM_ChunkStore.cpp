@@ -0,0 +1,588 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Cache/CPM_ChunkStore.h"
+#include "Utility/CPM_FileHash.h"
+#include "Utility/CPM_UtilityLibrary.h"
+#include "Algo/AllOf.h"
+#include "Async/ParallelFor.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Guid.h"
+#include "Misc/Paths.h"
+#include "Misc/SecureHash.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/JsonSerializer.h"
+#include <atomic>
+
+namespace
+{
+	/**
+	 * Gear table of the rolling hash. It is part of the chunk format: changing it moves every
+	 * boundary, so it is generated from a fixed seed instead of anything platform dependent.
+	 */
+	const uint64* GetGearTable()
+	{
+		static const TStaticArray<uint64, 256> Table = []()
+		{
+			TStaticArray<uint64, 256> Result;
+			uint64 State = 0x2545F4914F6CDD1Dull;
+			for (int32 Index = 0; Index < 256; ++Index)
+			{
+				// splitmix64
+				uint64 Value = (State += 0x9E3779B97F4A7C15ull);
+				Value = (Value ^ (Value >> 30)) * 0xBF58476D1CE4E5B9ull;
+				Value = (Value ^ (Value >> 27)) * 0x94D049BB133111EBull;
+				Result[Index] = Value ^ (Value >> 31);
+			}
+			return Result;
+		}();
+		return Table.GetData();
+	}
+
+	/** The top bits of the hash depend on the most recent 64 bytes, boundaries test those */
+	uint64 TopBitsMask(const int32 NumBits)
+	{
+		return NumBits >= 64 ? ~0ull : ~0ull << (64 - FMath::Max(NumBits, 1));
+	}
+
+	FString SHA1Hex(const uint8* Data, const int64 Size)
+	{
+		FSHAHash Hash;
+		FSHA1::HashBuffer(Data, Size, Hash.Hash);
+		return FCPM_FileHash::ToHex(Hash);
+	}
+
+	FString GetSnapshotsDirectory()
+	{
+		return FPaths::Combine(FCPM_ChunkStore::GetStoreDirectory(), TEXT("Snapshots"));
+	}
+
+	constexpr int32 SnapshotFormatVersion = 1;
+}
+
+int64 FCPM_Snapshot::GetTotalBytes() const
+{
+	int64 TotalBytes = 0;
+	for (const FCPM_SnapshotFile& File : Files)
+	{
+		TotalBytes += File.Size;
+	}
+	return TotalBytes;
+}
+
+TArray<FString> FCPM_Snapshot::GetUniqueChunks() const
+{
+	TSet<FString> Seen;
+	TArray<FString> Result;
+	for (const FCPM_SnapshotFile& File : Files)
+	{
+		for (const FCPM_SnapshotChunk& Chunk : File.Chunks)
+		{
+			bool bAlreadySeen = false;
+			Seen.Add(Chunk.Hash, &bAlreadySeen);
+			if (!bAlreadySeen)
+			{
+				Result.Add(Chunk.Hash);
+			}
+		}
+	}
+	return Result;
+}
+
+FString FCPM_ChunkStore::GetStoreDirectory()
+{
+	return FPaths::Combine(UCPM_UtilityLibrary::CPM_GetCacheDirectory(), TEXT("ChunkStore"));
+}
+
+FString FCPM_ChunkStore::GetChunkPath(const FString& Hash)
+{
+	return FPaths::Combine(GetStoreDirectory(), TEXT("Chunks"), Hash.Left(2), Hash);
+}
+
+bool FCPM_ChunkStore::HasChunk(const FString& Hash)
+{
+	return FPlatformFileManager::Get().GetPlatformFile().FileExists(*GetChunkPath(Hash));
+}
+
+int32 FCPM_ChunkStore::FindChunkBoundary(const uint8* Data, const int32 Size, const FChunkingParams& Params)
+{
+	if (Size <= Params.MinSize)
+	{
+		return Size;
+	}
+
+	// Normalized chunking: a harder test before the average size and an easier one after it keeps
+	// chunk sizes close to the average
+	const int32 AverageBits = FMath::FloorLog2(FMath::Max(Params.AverageSize, 2));
+	const uint64 MaskBeforeAverage = TopBitsMask(AverageBits + 2);
+	const uint64 MaskAfterAverage = TopBitsMask(AverageBits - 2);
+	const uint64* Gear = GetGearTable();
+
+	const int32 Limit = FMath::Min(Size, Params.MaxSize);
+	const int32 Barrier = FMath::Min(Limit, Params.AverageSize);
+
+	// The first MinSize bytes can never end a chunk, they are not even hashed
+	uint64 Hash = 0;
+	int32 Index = Params.MinSize;
+	for (; Index < Barrier; ++Index)
+	{
+		Hash = (Hash << 1) + Gear[Data[Index]];
+		if (!(Hash & MaskBeforeAverage))
+		{
+			return Index + 1;
+		}
+	}
+	for (; Index < Limit; ++Index)
+	{
+		Hash = (Hash << 1) + Gear[Data[Index]];
+		if (!(Hash & MaskAfterAverage))
+		{
+			return Index + 1;
+		}
+	}
+	return Limit;
+}
+
+bool FCPM_ChunkStore::StoreChunk(const FString& Hash, const uint8* Data, const int64 Size)
+{
+	const FString ChunkPath = GetChunkPath(Hash);
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	if (PlatformFile.FileExists(*ChunkPath))
+	{
+		return true;
+	}
+
+	// Written under a unique name and moved in place, so a reader never sees half a chunk and
+	// two threads storing the same chunk do not collide
+	const FString TempPath = ChunkPath + TEXT(".") + FGuid::NewGuid().ToString() + TEXT(".tmp");
+	PlatformFile.CreateDirectoryTree(*FPaths::GetPath(ChunkPath));
+	{
+		const TUniquePtr<IFileHandle> Handle(PlatformFile.OpenWrite(*TempPath));
+		if (!Handle.IsValid() || !Handle->Write(Data, Size))
+		{
+			UCPM_UtilityLibrary::CPM_LogMessage(FString::Printf(TEXT("Failed to write chunk %s"), *Hash), ECPM_LogLevel::Error);
+			PlatformFile.DeleteFile(*TempPath);
+			return false;
+		}
+	}
+
+	if (!PlatformFile.MoveFile(*ChunkPath, *TempPath))
+	{
+		PlatformFile.DeleteFile(*TempPath);
+		return PlatformFile.FileExists(*ChunkPath);
+	}
+	return true;
+}
+
+bool FCPM_ChunkStore::ChunkFile(const FCPM_WalkedFile& File, const FChunkingParams& Params, FCPM_SnapshotFile& OutFile, int32& OutNumNewChunks, int64& OutNewBytes)
+{
+	const TUniquePtr<IFileHandle> Source(FPlatformFileManager::Get().GetPlatformFile().OpenRead(*File.Path));
+	if (!Source.IsValid())
+	{
+		UCPM_UtilityLibrary::CPM_LogMessage(FString::Printf(TEXT("Failed to read file: %s"), *File.Path), ECPM_LogLevel::Error);
+		return false;
+	}
+
+	// Room for several maximum size chunks, a boundary is only searched once a full MaxSize window is buffered
+	TArray<uint8> Buffer;
+	Buffer.SetNumUninitialized(Params.MaxSize * 4);
+	int64 NumBuffered = 0;
+	int64 Remaining = Source->Size();
+
+	while (true)
+	{
+		const int64 ToRead = FMath::Min<int64>(Buffer.Num() - NumBuffered, Remaining);
+		if (ToRead > 0)
+		{
+			if (!Source->Read(Buffer.GetData() + NumBuffered, ToRead))
+			{
+				UCPM_UtilityLibrary::CPM_LogMessage(FString::Printf(TEXT("Failed to read file: %s"), *File.Path), ECPM_LogLevel::Error);
+				return false;
+			}
+			NumBuffered += ToRead;
+			Remaining -= ToRead;
+		}
+		if (NumBuffered == 0)
+		{
+			break;
+		}
+
+		int64 Offset = 0;
+		while (Offset < NumBuffered && (Remaining == 0 || NumBuffered - Offset >= Params.MaxSize))
+		{
+			const int32 Window = static_cast<int32>(FMath::Min<int64>(NumBuffered - Offset, Params.MaxSize));
+			const int32 ChunkSize = FindChunkBoundary(Buffer.GetData() + Offset, Window, Params);
+
+			FCPM_SnapshotChunk& Chunk = OutFile.Chunks.AddDefaulted_GetRef();
+			Chunk.Hash = SHA1Hex(Buffer.GetData() + Offset, ChunkSize);
+			Chunk.Size = ChunkSize;
+
+			if (!HasChunk(Chunk.Hash))
+			{
+				if (!StoreChunk(Chunk.Hash, Buffer.GetData() + Offset, ChunkSize))
+				{
+					return false;
+				}
+				++OutNumNewChunks;
+				OutNewBytes += ChunkSize;
+			}
+			Offset += ChunkSize;
+		}
+
+		FMemory::Memmove(Buffer.GetData(), Buffer.GetData() + Offset, NumBuffered - Offset);
+		NumBuffered -= Offset;
+	}
+	return true;
+}
+
+bool FCPM_ChunkStore::CreateSnapshot(const TArray<FCPM_WalkedFile>& Files, const FString& RootDirectory, FCPM_Snapshot& OutSnapshot,
+	const FCPM_Snapshot* Previous, FCPM_SnapshotStats* OutStats, const FChunkingParams& Params, const FOnSnapshotProgress& OnProgress)
+{
+	const double StartTime = FPlatformTime::Seconds();
+	FString Root = FPaths::ConvertRelativePathToFull(RootDirectory);
+	FPaths::NormalizeDirectoryName(Root);
+
+	TMap<FString, const FCPM_SnapshotFile*> PreviousFiles;
+	if (Previous)
+	{
+		for (const FCPM_SnapshotFile& File : Previous->Files)
+		{
+			PreviousFiles.Add(File.Path, &File);
+		}
+	}
+
+	OutSnapshot = FCPM_Snapshot();
+	OutSnapshot.CreatedAt = FDateTime::UtcNow();
+	OutSnapshot.Files.SetNum(Files.Num());
+
+	TArray<int32> NumNewChunks;
+	TArray<int64> NewBytes;
+	TArray<bool> Reused;
+	TArray<bool> Succeeded;
+	NumNewChunks.SetNumZeroed(Files.Num());
+	NewBytes.SetNumZeroed(Files.Num());
+	Reused.SetNumZeroed(Files.Num());
+	Succeeded.SetNumZeroed(Files.Num());
+
+	std::atomic<int32> FilesProcessed { 0 };
+	std::atomic<int64> BytesProcessed { 0 };
+	auto ReportProgress = [&](const int64 FileSize)
+	{
+		const int32 NumFiles = ++FilesProcessed;
+		const int64 NumBytes = BytesProcessed += FileSize;
+		if (OnProgress)
+		{
+			OnProgress(NumFiles, NumBytes);
+		}
+	};
+
+	// The first snapshot reads the whole project, background priority keeps the workers free for the editor
+	ParallelFor(Files.Num(), [&](const int32 Index)
+	{
+		const FCPM_WalkedFile& File = Files[Index];
+		FCPM_SnapshotFile& SnapshotFile = OutSnapshot.Files[Index];
+
+		SnapshotFile.Path = File.Path;
+		FPaths::MakePathRelativeTo(SnapshotFile.Path, *(Root + TEXT("/")));
+		SnapshotFile.Size = File.Size;
+		SnapshotFile.Timestamp = File.Timestamp;
+
+		if (const FCPM_SnapshotFile* const* PreviousFile = PreviousFiles.Find(SnapshotFile.Path))
+		{
+			if ((*PreviousFile)->Size == File.Size && (*PreviousFile)->Timestamp == File.Timestamp
+				&& Algo::AllOf((*PreviousFile)->Chunks, [](const FCPM_SnapshotChunk& Chunk) { return HasChunk(Chunk.Hash); }))
+			{
+				SnapshotFile.Chunks = (*PreviousFile)->Chunks;
+				Reused[Index] = true;
+				Succeeded[Index] = true;
+				ReportProgress(File.Size);
+				return;
+			}
+		}
+
+		Succeeded[Index] = ChunkFile(File, Params, SnapshotFile, NumNewChunks[Index], NewBytes[Index]);
+		ReportProgress(File.Size);
+	}, EParallelForFlags::Unbalanced | EParallelForFlags::BackgroundPriority);
+
+	FCPM_SnapshotStats Stats;
+	bool bSuccess = true;
+	for (int32 Index = 0; Index < Files.Num(); ++Index)
+	{
+		bSuccess &= Succeeded[Index];
+		Stats.NumReusedFiles += Reused[Index] ? 1 : 0;
+		Stats.NumNewChunks += NumNewChunks[Index];
+		Stats.NewBytes += NewBytes[Index];
+		Stats.NumChunks += OutSnapshot.Files[Index].Chunks.Num();
+	}
+	Stats.NumFiles = Files.Num();
+	Stats.TotalBytes = OutSnapshot.GetTotalBytes();
+	Stats.Seconds = FPlatformTime::Seconds() - StartTime;
+
+	OutSnapshot.Id = OutSnapshot.CreatedAt.ToString(TEXT("%Y%m%d-%H%M%S-")) + FGuid::NewGuid().ToString().Left(8).ToLower();
+
+	UCPM_UtilityLibrary::CPM_LogMessage(FString::Printf(TEXT("Snapshot %s: %d files (%d unchanged), %d chunks, %d new (%.1f of %.1f MB) in %.2fs"),
+		*OutSnapshot.Id, Stats.NumFiles, Stats.NumReusedFiles, Stats.NumChunks, Stats.NumNewChunks,
+		Stats.NewBytes / (1024.0 * 1024.0), Stats.TotalBytes / (1024.0 * 1024.0), Stats.Seconds));
+
+	if (OutStats)
+	{
+		*OutStats = Stats;
+	}
+	return bSuccess;
+}
+
+bool FCPM_ChunkStore::SaveSnapshot(const FCPM_Snapshot& Snapshot)
+{
+	TArray<TSharedPtr<FJsonValue>> FileValues;
+	FileValues.Reserve(Snapshot.Files.Num());
+	for (const FCPM_SnapshotFile& File : Snapshot.Files)
+	{
+		TArray<TSharedPtr<FJsonValue>> ChunkValues;
+		ChunkValues.Reserve(File.Chunks.Num());
+		for (const FCPM_SnapshotChunk& Chunk : File.Chunks)
+		{
+			const TSharedPtr<FJsonObject> ChunkObject = MakeShared<FJsonObject>();
+			ChunkObject->SetStringField(TEXT("hash"), Chunk.Hash);
+			ChunkObject->SetNumberField(TEXT("size"), Chunk.Size);
+			ChunkValues.Add(MakeShared<FJsonValueObject>(ChunkObject));
+		}
+
+		const TSharedPtr<FJsonObject> FileObject = MakeShared<FJsonObject>();
+		FileObject->SetStringField(TEXT("path"), File.Path);
+		FileObject->SetNumberField(TEXT("size"), File.Size);
+		// Ticks do not fit in a double, keep them as a string
+		FileObject->SetStringField(TEXT("mtime"), LexToString(File.Timestamp.GetTicks()));
+		FileObject->SetArrayField(TEXT("chunks"), ChunkValues);
+		FileValues.Add(MakeShared<FJsonValueObject>(FileObject));
+	}
+
+	const TSharedPtr<FJsonObject> Root = MakeShared<FJsonObject>();
+	Root->SetNumberField(TEXT("version"), SnapshotFormatVersion);
+	Root->SetStringField(TEXT("id"), Snapshot.Id);
+	Root->SetStringField(TEXT("created_at"), Snapshot.CreatedAt.ToIso8601());
+	Root->SetArrayField(TEXT("files"), FileValues);
+
+	FString Output;
+	const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Output);
+	const FString SnapshotPath = FPaths::Combine(GetSnapshotsDirectory(), Snapshot.Id + TEXT(".json"));
+	return FJsonSerializer::Serialize(Root.ToSharedRef(), Writer) && FFileHelper::SaveStringToFile(Output, *SnapshotPath);
+}
+
+bool FCPM_ChunkStore::LoadSnapshot(const FString& SnapshotId, FCPM_Snapshot& OutSnapshot)
+{
+	FString Content;
+	if (!FFileHelper::LoadFileToString(Content, *FPaths::Combine(GetSnapshotsDirectory(), SnapshotId + TEXT(".json"))))
+	{
+		return false;
+	}
+
+	TSharedPtr<FJsonObject> Root;
+	const TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(Content);
+	const TArray<TSharedPtr<FJsonValue>>* FileValues = nullptr;
+	if (!FJsonSerializer::Deserialize(Reader, Root) || !Root.IsValid() || !Root->TryGetArrayField(TEXT("files"), FileValues))
+	{
+		UCPM_UtilityLibrary::CPM_LogMessage(FString::Printf(TEXT("Invalid snapshot manifest: %s"), *SnapshotId), ECPM_LogLevel::Error);
+		return false;
+	}
+
+	OutSnapshot = FCPM_Snapshot();
+	OutSnapshot.Id = Root->GetStringField(TEXT("id"));
+	FDateTime::ParseIso8601(*Root->GetStringField(TEXT("created_at")), OutSnapshot.CreatedAt);
+	OutSnapshot.Files.Reserve(FileValues->Num());
+
+	for (const TSharedPtr<FJsonValue>& FileValue : *FileValues)
+	{
+		const TSharedPtr<FJsonObject>& FileObject = FileValue->AsObject();
+		if (!FileObject.IsValid())
+		{
+			return false;
+		}
+
+		FCPM_SnapshotFile& File = OutSnapshot.Files.AddDefaulted_GetRef();
+		File.Path = FileObject->GetStringField(TEXT("path"));
+		File.Size = static_cast<int64>(FileObject->GetNumberField(TEXT("size")));
+		File.Timestamp = FDateTime(FCString::Atoi64(*FileObject->GetStringField(TEXT("mtime"))));
+
+		int64 ChunkBytes = 0;
+		for (const TSharedPtr<FJsonValue>& ChunkValue : FileObject->GetArrayField(TEXT("chunks")))
+		{
+			const TSharedPtr<FJsonObject>& ChunkObject = ChunkValue->AsObject();
+			if (!ChunkObject.IsValid())
+			{
+				return false;
+			}
+			FCPM_SnapshotChunk& Chunk = File.Chunks.AddDefaulted_GetRef();
+			Chunk.Hash = ChunkObject->GetStringField(TEXT("hash"));
+			Chunk.Size = static_cast<int64>(ChunkObject->GetNumberField(TEXT("size")));
+			ChunkBytes += Chunk.Size;
+		}
+
+		if (ChunkBytes != File.Size)
+		{
+			UCPM_UtilityLibrary::CPM_LogMessage(FString::Printf(TEXT("Snapshot %s: chunks of %s do not add up to its size"), *SnapshotId, *File.Path), ECPM_LogLevel::Error);
+			return false;
+		}
+	}
+	return true;
+}
+
+TArray<FString> FCPM_ChunkStore::ListSnapshots()
+{
+	TArray<FString> SnapshotFiles;
+	IFileManager::Get().FindFiles(SnapshotFiles, *FPaths::Combine(GetSnapshotsDirectory(), TEXT("*.json")), true, false);
+
+	// Ids start with the creation time, so sorting by name sorts by age
+	TArray<FString> Result;
+	for (const FString& SnapshotFile : SnapshotFiles)
+	{
+		Result.Add(FPaths::GetBaseFilename(SnapshotFile));
+	}
+	Result.Sort();
+	return Result;
+}
+
+bool FCPM_ChunkStore::LoadLatestSnapshot(FCPM_Snapshot& OutSnapshot)
+{
+	const TArray<FString> Snapshots = ListSnapshots();
+	return Snapshots.Num() > 0 && LoadSnapshot(Snapshots.Last(), OutSnapshot);
+}
+
+bool FCPM_ChunkStore::PruneSnapshots(const int32 NumToKeep, FCPM_SnapshotPruneStats* OutStats)
+{
+	const double StartTime = FPlatformTime::Seconds();
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	FCPM_SnapshotPruneStats Stats;
+
+	TArray<FString> Snapshots = ListSnapshots();
+	const int32 NumToDelete = FMath::Max(Snapshots.Num() - FMath::Max(NumToKeep, 1), 0);
+	for (int32 Index = 0; Index < NumToDelete; ++Index)
+	{
+		if (PlatformFile.DeleteFile(*FPaths::Combine(GetSnapshotsDirectory(), Snapshots[Index] + TEXT(".json"))))
+		{
+			++Stats.NumDeletedSnapshots;
+		}
+	}
+	Snapshots.RemoveAt(0, NumToDelete);
+
+	// A snapshot that cannot be read may use any chunk, nothing is deleted then
+	TSet<FString> UsedChunks;
+	FDateTime NewestSnapshot = FDateTime::MinValue();
+	for (const FString& SnapshotId : Snapshots)
+	{
+		FCPM_Snapshot Snapshot;
+		if (!LoadSnapshot(SnapshotId, Snapshot))
+		{
+			UCPM_UtilityLibrary::CPM_LogMessage(FString::Printf(TEXT("Not pruning chunks, snapshot %s cannot be read"), *SnapshotId), ECPM_LogLevel::Error);
+			return false;
+		}
+		UsedChunks.Append(Snapshot.GetUniqueChunks());
+		NewestSnapshot = FMath::Max(NewestSnapshot, Snapshot.CreatedAt);
+	}
+
+	// Temporary files of an interrupted write are not named after a hash, they go as well
+	TArray<FString> ChunkFiles;
+	IFileManager::Get().FindFilesRecursive(ChunkFiles, *FPaths::Combine(GetStoreDirectory(), TEXT("Chunks")), TEXT("*"), true, false);
+	for (const FString& ChunkFile : ChunkFiles)
+	{
+		if (UsedChunks.Contains(FPaths::GetCleanFilename(ChunkFile)))
+		{
+			continue;
+		}
+
+		const FFileStatData StatData = PlatformFile.GetStatData(*ChunkFile);
+		if (StatData.bIsValid && StatData.ModificationTime < NewestSnapshot && PlatformFile.DeleteFile(*ChunkFile))
+		{
+			++Stats.NumDeletedChunks;
+			Stats.DeletedBytes += StatData.FileSize;
+		}
+	}
+
+	UCPM_UtilityLibrary::CPM_LogMessage(FString::Printf(TEXT("Pruned %d snapshots and %d chunks (%.1f MB) in %.2fs, %d snapshots kept"),
+		Stats.NumDeletedSnapshots, Stats.NumDeletedChunks, Stats.DeletedBytes / (1024.0 * 1024.0), FPlatformTime::Seconds() - StartTime, Snapshots.Num()));
+
+	if (OutStats)
+	{
+		*OutStats = Stats;
+	}
+	return true;
+}
+
+bool FCPM_ChunkStore::RestoreSnapshot(const FCPM_Snapshot& Snapshot, const FString& TargetDirectory)
+{
+	const double StartTime = FPlatformTime::Seconds();
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+
+	const TArray<FString> Missing = GetChunksMissingFromStore(Snapshot);
+	if (Missing.Num() > 0)
+	{
+		UCPM_UtilityLibrary::CPM_LogMessage(FString::Printf(TEXT("Cannot restore snapshot %s, %d chunks are missing from the store"), *Snapshot.Id, Missing.Num()), ECPM_LogLevel::Error);
+		return false;
+	}
+
+	std::atomic<int32> NumFailed { 0 };
+	ParallelFor(Snapshot.Files.Num(), [&](const int32 Index)
+	{
+		const FCPM_SnapshotFile& File = Snapshot.Files[Index];
+		if (File.Path.IsEmpty() || File.Path.Contains(TEXT("..")))
+		{
+			UCPM_UtilityLibrary::CPM_LogMessage(FString::Printf(TEXT("Invalid path in snapshot: %s"), *File.Path), ECPM_LogLevel::Error);
+			++NumFailed;
+			return;
+		}
+
+		const FString TargetPath = FPaths::Combine(TargetDirectory, File.Path);
+		PlatformFile.CreateDirectoryTree(*FPaths::GetPath(TargetPath));
+
+		bool bRestored = false;
+		{
+			const TUniquePtr<IFileHandle> Target(PlatformFile.OpenWrite(*TargetPath));
+			bRestored = Target.IsValid();
+
+			TArray<uint8> Chunk;
+			for (int32 ChunkIndex = 0; bRestored && ChunkIndex < File.Chunks.Num(); ++ChunkIndex)
+			{
+				const FCPM_SnapshotChunk& ChunkRef = File.Chunks[ChunkIndex];
+				bRestored = FFileHelper::LoadFileToArray(Chunk, *GetChunkPath(ChunkRef.Hash))
+					&& Chunk.Num() == ChunkRef.Size
+					&& SHA1Hex(Chunk.GetData(), Chunk.Num()) == ChunkRef.Hash
+					&& Target->Write(Chunk.GetData(), Chunk.Num());
+				if (!bRestored)
+				{
+					UCPM_UtilityLibrary::CPM_LogMessage(FString::Printf(TEXT("Chunk %s of %s is missing or corrupt"), *ChunkRef.Hash, *File.Path), ECPM_LogLevel::Error);
+				}
+			}
+		}
+
+		if (bRestored)
+		{
+			PlatformFile.SetTimeStamp(*TargetPath, File.Timestamp);
+		}
+		else
+		{
+			PlatformFile.DeleteFile(*TargetPath);
+			++NumFailed;
+		}
+	}, EParallelForFlags::Unbalanced);
+
+	UCPM_UtilityLibrary::CPM_LogMessage(FString::Printf(TEXT("Restored snapshot %s to %s in %.2fs, %d files failed"),
+		*Snapshot.Id, *TargetDirectory, FPlatformTime::Seconds() - StartTime, NumFailed.load()));
+	return NumFailed == 0;
+}
+
+TArray<FString> FCPM_ChunkStore::GetMissingChunks(const FCPM_Snapshot& Snapshot, const TSet<FString>& KnownChunks)
+{
+	TArray<FString> Result = Snapshot.GetUniqueChunks();
+	Result.RemoveAll([&KnownChunks](const FString& Hash) { return KnownChunks.Contains(Hash); });
+	return Result;
+}
+
+TArray<FString> FCPM_ChunkStore::GetChunksMissingFromStore(const FCPM_Snapshot& Snapshot)
+{
+	TArray<FString> Result = Snapshot.GetUniqueChunks();
+	Result.RemoveAll([](const FString& Hash) { return !Hash.IsEmpty() && HasChunk(Hash); });
+	return Result;
+}
@@ -0,0 +1,419 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Cache/CPM_PakStore.h"
+#include "Utility/CPM_FileHash.h"
+#include "Utility/CPM_UtilityLibrary.h"
+#include "Async/Async.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/JsonSerializer.h"
+
+#if PLATFORM_WINDOWS
+#include "Windows/AllowWindowsPlatformTypes.h"
+#include <windows.h>
+#include "Windows/HideWindowsPlatformTypes.h"
+#elif PLATFORM_UNIX || PLATFORM_MAC
+#include <unistd.h>
+#endif
+
+FCPM_PakStore& FCPM_PakStore::Get()
+{
+	static FCPM_PakStore Instance;
+	return Instance;
+}
+
+FCPM_PakStore::FCPM_PakStore()
+{
+	LoadIndex();
+}
+
+FString FCPM_PakStore::GetStoreDirectory()
+{
+	return FPaths::Combine(UCPM_UtilityLibrary::CPM_GetCacheDirectory(), TEXT("PakStore"));
+}
+
+FString FCPM_PakStore::GetObjectPath(const FString& Hash) const
+{
+	return FPaths::Combine(GetStoreDirectory(), TEXT("Objects"), Hash.Left(2), Hash) + TEXT(".pak");
+}
+
+bool FCPM_PakStore::Import(const FString& SourceFilePath, FString& OutHash, const bool bMoveSource, const FString& Alias)
+{
+	OutHash = FCPM_FileHash::SHA1FileHex(SourceFilePath);
+	if (OutHash.IsEmpty())
+	{
+		UCPM_UtilityLibrary::CPM_LogMessage(FString::Printf(TEXT("Failed to hash %s"), *SourceFilePath), ECPM_LogLevel::Error);
+		return false;
+	}
+
+	FScopeLock Lock(&Mutex);
+
+	const FString ObjectPath = GetObjectPath(OutHash);
+	if (FCPM_PakStoreObject* Existing = Objects.Find(OutHash); Existing && FPaths::FileExists(ObjectPath))
+	{
+		if (!Alias.IsEmpty())
+		{
+			Existing->Aliases.AddUnique(Alias);
+			AliasToHash.Add(Alias, OutHash);
+		}
+		Touch(*Existing);
+		SaveIndex();
+
+		if (bMoveSource)
+		{
+			IFileManager::Get().Delete(*SourceFilePath, false, true, true);
+		}
+		return true;
+	}
+
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(ObjectPath), true);
+	const bool bStored = bMoveSource
+		? IFileManager::Get().Move(*ObjectPath, *SourceFilePath, true)
+		: IFileManager::Get().Copy(*ObjectPath, *SourceFilePath, true) == COPY_OK;
+	if (!bStored)
+	{
+		UCPM_UtilityLibrary::CPM_LogMessage(FString::Printf(TEXT("Failed to store %s in the pak store"), *SourceFilePath), ECPM_LogLevel::Error);
+		return false;
+	}
+
+	// Known but its object file went missing, its old size is already counted
+	if (const FCPM_PakStoreObject* Stale = Objects.Find(OutHash))
+	{
+		TotalBytes -= Stale->Size;
+	}
+
+	FCPM_PakStoreObject& Object = Objects.FindOrAdd(OutHash);
+	Object.Hash = OutHash;
+	Object.Size = IFileManager::Get().FileSize(*ObjectPath);
+	if (!Alias.IsEmpty())
+	{
+		Object.Aliases.AddUnique(Alias);
+		AliasToHash.Add(Alias, OutHash);
+	}
+	TotalBytes += Object.Size;
+	Touch(Object);
+
+	EnforceBudgetLocked(OutHash);
+	SaveIndex();
+	return true;
+}
+
+bool FCPM_PakStore::Contains(const FString& Hash) const
+{
+	FScopeLock Lock(&Mutex);
+	return Objects.Contains(Hash);
+}
+
+bool FCPM_PakStore::FindByAlias(const FString& Alias, FString& OutHash) const
+{
+	FScopeLock Lock(&Mutex);
+	const FString* Hash = AliasToHash.Find(Alias);
+	if (!Hash || !Objects.Contains(*Hash))
+	{
+		return false;
+	}
+	OutHash = *Hash;
+	return true;
+}
+
+void FCPM_PakStore::AddAlias(const FString& Hash, const FString& Alias)
+{
+	FScopeLock Lock(&Mutex);
+	if (FCPM_PakStoreObject* Object = Objects.Find(Hash))
+	{
+		Object->Aliases.AddUnique(Alias);
+		AliasToHash.Add(Alias, Hash);
+		SaveIndex();
+	}
+}
+
+bool FCPM_PakStore::LinkTo(const FString& Hash, const FString& DestinationPath)
+{
+	FScopeLock Lock(&Mutex);
+	FCPM_PakStoreObject* Object = Objects.Find(Hash);
+	if (!Object)
+	{
+		return false;
+	}
+
+	const FString ObjectPath = FPaths::ConvertRelativePathToFull(GetObjectPath(Hash));
+	const FString FullDestination = FPaths::ConvertRelativePathToFull(DestinationPath);
+
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(FullDestination), true);
+	IFileManager::Get().Delete(*FullDestination, false, true, true);
+
+	if (!CreateHardLink(ObjectPath, FullDestination))
+	{
+		// Different volume or unsupported file system
+		if (IFileManager::Get().Copy(*FullDestination, *ObjectPath, true) != COPY_OK)
+		{
+			UCPM_UtilityLibrary::CPM_LogMessage(FString::Printf(TEXT("Failed to link %s to %s"), *Hash, *FullDestination), ECPM_LogLevel::Error);
+			return false;
+		}
+	}
+
+	Object->LinkedPaths.AddUnique(FullDestination);
+	Touch(*Object);
+	SaveIndex();
+	return true;
+}
+
+bool FCPM_PakStore::LinkToChunk(const FString& Hash, const ECPM_Platform Platform, const FString& ChunkID)
+{
+	const FString PakPath = UCPM_UtilityLibrary::GetPakFilePathFromChunkID(Platform, ChunkID);
+	return !PakPath.IsEmpty() && LinkTo(Hash, PakPath);
+}
+
+bool FCPM_PakStore::Remove(const FString& Hash)
+{
+	FScopeLock Lock(&Mutex);
+	if (!Objects.Contains(Hash))
+	{
+		return false;
+	}
+	RemoveLocked(Hash);
+	SaveIndex();
+	return true;
+}
+
+void FCPM_PakStore::SetBudgetBytes(const int64 InBudgetBytes)
+{
+	FScopeLock Lock(&Mutex);
+	BudgetBytes = FMath::Max<int64>(0, InBudgetBytes);
+	EnforceBudgetLocked();
+	SaveIndex();
+}
+
+int64 FCPM_PakStore::GetBudgetBytes() const
+{
+	FScopeLock Lock(&Mutex);
+	return BudgetBytes;
+}
+
+int64 FCPM_PakStore::GetTotalBytes() const
+{
+	FScopeLock Lock(&Mutex);
+	return TotalBytes;
+}
+
+void FCPM_PakStore::EnforceBudget()
+{
+	FScopeLock Lock(&Mutex);
+	EnforceBudgetLocked();
+	SaveIndex();
+}
+
+void FCPM_PakStore::StartIntegrityScrub(FCPM_OnPakStoreScrubCompleted OnCompleted)
+{
+	if (bScrubbing.exchange(true))
+	{
+		return;
+	}
+
+	TArray<FString> Hashes;
+	{
+		FScopeLock Lock(&Mutex);
+		Objects.GetKeys(Hashes);
+	}
+
+	Async(EAsyncExecution::ThreadPool, [this, Hashes, OnCompleted]()
+	{
+		TArray<FString> CorruptHashes;
+		for (const FString& Hash : Hashes)
+		{
+			// Hashing happens outside the lock, the store stays usable while scrubbing
+			const FString ActualHash = FCPM_FileHash::SHA1FileHex(GetObjectPath(Hash));
+			if (ActualHash != Hash)
+			{
+				CorruptHashes.Add(Hash);
+			}
+		}
+
+		{
+			FScopeLock Lock(&Mutex);
+			for (const FString& Hash : CorruptHashes)
+			{
+				UCPM_UtilityLibrary::CPM_LogMessage(FString::Printf(TEXT("Pak store object %s is corrupt, removing it"), *Hash), ECPM_LogLevel::Warning);
+				RemoveLocked(Hash);
+			}
+			SaveIndex();
+		}
+
+		bScrubbing = false;
+		AsyncTask(ENamedThreads::GameThread, [OnCompleted, NumChecked = Hashes.Num(), CorruptHashes]()
+		{
+			OnCompleted.ExecuteIfBound(NumChecked, CorruptHashes);
+		});
+	});
+}
+
+void FCPM_PakStore::Touch(FCPM_PakStoreObject& Object)
+{
+	Object.LastAccess = FDateTime::UtcNow();
+}
+
+void FCPM_PakStore::RemoveLocked(const FString& Hash)
+{
+	FCPM_PakStoreObject Object;
+	if (!Objects.RemoveAndCopyValue(Hash, Object))
+	{
+		return;
+	}
+
+	TotalBytes -= Object.Size;
+	for (const FString& Alias : Object.Aliases)
+	{
+		AliasToHash.Remove(Alias);
+	}
+
+	// Only the store's own file. Linked paths may be copies or paks a packaged app is mounting, they belong to
+	// whoever asked for the link, and a hard linked one keeps its data until that owner removes it.
+	IFileManager::Get().Delete(*GetObjectPath(Hash), false, true, true);
+}
+
+void FCPM_PakStore::EnforceBudgetLocked(const FString& KeepHash)
+{
+	if (BudgetBytes <= 0 || TotalBytes <= BudgetBytes)
+	{
+		return;
+	}
+
+	TArray<FCPM_PakStoreObject*> ByAccess;
+	for (TPair<FString, FCPM_PakStoreObject>& Pair : Objects)
+	{
+		ByAccess.Add(&Pair.Value);
+	}
+	ByAccess.Sort([](const FCPM_PakStoreObject& A, const FCPM_PakStoreObject& B)
+	{
+		return A.LastAccess < B.LastAccess;
+	});
+
+	TArray<FString> ToEvict;
+	int64 Remaining = TotalBytes;
+	for (const FCPM_PakStoreObject* Object : ByAccess)
+	{
+		if (Remaining <= BudgetBytes)
+		{
+			break;
+		}
+		if (Object->Hash == KeepHash)
+		{
+			continue;
+		}
+		Remaining -= Object->Size;
+		ToEvict.Add(Object->Hash);
+	}
+
+	for (const FString& Hash : ToEvict)
+	{
+		UCPM_UtilityLibrary::CPM_LogMessage(FString::Printf(TEXT("Evicting pak store object %s"), *Hash));
+		RemoveLocked(Hash);
+	}
+}
+
+bool FCPM_PakStore::CreateHardLink(const FString& SourcePath, const FString& DestinationPath)
+{
+#if PLATFORM_WINDOWS
+	return ::CreateHardLinkW(*DestinationPath, *SourcePath, nullptr) != 0;
+#elif PLATFORM_UNIX || PLATFORM_MAC
+	return ::link(TCHAR_TO_UTF8(*SourcePath), TCHAR_TO_UTF8(*DestinationPath)) == 0;
+#else
+	return false;
+#endif
+}
+
+void FCPM_PakStore::LoadIndex()
+{
+	FString FileContent;
+	if (!FFileHelper::LoadFileToString(FileContent, *FPaths::Combine(GetStoreDirectory(), TEXT("Index.json"))))
+	{
+		return;
+	}
+
+	TSharedPtr<FJsonObject> JsonObject;
+	const TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(FileContent);
+	if (!FJsonSerializer::Deserialize(Reader, JsonObject) || !JsonObject.IsValid())
+	{
+		return;
+	}
+
+	JsonObject->TryGetNumberField(TEXT("budget_bytes"), BudgetBytes);
+
+	const TArray<TSharedPtr<FJsonValue>>* ObjectsArray;
+	if (!JsonObject->TryGetArrayField(TEXT("objects"), ObjectsArray))
+	{
+		return;
+	}
+
+	for (const TSharedPtr<FJsonValue>& Value : *ObjectsArray)
+	{
+		const TSharedPtr<FJsonObject> ObjectJson = Value->AsObject();
+		if (!ObjectJson.IsValid())
+		{
+			continue;
+		}
+
+		FCPM_PakStoreObject Object;
+		FString LastAccess;
+		ObjectJson->TryGetStringField(TEXT("hash"), Object.Hash);
+		ObjectJson->TryGetNumberField(TEXT("size"), Object.Size);
+		ObjectJson->TryGetStringField(TEXT("last_access"), LastAccess);
+		ObjectJson->TryGetStringArrayField(TEXT("aliases"), Object.Aliases);
+		ObjectJson->TryGetStringArrayField(TEXT("linked_paths"), Object.LinkedPaths);
+		FDateTime::ParseIso8601(*LastAccess, Object.LastAccess);
+
+		if (Object.Hash.IsEmpty() || !FPaths::FileExists(GetObjectPath(Object.Hash)))
+		{
+			continue;
+		}
+
+		for (const FString& Alias : Object.Aliases)
+		{
+			AliasToHash.Add(Alias, Object.Hash);
+		}
+		TotalBytes += Object.Size;
+		Objects.Add(Object.Hash, MoveTemp(Object));
+	}
+}
+
+void FCPM_PakStore::SaveIndex() const
+{
+	TArray<TSharedPtr<FJsonValue>> ObjectsArray;
+	for (const TPair<FString, FCPM_PakStoreObject>& Pair : Objects)
+	{
+		const FCPM_PakStoreObject& Object = Pair.Value;
+
+		TArray<TSharedPtr<FJsonValue>> Aliases, LinkedPaths;
+		for (const FString& Alias : Object.Aliases)
+		{
+			Aliases.Add(MakeShared<FJsonValueString>(Alias));
+		}
+		for (const FString& LinkedPath : Object.LinkedPaths)
+		{
+			LinkedPaths.Add(MakeShared<FJsonValueString>(LinkedPath));
+		}
+
+		TSharedPtr<FJsonObject> ObjectJson = MakeShared<FJsonObject>();
+		ObjectJson->SetStringField(TEXT("hash"), Object.Hash);
+		ObjectJson->SetNumberField(TEXT("size"), Object.Size);
+		ObjectJson->SetStringField(TEXT("last_access"), Object.LastAccess.ToIso8601());
+		ObjectJson->SetArrayField(TEXT("aliases"), Aliases);
+		ObjectJson->SetArrayField(TEXT("linked_paths"), LinkedPaths);
+		ObjectsArray.Add(MakeShared<FJsonValueObject>(ObjectJson));
+	}
+
+	const TSharedPtr<FJsonObject> JsonObject = MakeShared<FJsonObject>();
+	JsonObject->SetNumberField(TEXT("budget_bytes"), BudgetBytes);
+	JsonObject->SetArrayField(TEXT("objects"), ObjectsArray);
+
+	FString Output;
+	const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Output);
+	FJsonSerializer::Serialize(JsonObject.ToSharedRef(), Writer);
+	FFileHelper::SaveStringToFile(Output, *FPaths::Combine(GetStoreDirectory(), TEXT("Index.json")));
+}
@@ -1,6 +1,7 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "ConvaiPakManager.h"
+#include "Utility/CPM_HttpCache.h"
 
 #define LOCTEXT_NAMESPACE "FConvaiPakManagerModule"
 
@@ -13,6 +14,7 @@ void FConvaiPakManagerModule::ShutdownModule()
 {
 	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
 	// we call this function before unloading the module.
+	FCPM_HttpCache::Get().Flush();
 }
 
 #undef LOCTEXT_NAMESPACE
@@ -0,0 +1,794 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Download/CPM_DownloadManager.h"
+#include "Utility/CPM_UtilityLibrary.h"
+#include "HttpModule.h"
+#include "Interfaces/IHttpRequest.h"
+#include "Interfaces/IHttpResponse.h"
+#include "Async/Async.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/Base64.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/SecureHash.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/JsonSerializer.h"
+
+struct FCPM_DownloadSegment
+{
+	int64 Start = 0;
+	int64 End = 0; // inclusive
+	int32 Attempts = 0;
+	bool bDone = false;
+	bool bInFlight = false;
+
+	int64 Num() const { return End - Start + 1; }
+};
+
+struct FCPM_DownloadJob
+{
+	FGuid Id;
+	FCPM_DownloadRequest Request;
+	FString PartPath;
+	FString ManifestPath;
+
+	/** INDEX_NONE until the first ranged response told us the size */
+	int64 TotalSize = INDEX_NONE;
+	FString ETag;
+	FString ServerMD5;
+	TArray<FCPM_DownloadSegment> Segments;
+
+	int64 BytesOnDisk = 0;
+	int64 BytesThisSession = 0;
+	double StartTime = 0.0;
+	double LastProgressTime = 0.0;
+	int32 PendingWrites = 0;
+	bool bCancelled = false;
+	bool bFailed = false;
+	bool bFinalizing = false;
+
+	/** The server ignored Range, the file comes in as one GET streamed to disk */
+	bool bStreamingWholeFile = false;
+
+	/** Bumped under FileMutex whenever the part file is closed or reopened, responses and writes of an older generation are dropped */
+	int32 Generation = 0;
+
+	TArray<TSharedRef<IHttpRequest, ESPMode::ThreadSafe>> ActiveRequests;
+
+	FCriticalSection FileMutex;
+	TUniquePtr<IFileHandle> FileHandle;
+
+	bool IsProbing() const { return TotalSize == INDEX_NONE; }
+	int32 NumInFlight() const
+	{
+		int32 Count = PendingWrites;
+		for (const FCPM_DownloadSegment& Segment : Segments)
+		{
+			Count += Segment.bInFlight ? 1 : 0;
+		}
+		return Count;
+	}
+};
+
+namespace
+{
+	constexpr int32 MaxSegmentAttempts = 3;
+	constexpr double ProgressBroadcastInterval = 0.25;
+
+	/** Signed urls are re-signed on every request, the query string must not break resuming */
+	FString GetSourceKey(const FString& URL)
+	{
+		FString Left, Right;
+		return URL.Split(TEXT("?"), &Left, &Right) ? Left : URL;
+	}
+
+	/** Parses "bytes 0-1023/4096" */
+	bool ParseContentRange(const FString& ContentRange, int64& OutStart, int64& OutEnd, int64& OutTotal)
+	{
+		FString Unit, RangeAndTotal, Range, Total;
+		if (!ContentRange.Split(TEXT(" "), &Unit, &RangeAndTotal) || !RangeAndTotal.Split(TEXT("/"), &Range, &Total))
+		{
+			return false;
+		}
+
+		FString Start, End;
+		if (!Range.Split(TEXT("-"), &Start, &End))
+		{
+			return false;
+		}
+
+		OutStart = FCString::Atoi64(*Start);
+		OutEnd = FCString::Atoi64(*End);
+		OutTotal = Total == TEXT("*") ? INDEX_NONE : FCString::Atoi64(*Total);
+		return OutEnd >= OutStart;
+	}
+
+	/** Extracts the base64 md5 out of "crc32c=...,md5=..." */
+	FString ParseGoogMD5(const FString& GoogHash)
+	{
+		TArray<FString> Parts;
+		GoogHash.ParseIntoArray(Parts, TEXT(","));
+		for (FString& Part : Parts)
+		{
+			Part.TrimStartAndEndInline();
+			if (Part.StartsWith(TEXT("md5=")))
+			{
+				return Part.RightChop(4);
+			}
+		}
+		return FString();
+	}
+
+	void SaveManifest(const FCPM_DownloadJob& Job)
+	{
+		TArray<TSharedPtr<FJsonValue>> DoneArray;
+		for (const FCPM_DownloadSegment& Segment : Job.Segments)
+		{
+			if (Segment.bDone)
+			{
+				TArray<TSharedPtr<FJsonValue>> Range;
+				Range.Add(MakeShared<FJsonValueNumber>(Segment.Start));
+				Range.Add(MakeShared<FJsonValueNumber>(Segment.End));
+				DoneArray.Add(MakeShared<FJsonValueArray>(Range));
+			}
+		}
+
+		const TSharedPtr<FJsonObject> JsonObject = MakeShared<FJsonObject>();
+		JsonObject->SetStringField(TEXT("source"), GetSourceKey(Job.Request.URL));
+		JsonObject->SetNumberField(TEXT("total_size"), Job.TotalSize);
+		JsonObject->SetStringField(TEXT("etag"), Job.ETag);
+		JsonObject->SetStringField(TEXT("server_md5"), Job.ServerMD5);
+		JsonObject->SetArrayField(TEXT("done"), DoneArray);
+
+		FString Output;
+		const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Output);
+		FJsonSerializer::Serialize(JsonObject.ToSharedRef(), Writer);
+		FFileHelper::SaveStringToFile(Output, *Job.ManifestPath);
+	}
+
+	/** Restores the segment list from the sidecar manifest. Returns false if there is nothing to resume */
+	bool LoadManifest(FCPM_DownloadJob& Job, const int64 SegmentSize)
+	{
+		FString FileContent;
+		if (!FFileHelper::LoadFileToString(FileContent, *Job.ManifestPath))
+		{
+			return false;
+		}
+
+		TSharedPtr<FJsonObject> JsonObject;
+		const TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(FileContent);
+		if (!FJsonSerializer::Deserialize(Reader, JsonObject) || !JsonObject.IsValid())
+		{
+			return false;
+		}
+
+		FString Source;
+		int64 TotalSize = INDEX_NONE;
+		JsonObject->TryGetStringField(TEXT("source"), Source);
+		JsonObject->TryGetNumberField(TEXT("total_size"), TotalSize);
+		if (Source != GetSourceKey(Job.Request.URL) || TotalSize <= 0 || IFileManager::Get().FileSize(*Job.PartPath) != TotalSize)
+		{
+			return false;
+		}
+
+		TSet<int64> DoneStarts;
+		const TArray<TSharedPtr<FJsonValue>>* DoneArray;
+		if (JsonObject->TryGetArrayField(TEXT("done"), DoneArray))
+		{
+			for (const TSharedPtr<FJsonValue>& Value : *DoneArray)
+			{
+				const TArray<TSharedPtr<FJsonValue>>& Range = Value->AsArray();
+				if (Range.Num() == 2)
+				{
+					DoneStarts.Add(static_cast<int64>(Range[0]->AsNumber()));
+				}
+			}
+		}
+
+		Job.TotalSize = TotalSize;
+		JsonObject->TryGetStringField(TEXT("etag"), Job.ETag);
+		JsonObject->TryGetStringField(TEXT("server_md5"), Job.ServerMD5);
+
+		for (int64 Start = 0; Start < TotalSize; Start += SegmentSize)
+		{
+			FCPM_DownloadSegment& Segment = Job.Segments.AddDefaulted_GetRef();
+			Segment.Start = Start;
+			Segment.End = FMath::Min(Start + SegmentSize, TotalSize) - 1;
+			Segment.bDone = DoneStarts.Contains(Start);
+			Job.BytesOnDisk += Segment.bDone ? Segment.Num() : 0;
+		}
+		return true;
+	}
+
+	/** Cancelling completes requests, whose completion removes them from ActiveRequests, so a copy is iterated */
+	void CancelActiveRequests(FCPM_DownloadJob& Job)
+	{
+		const TArray<TSharedRef<IHttpRequest, ESPMode::ThreadSafe>> Requests = MoveTemp(Job.ActiveRequests);
+		Job.ActiveRequests.Reset();
+		for (const TSharedRef<IHttpRequest, ESPMode::ThreadSafe>& HttpRequest : Requests)
+		{
+			HttpRequest->CancelRequest();
+		}
+	}
+
+	/** Closes the part file, or reopens it truncated, and starts a new generation so nothing in flight writes into it */
+	bool ResetPartFile(FCPM_DownloadJob& Job, const bool bReopen)
+	{
+		FScopeLock Lock(&Job.FileMutex);
+		++Job.Generation;
+		Job.PendingWrites = 0;
+		Job.FileHandle.Reset(bReopen ? FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*Job.PartPath, /*bAppend*/false, /*bAllowRead*/true) : nullptr);
+		return !bReopen || Job.FileHandle.IsValid();
+	}
+
+	void SplitRemaining(FCPM_DownloadJob& Job, const int64 From, const int64 SegmentSize)
+	{
+		for (int64 Start = From; Start < Job.TotalSize; Start += SegmentSize)
+		{
+			FCPM_DownloadSegment& Segment = Job.Segments.AddDefaulted_GetRef();
+			Segment.Start = Start;
+			Segment.End = FMath::Min(Start + SegmentSize, Job.TotalSize) - 1;
+		}
+	}
+}
+
+FCPM_DownloadManager& FCPM_DownloadManager::Get()
+{
+	static FCPM_DownloadManager Instance;
+	return Instance;
+}
+
+FGuid FCPM_DownloadManager::StartDownload(const FCPM_DownloadRequest& Request)
+{
+	if (Request.URL.IsEmpty() || Request.TargetPath.IsEmpty())
+	{
+		UCPM_UtilityLibrary::CPM_LogMessage(TEXT("Invalid download URL or target path"), ECPM_LogLevel::Error);
+		Request.OnComplete.ExecuteIfBound(false, TEXT("Invalid download URL or target path"));
+		return FGuid();
+	}
+
+	TSharedRef<FCPM_DownloadJob> Job = MakeShared<FCPM_DownloadJob>();
+	Job->Id = FGuid::NewGuid();
+	Job->Request = Request;
+	Job->PartPath = Request.TargetPath + TEXT(".part");
+	Job->ManifestPath = Job->PartPath + TEXT(".json");
+	Job->StartTime = FPlatformTime::Seconds();
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.CreateDirectoryTree(*FPaths::GetPath(Request.TargetPath));
+
+	const bool bResume = LoadManifest(*Job, SegmentSize);
+	if (!bResume)
+	{
+		Job->Segments.Reset();
+		Job->BytesOnDisk = 0;
+		PlatformFile.DeleteFile(*Job->ManifestPath);
+
+		// Probe with the first segment, the response tells us the size and whether ranges are honoured
+		FCPM_DownloadSegment& Probe = Job->Segments.AddDefaulted_GetRef();
+		Probe.Start = 0;
+		Probe.End = SegmentSize - 1;
+	}
+	else
+	{
+		UCPM_UtilityLibrary::CPM_LogMessage(FString::Printf(TEXT("Resuming download of %s at %lld/%lld bytes"), *Request.TargetPath, Job->BytesOnDisk, Job->TotalSize));
+	}
+
+	Job->FileHandle.Reset(PlatformFile.OpenWrite(*Job->PartPath, /*bAppend*/bResume, /*bAllowRead*/true));
+	if (!Job->FileHandle.IsValid())
+	{
+		const FString Reason = FString::Printf(TEXT("Failed to open %s for writing"), *Job->PartPath);
+		UCPM_UtilityLibrary::CPM_LogMessage(Reason, ECPM_LogLevel::Error);
+		Request.OnComplete.ExecuteIfBound(false, Reason);
+		return FGuid();
+	}
+
+	Jobs.Add(Job->Id, Job);
+	JobOrder.Add(Job->Id);
+
+	if (bResume && !Job->Segments.ContainsByPredicate([](const FCPM_DownloadSegment& Segment) { return !Segment.bDone; }))
+	{
+		Finalize(Job);
+	}
+	else
+	{
+		Pump();
+	}
+	return Job->Id;
+}
+
+void FCPM_DownloadManager::CancelDownload(const FGuid& DownloadId, const bool bDeletePartialFile)
+{
+	TSharedRef<FCPM_DownloadJob>* JobPtr = Jobs.Find(DownloadId);
+	if (!JobPtr)
+	{
+		return;
+	}
+
+	TSharedRef<FCPM_DownloadJob> Job = *JobPtr;
+	Job->bCancelled = true;
+	CancelActiveRequests(*Job);
+	ResetPartFile(*Job, /*bReopen*/false);
+
+	if (bDeletePartialFile)
+	{
+		IFileManager::Get().Delete(*Job->PartPath, false, true, true);
+		IFileManager::Get().Delete(*Job->ManifestPath, false, true, true);
+	}
+
+	Jobs.Remove(DownloadId);
+	JobOrder.Remove(DownloadId);
+	Job->Request.OnComplete.ExecuteIfBound(false, TEXT("Cancelled"));
+}
+
+bool FCPM_DownloadManager::IsDownloading(const FGuid& DownloadId) const
+{
+	return Jobs.Contains(DownloadId);
+}
+
+bool FCPM_DownloadManager::Tick(const float DeltaTime)
+{
+	if (MaxBytesPerSecond > 0)
+	{
+		// Let one segment through at a time when the budget is smaller than a segment
+		const double Burst = FMath::Max<double>(SegmentSize, MaxBytesPerSecond);
+		ByteTokens = FMath::Min(ByteTokens + MaxBytesPerSecond * DeltaTime, Burst);
+	}
+
+	if (Jobs.Num() > 0)
+	{
+		Pump();
+	}
+	return true;
+}
+
+void FCPM_DownloadManager::Pump()
+{
+	for (const FGuid& JobId : JobOrder)
+	{
+		const TSharedRef<FCPM_DownloadJob> Job = Jobs.FindChecked(JobId);
+		if (Job->bFailed || Job->bCancelled || Job->bFinalizing || Job->bStreamingWholeFile)
+		{
+			continue;
+		}
+
+		for (int32 SegmentIndex = 0; SegmentIndex < Job->Segments.Num(); ++SegmentIndex)
+		{
+			if (ActiveSegments >= MaxConcurrentSegments || (MaxBytesPerSecond > 0 && ByteTokens <= 0.0))
+			{
+				return;
+			}
+
+			// Only one request until the probe resolved the file size
+			if (Job->IsProbing() && Job->Segments[0].bInFlight)
+			{
+				break;
+			}
+
+			const FCPM_DownloadSegment& Segment = Job->Segments[SegmentIndex];
+			if (!Segment.bDone && !Segment.bInFlight)
+			{
+				StartSegment(Job, SegmentIndex);
+			}
+		}
+	}
+}
+
+void FCPM_DownloadManager::StartSegment(const TSharedRef<FCPM_DownloadJob>& Job, const int32 SegmentIndex)
+{
+	FCPM_DownloadSegment& Segment = Job->Segments[SegmentIndex];
+	Segment.bInFlight = true;
+	++Segment.Attempts;
+	++ActiveSegments;
+
+	if (MaxBytesPerSecond > 0)
+	{
+		ByteTokens -= Segment.Num();
+	}
+
+	const TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequest = FHttpModule::Get().CreateRequest();
+	HttpRequest->SetURL(Job->Request.URL);
+	HttpRequest->SetVerb(TEXT("GET"));
+	HttpRequest->SetHeader(TEXT("Range"), FString::Printf(TEXT("bytes=%lld-%lld"), Segment.Start, Segment.End));
+	if (!Job->ETag.IsEmpty())
+	{
+		// If the object changed since the manifest was written we get the whole new file back with a 200
+		HttpRequest->SetHeader(TEXT("If-Range"), Job->ETag);
+	}
+
+	const int32 Generation = Job->Generation;
+	const int64 RequestedBytes = Segment.Num();
+	HttpRequest->OnRequestProgress().BindLambda(
+	[this, Job, Generation, RequestedBytes](FHttpRequestPtr, int32, const int32 BytesReceived)
+	{
+		// More than the range we asked for, the server ignores Range and sends the whole file. It goes
+		// to disk as a stream instead of piling up in memory.
+		if (BytesReceived > RequestedBytes && Job->Generation == Generation && !Job->bCancelled && !Job->bFailed && !Job->bFinalizing)
+		{
+			RestartAsWholeFile(Job);
+		}
+	});
+
+	HttpRequest->OnProcessRequestComplete().BindLambda(
+	[this, Job, SegmentIndex, Generation](FHttpRequestPtr InRequest, FHttpResponsePtr InResponse, bool bSucceeded)
+	{
+		--ActiveSegments;
+		Job->ActiveRequests.RemoveAll([&InRequest](const TSharedRef<IHttpRequest, ESPMode::ThreadSafe>& Active) { return Active == InRequest; });
+
+		if (Job->Generation != Generation || Job->bCancelled || Job->bFailed || Job->bFinalizing || Job->bStreamingWholeFile || !Job->Segments.IsValidIndex(SegmentIndex))
+		{
+			return;
+		}
+
+		if (!bSucceeded || !InResponse.IsValid())
+		{
+			OnSegmentResponse(Job, SegmentIndex, 0, FString(), FString(), FString(), TArray<uint8>());
+			return;
+		}
+
+		TArray<uint8> Data = InResponse->GetContent();
+		OnSegmentResponse(Job, SegmentIndex, InResponse->GetResponseCode(), InResponse->GetHeader(TEXT("Content-Range")),
+			InResponse->GetHeader(TEXT("ETag")), InResponse->GetHeader(TEXT("x-goog-hash")), MoveTemp(Data));
+	});
+
+	Job->ActiveRequests.Add(HttpRequest);
+	HttpRequest->ProcessRequest();
+}
+
+void FCPM_DownloadManager::OnSegmentResponse(const TSharedRef<FCPM_DownloadJob>& Job, const int32 SegmentIndex, const int32 ResponseCode,
+	const FString& ContentRange, const FString& ETag, const FString& GoogHash, TArray<uint8>&& Data)
+{
+	if (ResponseCode == 200)
+	{
+		// Range ignored, or the object changed under an If-Range. Either way this is the whole file.
+		if (Data.Num() > SegmentSize)
+		{
+			RestartAsWholeFile(Job);
+			return;
+		}
+
+		// Small enough to have arrived before the progress check caught it, written like any segment
+		CancelActiveRequests(*Job);
+		if (!ResetPartFile(*Job, /*bReopen*/true))
+		{
+			FailJob(Job, FString::Printf(TEXT("Failed to open %s for writing"), *Job->PartPath));
+			return;
+		}
+		IFileManager::Get().Delete(*Job->ManifestPath, false, true, true);
+
+		Job->TotalSize = Data.Num();
+		Job->ETag = ETag;
+		Job->ServerMD5 = ParseGoogMD5(GoogHash);
+		Job->BytesOnDisk = 0;
+		Job->Segments.Reset();
+		if (Job->TotalSize == 0)
+		{
+			Finalize(Job);
+			return;
+		}
+
+		FCPM_DownloadSegment& Whole = Job->Segments.AddDefaulted_GetRef();
+		Whole.Start = 0;
+		Whole.End = Job->TotalSize - 1;
+		Whole.bInFlight = true;
+		WriteSegment(Job, 0, MoveTemp(Data));
+		return;
+	}
+
+	FCPM_DownloadSegment& Segment = Job->Segments[SegmentIndex];
+
+	if (ResponseCode == 416 && Job->IsProbing())
+	{
+		// Zero sized object
+		Job->TotalSize = 0;
+		Job->Segments.Reset();
+		Finalize(Job);
+		return;
+	}
+
+	int64 RangeStart = 0, RangeEnd = 0, RangeTotal = INDEX_NONE;
+	if (ResponseCode != 206 || !ParseContentRange(ContentRange, RangeStart, RangeEnd, RangeTotal) || RangeStart != Segment.Start)
+	{
+		Segment.bInFlight = false;
+		if (Segment.Attempts < MaxSegmentAttempts)
+		{
+			UCPM_UtilityLibrary::CPM_LogMessage(FString::Printf(TEXT("Retrying segment %lld-%lld of %s (http %d)"), Segment.Start, Segment.End, *Job->Request.TargetPath, ResponseCode), ECPM_LogLevel::Warning);
+			Pump();
+			return;
+		}
+		FailJob(Job, FString::Printf(TEXT("Segment %lld-%lld failed with http %d"), Segment.Start, Segment.End, ResponseCode));
+		return;
+	}
+
+	if (Job->IsProbing())
+	{
+		if (RangeTotal == INDEX_NONE)
+		{
+			FailJob(Job, TEXT("Server did not report the file size"));
+			return;
+		}
+
+		Job->TotalSize = RangeTotal;
+		Job->ETag = ETag;
+		Job->ServerMD5 = ParseGoogMD5(GoogHash);
+		Segment.End = RangeEnd;
+		SplitRemaining(*Job, RangeEnd + 1, SegmentSize);
+
+		// Preallocated, so the part file has its final size from the first manifest on and can be resumed
+		bool bPreallocated = false;
+		{
+			FScopeLock Lock(&Job->FileMutex);
+			bPreallocated = Job->FileHandle.IsValid() && Job->FileHandle->Truncate(Job->TotalSize);
+		}
+		if (!bPreallocated)
+		{
+			FailJob(Job, FString::Printf(TEXT("Failed to allocate %lld bytes for %s"), Job->TotalSize, *Job->PartPath));
+			return;
+		}
+	}
+
+	if (Data.Num() != Segment.Num())
+	{
+		Segment.bInFlight = false;
+		if (Segment.Attempts < MaxSegmentAttempts)
+		{
+			Pump();
+			return;
+		}
+		FailJob(Job, FString::Printf(TEXT("Segment %lld-%lld returned %d bytes"), Segment.Start, Segment.End, Data.Num()));
+		return;
+	}
+
+	WriteSegment(Job, SegmentIndex, MoveTemp(Data));
+}
+
+void FCPM_DownloadManager::WriteSegment(const TSharedRef<FCPM_DownloadJob>& Job, const int32 SegmentIndex, TArray<uint8>&& Data)
+{
+	// Disk writes stay off the game thread
+	++Job->PendingWrites;
+	const int32 Generation = Job->Generation;
+	const int64 WriteOffset = Job->Segments[SegmentIndex].Start;
+	Async(EAsyncExecution::ThreadPool, [this, Job, SegmentIndex, Generation, WriteOffset, Data = MoveTemp(Data)]()
+	{
+		bool bWritten = false;
+		{
+			FScopeLock Lock(&Job->FileMutex);
+			if (Job->Generation == Generation && Job->FileHandle.IsValid() && Job->FileHandle->Seek(WriteOffset))
+			{
+				bWritten = Job->FileHandle->Write(Data.GetData(), Data.Num()) && Job->FileHandle->Flush();
+			}
+		}
+
+		const int64 BytesWritten = Data.Num();
+		AsyncTask(ENamedThreads::GameThread, [this, Job, SegmentIndex, Generation, BytesWritten, bWritten]()
+		{
+			OnSegmentWritten(Job, SegmentIndex, Generation, BytesWritten, bWritten);
+		});
+	});
+}
+
+void FCPM_DownloadManager::OnSegmentWritten(const TSharedRef<FCPM_DownloadJob>& Job, const int32 SegmentIndex, const int32 Generation, const int64 BytesWritten, const bool bWriteSucceeded)
+{
+	// Written for a part file that has since been closed or reopened, it no longer counts as pending
+	if (Job->Generation != Generation)
+	{
+		return;
+	}
+
+	--Job->PendingWrites;
+	if (Job->bCancelled || Job->bFailed || !Job->Segments.IsValidIndex(SegmentIndex))
+	{
+		return;
+	}
+
+	if (!bWriteSucceeded)
+	{
+		FailJob(Job, FString::Printf(TEXT("Failed to write %s"), *Job->PartPath));
+		return;
+	}
+
+	FCPM_DownloadSegment& Segment = Job->Segments[SegmentIndex];
+	Segment.bInFlight = false;
+	Segment.bDone = true;
+	Job->BytesOnDisk += BytesWritten;
+	Job->BytesThisSession += BytesWritten;
+
+	SaveManifest(*Job);
+	BroadcastProgress(Job);
+
+	if (Job->NumInFlight() == 0 && !Job->Segments.ContainsByPredicate([](const FCPM_DownloadSegment& S) { return !S.bDone; }))
+	{
+		Finalize(Job);
+		return;
+	}
+	Pump();
+}
+
+void FCPM_DownloadManager::RestartAsWholeFile(const TSharedRef<FCPM_DownloadJob>& Job)
+{
+	// Any other segment still in flight belongs to a stale version of the file
+	CancelActiveRequests(*Job);
+	if (!ResetPartFile(*Job, /*bReopen*/false))
+	{
+		return;
+	}
+	IFileManager::Get().Delete(*Job->ManifestPath, false, true, true);
+
+	Job->bStreamingWholeFile = true;
+	Job->TotalSize = INDEX_NONE;
+	Job->BytesOnDisk = 0;
+	Job->Segments.Reset();
+
+	FArchive* PartWriter = IFileManager::Get().CreateFileWriter(*Job->PartPath);
+	if (!PartWriter)
+	{
+		FailJob(Job, FString::Printf(TEXT("Failed to open %s for writing"), *Job->PartPath));
+		return;
+	}
+	const TSharedRef<FArchive> PartStream = MakeShareable(PartWriter);
+
+	const TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequest = FHttpModule::Get().CreateRequest();
+	HttpRequest->SetURL(Job->Request.URL);
+	HttpRequest->SetVerb(TEXT("GET"));
+	if (!HttpRequest->SetResponseBodyReceiveStream(PartStream))
+	{
+		PartStream->Close();
+		FailJob(Job, TEXT("Http backend cannot stream the response to disk"));
+		return;
+	}
+
+	const int32 Generation = Job->Generation;
+	HttpRequest->OnRequestProgress().BindLambda([this, Job, Generation](FHttpRequestPtr, int32, const int32 BytesReceived)
+	{
+		if (Job->Generation == Generation && !Job->bCancelled && !Job->bFailed)
+		{
+			Job->BytesOnDisk = BytesReceived;
+			BroadcastProgress(Job);
+		}
+	});
+
+	HttpRequest->OnProcessRequestComplete().BindLambda(
+	[this, Job, Generation, PartStream](FHttpRequestPtr InRequest, FHttpResponsePtr InResponse, const bool bSucceeded)
+	{
+		--ActiveSegments;
+		Job->ActiveRequests.RemoveAll([&InRequest](const TSharedRef<IHttpRequest, ESPMode::ThreadSafe>& Active) { return Active == InRequest; });
+		PartStream->Close();
+
+		if (Job->Generation != Generation || Job->bCancelled || Job->bFailed)
+		{
+			return;
+		}
+
+		Job->bStreamingWholeFile = false;
+		if (!bSucceeded || !InResponse.IsValid() || InResponse->GetResponseCode() != 200 || PartStream->IsError())
+		{
+			FailJob(Job, FString::Printf(TEXT("Whole file download failed with http %d"), InResponse.IsValid() ? InResponse->GetResponseCode() : 0));
+			return;
+		}
+
+		// Content-Length when the server sent one, so Finalize catches a truncated body
+		const int64 ContentLength = InResponse->GetContentLength();
+		Job->TotalSize = ContentLength > 0 ? ContentLength : IFileManager::Get().FileSize(*Job->PartPath);
+		Job->ETag = InResponse->GetHeader(TEXT("ETag"));
+		Job->ServerMD5 = ParseGoogMD5(InResponse->GetHeader(TEXT("x-goog-hash")));
+		FCPM_DownloadSegment& Whole = Job->Segments.AddDefaulted_GetRef();
+		Whole.Start = 0;
+		Whole.End = Job->TotalSize - 1;
+		Whole.bDone = true;
+
+		Job->BytesOnDisk = Job->TotalSize;
+		Job->BytesThisSession += Job->TotalSize;
+		Finalize(Job);
+	});
+
+	++ActiveSegments;
+	Job->ActiveRequests.Add(HttpRequest);
+	HttpRequest->ProcessRequest();
+}
+
+void FCPM_DownloadManager::Finalize(const TSharedRef<FCPM_DownloadJob>& Job)
+{
+	Job->bFinalizing = true;
+	BroadcastProgress(Job);
+
+	Async(EAsyncExecution::ThreadPool, [this, Job]()
+	{
+		{
+			FScopeLock Lock(&Job->FileMutex);
+			Job->FileHandle.Reset();
+		}
+
+		FString Error;
+		if (IFileManager::Get().FileSize(*Job->PartPath) != Job->TotalSize)
+		{
+			Error = TEXT("Downloaded size does not match");
+		}
+		else if (!Job->Request.ExpectedMD5.IsEmpty() || !Job->ServerMD5.IsEmpty())
+		{
+			const FMD5Hash Hash = FMD5Hash::HashFile(*Job->PartPath);
+			bool bMatches;
+			if (!Job->Request.ExpectedMD5.IsEmpty())
+			{
+				bMatches = LexToString(Hash).Equals(Job->Request.ExpectedMD5, ESearchCase::IgnoreCase);
+			}
+			else
+			{
+				TArray<uint8> Expected;
+				bMatches = FBase64::Decode(Job->ServerMD5, Expected) && Expected.Num() == Hash.GetSize()
+					&& FMemory::Memcmp(Expected.GetData(), Hash.GetBytes(), Hash.GetSize()) == 0;
+			}
+
+			if (!bMatches)
+			{
+				// Corrupt data must not be resumed from
+				Error = TEXT("Content hash mismatch");
+				IFileManager::Get().Delete(*Job->PartPath, false, true, true);
+			}
+		}
+
+		if (Error.IsEmpty() && !IFileManager::Get().Move(*Job->Request.TargetPath, *Job->PartPath, /*bReplace*/true))
+		{
+			Error = FString::Printf(TEXT("Failed to move download into %s"), *Job->Request.TargetPath);
+		}
+
+		if (Error.IsEmpty() || !FPaths::FileExists(Job->PartPath))
+		{
+			IFileManager::Get().Delete(*Job->ManifestPath, false, true, true);
+		}
+
+		AsyncTask(ENamedThreads::GameThread, [this, Job, Error]()
+		{
+			Jobs.Remove(Job->Id);
+			JobOrder.Remove(Job->Id);
+
+			if (Error.IsEmpty())
+			{
+				const double Elapsed = FPlatformTime::Seconds() - Job->StartTime;
+				UCPM_UtilityLibrary::CPM_LogMessage(FString::Printf(TEXT("Downloaded %s (%lld bytes) in %.2fs"), *Job->Request.TargetPath, Job->TotalSize, Elapsed));
+				Job->Request.OnComplete.ExecuteIfBound(true, Job->Request.TargetPath);
+			}
+			else
+			{
+				UCPM_UtilityLibrary::CPM_LogMessage(FString::Printf(TEXT("Download of %s failed: %s"), *Job->Request.TargetPath, *Error), ECPM_LogLevel::Error);
+				Job->Request.OnComplete.ExecuteIfBound(false, Error);
+			}
+		});
+	});
+}
+
+void FCPM_DownloadManager::FailJob(const TSharedRef<FCPM_DownloadJob>& Job, const FString& Reason)
+{
+	Job->bFailed = true;
+	CancelActiveRequests(*Job);
+
+	// The part file and its manifest stay on disk so the next attempt resumes
+	ResetPartFile(*Job, /*bReopen*/false);
+
+	Jobs.Remove(Job->Id);
+	JobOrder.Remove(Job->Id);
+
+	UCPM_UtilityLibrary::CPM_LogMessage(FString::Printf(TEXT("Download of %s failed: %s"), *Job->Request.TargetPath, *Reason), ECPM_LogLevel::Error);
+	Job->Request.OnComplete.ExecuteIfBound(false, Reason);
+}
+
+void FCPM_DownloadManager::BroadcastProgress(const TSharedRef<FCPM_DownloadJob>& Job)
+{
+	const double Now = FPlatformTime::Seconds();
+	const bool bComplete = Job->TotalSize >= 0 && Job->BytesOnDisk >= Job->TotalSize;
+	if (!bComplete && Now - Job->LastProgressTime < ProgressBroadcastInterval)
+	{
+		return;
+	}
+	Job->LastProgressTime = Now;
+
+	FCPM_DownloadProgress Progress;
+	Progress.BytesReceived = Job->BytesOnDisk;
+	Progress.TotalBytes = FMath::Max<int64>(0, Job->TotalSize);
+	Progress.Progress = Job->TotalSize > 0 ? static_cast<float>(static_cast<double>(Job->BytesOnDisk) / Job->TotalSize) : (bComplete ? 1.f : 0.f);
+	Progress.BytesPerSecond = static_cast<float>(Job->BytesThisSession / FMath::Max(Now - Job->StartTime, 0.001));
+	Job->Request.OnProgress.ExecuteIfBound(Progress);
+}
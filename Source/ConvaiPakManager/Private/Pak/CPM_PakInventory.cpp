@@ -0,0 +1,239 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Pak/CPM_PakInventory.h"
+#include "Pak/CPM_PakReader.h"
+#include "IPlatformFilePak.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "JsonObjectConverter.h"
+#include "Misc/App.h"
+#include "Misc/FileHelper.h"
+#include "Misc/PackageName.h"
+#include "Utility/CPM_UtilityLibrary.h"
+
+namespace
+{
+	void AddToBucket(TMap<FString, FCPM_PakSizeBucket>& Buckets, const FString& Key, const FCPM_PakInventoryEntry& Entry)
+	{
+		FCPM_PakSizeBucket& Bucket = Buckets.FindOrAdd(Key);
+		Bucket.Key = Key;
+		Bucket.NumEntries++;
+		Bucket.UncompressedSize += Entry.UncompressedSize;
+		Bucket.CompressedSize += Entry.CompressedSize;
+	}
+
+	TArray<FCPM_PakSizeBucket> SortedBuckets(const TMap<FString, FCPM_PakSizeBucket>& Buckets)
+	{
+		TArray<FCPM_PakSizeBucket> Result;
+		Buckets.GenerateValueArray(Result);
+		Result.Sort([](const FCPM_PakSizeBucket& A, const FCPM_PakSizeBucket& B)
+		{
+			return A.CompressedSize > B.CompressedSize;
+		});
+		return Result;
+	}
+
+	/** Class of the main asset in a package, e.g. StaticMesh or Texture2D */
+	FString GetPackageAssetClass(const FString& PackageName)
+	{
+		TArray<FAssetData> Assets;
+		FAssetRegistryModule::GetRegistry().GetAssetsByPackageName(*PackageName, Assets, true);
+		if (Assets.Num() == 0)
+		{
+			return TEXT("Unknown");
+		}
+
+		const FString ShortName = FPackageName::GetShortName(PackageName);
+		const FAssetData* MainAsset = Assets.FindByPredicate([&ShortName](const FAssetData& Asset)
+		{
+			return Asset.AssetName.ToString() == ShortName;
+		});
+		return (MainAsset ? *MainAsset : Assets[0]).AssetClassPath.GetAssetName().ToString();
+	}
+
+	FString CsvEscape(const FString& Value)
+	{
+		if (!Value.Contains(TEXT(",")) && !Value.Contains(TEXT("\"")))
+		{
+			return Value;
+		}
+		return FString::Printf(TEXT("\"%s\""), *Value.Replace(TEXT("\""), TEXT("\"\"")));
+	}
+}
+
+bool FCPM_PakInventoryBuilder::Build(const FString& PakFilePath, FCPM_PakInventory& OutInventory)
+{
+	OutInventory = FCPM_PakInventory();
+	OutInventory.PakFilePath = PakFilePath;
+
+	const TRefCountPtr<FPakFile> PakFile = FCPM_PakReader::OpenUnmounted(PakFilePath);
+	if (!PakFile.IsValid())
+	{
+		UCPM_UtilityLibrary::CPM_LogMessage(FString::Printf(TEXT("Failed to read pak index: %s"), *PakFilePath), ECPM_LogLevel::Error);
+		return false;
+	}
+
+	const FPakInfo& Info = PakFile->GetInfo();
+	OutInventory.FileSize = PakFile->TotalSize();
+
+	TMap<FString, FString> PackageClasses;
+	TMap<FString, FCPM_PakSizeBucket> FolderBuckets;
+	TMap<FString, FCPM_PakSizeBucket> ClassBuckets;
+
+	OutInventory.Entries.Reserve(PakFile->GetNumFiles());
+	for (FPakFile::FFilenameIterator It(*PakFile); It; ++It)
+	{
+		const FPakEntry& PakEntry = It.Info();
+
+		FCPM_PakInventoryEntry& Entry = OutInventory.Entries.AddDefaulted_GetRef();
+		Entry.Filename = PakFile->GetMountPoint() / It.Filename();
+		Entry.UncompressedSize = PakEntry.UncompressedSize;
+		Entry.CompressedSize = PakEntry.Size;
+		Entry.CompressionMethod = Info.GetCompressionMethod(PakEntry.CompressionMethodIndex).ToString();
+
+		Entry.PackageName = FilenameToPackageName(Entry.Filename);
+		if (Entry.PackageName.IsEmpty())
+		{
+			Entry.Folder = FPaths::GetPath(Entry.Filename);
+			Entry.AssetClass = FString::Printf(TEXT("*.%s"), *FPaths::GetExtension(Entry.Filename));
+		}
+		else
+		{
+			Entry.Folder = FPackageName::GetLongPackagePath(Entry.PackageName);
+			if (const FString* CachedClass = PackageClasses.Find(Entry.PackageName))
+			{
+				Entry.AssetClass = *CachedClass;
+			}
+			else
+			{
+				Entry.AssetClass = PackageClasses.Add(Entry.PackageName, GetPackageAssetClass(Entry.PackageName));
+			}
+		}
+
+		OutInventory.TotalUncompressedSize += Entry.UncompressedSize;
+		OutInventory.TotalCompressedSize += Entry.CompressedSize;
+		AddToBucket(FolderBuckets, Entry.Folder, Entry);
+		AddToBucket(ClassBuckets, Entry.AssetClass, Entry);
+	}
+
+	OutInventory.Entries.Sort([](const FCPM_PakInventoryEntry& A, const FCPM_PakInventoryEntry& B)
+	{
+		return A.CompressedSize > B.CompressedSize;
+	});
+	OutInventory.ByFolder = SortedBuckets(FolderBuckets);
+	OutInventory.ByAssetClass = SortedBuckets(ClassBuckets);
+	return true;
+}
+
+FCPM_PakInventoryDiff FCPM_PakInventoryBuilder::Diff(const FCPM_PakInventory& OldInventory, const FCPM_PakInventory& NewInventory)
+{
+	FCPM_PakInventoryDiff Result;
+
+	TMap<FString, const FCPM_PakInventoryEntry*> OldEntries;
+	OldEntries.Reserve(OldInventory.Entries.Num());
+	for (const FCPM_PakInventoryEntry& Entry : OldInventory.Entries)
+	{
+		OldEntries.Add(Entry.Filename, &Entry);
+	}
+
+	for (const FCPM_PakInventoryEntry& Entry : NewInventory.Entries)
+	{
+		const FCPM_PakInventoryEntry* OldEntry = nullptr;
+		OldEntries.RemoveAndCopyValue(Entry.Filename, OldEntry);
+
+		if (!OldEntry)
+		{
+			Result.Added.Add({ Entry.Filename, 0, Entry.CompressedSize, Entry.CompressedSize });
+		}
+		else if (OldEntry->CompressedSize != Entry.CompressedSize)
+		{
+			Result.Changed.Add({ Entry.Filename, OldEntry->CompressedSize, Entry.CompressedSize, Entry.CompressedSize - OldEntry->CompressedSize });
+		}
+	}
+
+	for (const TPair<FString, const FCPM_PakInventoryEntry*>& Pair : OldEntries)
+	{
+		Result.Removed.Add({ Pair.Key, Pair.Value->CompressedSize, 0, -Pair.Value->CompressedSize });
+	}
+
+	auto SortByDelta = [](TArray<FCPM_PakEntryDelta>& Deltas)
+	{
+		Deltas.Sort([](const FCPM_PakEntryDelta& A, const FCPM_PakEntryDelta& B)
+		{
+			return FMath::Abs(A.Delta) > FMath::Abs(B.Delta);
+		});
+	};
+	SortByDelta(Result.Added);
+	SortByDelta(Result.Removed);
+	SortByDelta(Result.Changed);
+
+	Result.TotalDelta = NewInventory.TotalCompressedSize - OldInventory.TotalCompressedSize;
+	return Result;
+}
+
+bool FCPM_PakInventoryBuilder::ExportJson(const FCPM_PakInventory& Inventory, const FString& OutFilePath)
+{
+	FString JsonString;
+	if (!FJsonObjectConverter::UStructToJsonObjectString(Inventory, JsonString))
+	{
+		return false;
+	}
+	return FFileHelper::SaveStringToFile(JsonString, *OutFilePath);
+}
+
+bool FCPM_PakInventoryBuilder::ExportCsv(const FCPM_PakInventory& Inventory, const FString& OutFilePath)
+{
+	FString Csv = TEXT("Filename,PackageName,Folder,AssetClass,CompressionMethod,UncompressedSize,CompressedSize\n");
+	for (const FCPM_PakInventoryEntry& Entry : Inventory.Entries)
+	{
+		Csv += FString::Printf(TEXT("%s,%s,%s,%s,%s,%lld,%lld\n"),
+			*CsvEscape(Entry.Filename), *CsvEscape(Entry.PackageName), *CsvEscape(Entry.Folder), *CsvEscape(Entry.AssetClass),
+			*Entry.CompressionMethod, Entry.UncompressedSize, Entry.CompressedSize);
+	}
+	return FFileHelper::SaveStringToFile(Csv, *OutFilePath);
+}
+
+FString FCPM_PakInventoryBuilder::FilenameToPackageName(const FString& Filename)
+{
+	static const TCHAR* ContentFolder = TEXT("/Content/");
+
+	FString NormalizedFilename = Filename;
+	FPaths::NormalizeFilename(NormalizedFilename);
+
+	const int32 ContentIndex = NormalizedFilename.Find(ContentFolder, ESearchCase::IgnoreCase, ESearchDir::FromEnd);
+	if (ContentIndex == INDEX_NONE)
+	{
+		return FString();
+	}
+
+	// The folder owning Content is the project, the engine or a plugin, each has its own package root
+	const FString RootPath = NormalizedFilename.Left(ContentIndex);
+	const FString RootName = FPaths::GetCleanFilename(RootPath);
+	FString PackageRoot;
+	if (RootName == FApp::GetProjectName())
+	{
+		PackageRoot = TEXT("/Game");
+	}
+	else
+	{
+		PackageRoot = TEXT("/") + RootName;
+	}
+
+	FString RelativePath = NormalizedFilename.Mid(ContentIndex + FCString::Strlen(ContentFolder));
+	static const TArray<FString> PackageExtensions = { TEXT("uasset"), TEXT("umap"), TEXT("uexp"), TEXT("ubulk"), TEXT("uptnl") };
+	if (!PackageExtensions.Contains(FPaths::GetExtension(RelativePath)))
+	{
+		return FString();
+	}
+
+	// Strip every extension of the file name so Foo.m.ubulk lands on the same package as Foo.uasset,
+	// folder names like V1.2 keep their dots
+	int32 SlashIndex = INDEX_NONE;
+	RelativePath.FindLastChar(TEXT('/'), SlashIndex);
+	const int32 DotIndex = RelativePath.Find(TEXT("."), ESearchCase::CaseSensitive, ESearchDir::FromStart, SlashIndex + 1);
+	if (DotIndex != INDEX_NONE)
+	{
+		RelativePath.LeftInline(DotIndex);
+	}
+	return PackageRoot / RelativePath;
+}
@@ -0,0 +1,189 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Pak/CPM_PakReader.h"
+#include "IPlatformFilePak.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/ScopeExit.h"
+#include "Misc/SecureHash.h"
+#include "Serialization/MemoryReader.h"
+
+namespace
+{
+	bool ReadRegion(FArchive& Reader, const int64 Offset, const int64 Size, TArray<uint8>& OutData)
+	{
+		if (Offset < 0 || Size < 0 || Offset + Size > Reader.TotalSize() || Size > MAX_int32)
+		{
+			return false;
+		}
+
+		OutData.SetNumUninitialized(Size);
+		Reader.Seek(Offset);
+		Reader.Serialize(OutData.GetData(), Size);
+		return !Reader.IsError();
+	}
+
+	bool HashMatches(const TArray<uint8>& Data, const FSHAHash& Expected)
+	{
+		FSHAHash Computed;
+		FSHA1::HashBuffer(Data.GetData(), Data.Num(), Computed.Hash);
+		return Computed == Expected;
+	}
+
+	/** Verifies one of the secondary (path hash / full directory) indices referenced by the primary index */
+	void ValidateSecondaryIndex(FArchive& Reader, const TCHAR* Name, const int64 Offset, const int64 Size, const FSHAHash& Hash, FCPM_PakValidationReport& OutReport)
+	{
+		TArray<uint8> Data;
+		if (!ReadRegion(Reader, Offset, Size, Data))
+		{
+			OutReport.Errors.Add(FString::Printf(TEXT("%s is out of bounds (offset %lld, size %lld)"), Name, Offset, Size));
+			OutReport.bIndexHashValid = false;
+		}
+		else if (!HashMatches(Data, Hash))
+		{
+			OutReport.Errors.Add(FString::Printf(TEXT("%s hash mismatch"), Name));
+			OutReport.bIndexHashValid = false;
+		}
+	}
+}
+
+bool FCPM_PakReader::ReadPakInfo(FArchive& Reader, FPakInfo& OutInfo)
+{
+	const int64 TotalSize = Reader.TotalSize();
+	for (int32 CompatibleVersion = FPakInfo::PakFile_Version_Latest; CompatibleVersion > 0; --CompatibleVersion)
+	{
+		const int64 InfoPosition = TotalSize - OutInfo.GetSerializedSize(CompatibleVersion);
+		if (InfoPosition < 0)
+		{
+			continue;
+		}
+
+		Reader.Seek(InfoPosition);
+		OutInfo.Serialize(Reader, CompatibleVersion);
+		if (!Reader.IsError() && OutInfo.Magic == FPakInfo::PakFile_Magic)
+		{
+			return true;
+		}
+		Reader.ClearError();
+	}
+	return false;
+}
+
+bool FCPM_PakReader::Validate(const FString& PakFilePath, FCPM_PakValidationReport& OutReport)
+{
+	const double StartTime = FPlatformTime::Seconds();
+	OutReport = FCPM_PakValidationReport();
+
+	ON_SCOPE_EXIT
+	{
+		OutReport.bValid = OutReport.Errors.Num() == 0;
+		OutReport.ElapsedMilliseconds = static_cast<float>((FPlatformTime::Seconds() - StartTime) * 1000.0);
+	};
+
+	const TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*PakFilePath));
+	if (!Reader.IsValid())
+	{
+		OutReport.Errors.Add(FString::Printf(TEXT("Pak file does not exist or cannot be opened: %s"), *PakFilePath));
+		return false;
+	}
+	OutReport.FileSize = Reader->TotalSize();
+
+	FPakInfo Info;
+	if (!ReadPakInfo(*Reader, Info))
+	{
+		OutReport.Errors.Add(TEXT("No pak footer with a valid magic was found"));
+		return false;
+	}
+
+	OutReport.bMagicValid = true;
+	OutReport.Version = Info.Version;
+	OutReport.bVersionSupported = Info.Version >= FPakInfo::PakFile_Version_Initial && Info.Version <= FPakInfo::PakFile_Version_Latest;
+	OutReport.bIndexEncrypted = Info.bEncryptedIndex != 0;
+	OutReport.IndexOffset = Info.IndexOffset;
+	OutReport.IndexSize = Info.IndexSize;
+	OutReport.IndexHash = Info.IndexHash.ToString();
+	for (const FName& Method : Info.CompressionMethods)
+	{
+		OutReport.CompressionMethods.Add(Method.ToString());
+	}
+
+	if (!OutReport.bVersionSupported)
+	{
+		OutReport.Errors.Add(FString::Printf(TEXT("Unsupported pak version %d (latest known is %d)"), Info.Version, static_cast<int32>(FPakInfo::PakFile_Version_Latest)));
+		return false;
+	}
+
+	TArray<uint8> PrimaryIndex;
+	if (!ReadRegion(*Reader, Info.IndexOffset, Info.IndexSize, PrimaryIndex))
+	{
+		OutReport.Errors.Add(FString::Printf(TEXT("Index is out of bounds (offset %lld, size %lld, file %lld)"), Info.IndexOffset, Info.IndexSize, OutReport.FileSize));
+		return false;
+	}
+
+	if (OutReport.bIndexEncrypted)
+	{
+		// The index hash covers the decrypted bytes, there is nothing more we can check without the key
+		return true;
+	}
+
+	OutReport.bIndexHashVerified = true;
+	OutReport.bIndexHashValid = HashMatches(PrimaryIndex, Info.IndexHash);
+	if (!OutReport.bIndexHashValid)
+	{
+		OutReport.Errors.Add(TEXT("Index hash mismatch"));
+		return false;
+	}
+
+	FMemoryReader IndexReader(PrimaryIndex);
+	IndexReader << OutReport.MountPoint;
+	IndexReader << OutReport.NumEntries;
+
+	if (Info.Version >= FPakInfo::PakFile_Version_PathHashIndex)
+	{
+		uint64 PathHashSeed = 0;
+		IndexReader << PathHashSeed;
+
+		bool bHasPathHashIndex = false;
+		IndexReader << bHasPathHashIndex;
+		if (bHasPathHashIndex)
+		{
+			int64 Offset = 0, Size = 0;
+			FSHAHash Hash;
+			IndexReader << Offset << Size << Hash;
+			ValidateSecondaryIndex(*Reader, TEXT("Path hash index"), Offset, Size, Hash, OutReport);
+		}
+
+		bool bHasFullDirectoryIndex = false;
+		IndexReader << bHasFullDirectoryIndex;
+		if (bHasFullDirectoryIndex)
+		{
+			int64 Offset = 0, Size = 0;
+			FSHAHash Hash;
+			IndexReader << Offset << Size << Hash;
+			ValidateSecondaryIndex(*Reader, TEXT("Directory index"), Offset, Size, Hash, OutReport);
+		}
+	}
+
+	if (IndexReader.IsError() || OutReport.NumEntries < 0)
+	{
+		OutReport.Errors.Add(TEXT("Index could not be decoded"));
+	}
+
+	return OutReport.Errors.Num() == 0;
+}
+
+TRefCountPtr<FPakFile> FCPM_PakReader::OpenUnmounted(const FString& PakFilePath)
+{
+	if (!FPaths::FileExists(PakFilePath))
+	{
+		return nullptr;
+	}
+
+	TRefCountPtr<FPakFile> PakFile = new FPakFile(&FPlatformFileManager::Get().GetPlatformFile(), *PakFilePath, false, true);
+	if (!PakFile->IsValid() || !PakFile->HasFilenames())
+	{
+		return nullptr;
+	}
+	return PakFile;
+}
@@ -0,0 +1,229 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Pak/CPM_PakVerifier.h"
+#include "Pak/CPM_PakReader.h"
+#include "IPlatformFilePak.h"
+#include "Async/MappedFileHandle.h"
+#include "Async/ParallelFor.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/Compression.h"
+#include "Misc/ScopeExit.h"
+#include "Misc/SecureHash.h"
+#include "Serialization/MemoryReader.h"
+#include "Utility/CPM_UtilityLibrary.h"
+
+namespace
+{
+	struct FVerifyEntry
+	{
+		FString Filename;
+		FPakEntry Entry;
+	};
+
+	/** One unit of parallel work, either the hash of a whole entry or the decompression of one of its blocks */
+	struct FVerifyWorkItem
+	{
+		int32 EntryIndex = INDEX_NONE;
+		int32 BlockIndex = INDEX_NONE;
+	};
+
+	/** Hands out byte ranges of the pak, straight from the mapping when there is one */
+	class FPakBytes
+	{
+	public:
+		explicit FPakBytes(const FString& InPakFilePath)
+			: PakFilePath(InPakFilePath)
+		{
+			IPlatformFile& PlatformFile = IPlatformFile::GetPlatformPhysical();
+			MappedFile.Reset(PlatformFile.OpenMapped(*PakFilePath));
+			if (MappedFile.IsValid())
+			{
+				MappedRegion.Reset(MappedFile->MapRegion(0, MappedFile->GetFileSize()));
+			}
+			FileSize = MappedRegion.IsValid() ? MappedRegion->GetMappedSize() : PlatformFile.FileSize(*PakFilePath);
+		}
+
+		~FPakBytes()
+		{
+			// The region has to go before the handle it was mapped from
+			MappedRegion.Reset();
+			MappedFile.Reset();
+		}
+
+		bool IsMapped() const { return MappedRegion.IsValid(); }
+		int64 GetFileSize() const { return FileSize; }
+
+		/** Returns a pointer to [Offset, Offset + Size), using Scratch when the file is not mapped */
+		const uint8* Read(const int64 Offset, const int64 Size, TArray<uint8>& Scratch) const
+		{
+			if (Offset < 0 || Size < 0 || Offset + Size > FileSize)
+			{
+				return nullptr;
+			}
+
+			if (MappedRegion.IsValid())
+			{
+				return MappedRegion->GetMappedPtr() + Offset;
+			}
+
+			const TUniquePtr<IFileHandle> Handle(IPlatformFile::GetPlatformPhysical().OpenRead(*PakFilePath));
+			Scratch.SetNumUninitialized(Size);
+			if (!Handle.IsValid() || !Handle->Seek(Offset) || !Handle->Read(Scratch.GetData(), Size))
+			{
+				return nullptr;
+			}
+			return Scratch.GetData();
+		}
+
+	private:
+		FString PakFilePath;
+		TUniquePtr<IMappedFileHandle> MappedFile;
+		TUniquePtr<IMappedFileRegion> MappedRegion;
+		int64 FileSize = 0;
+	};
+}
+
+bool FCPM_PakVerifier::Verify(const FString& PakFilePath, FCPM_PakVerifyReport& OutReport)
+{
+	const double StartTime = FPlatformTime::Seconds();
+	OutReport = FCPM_PakVerifyReport();
+
+	ON_SCOPE_EXIT
+	{
+		OutReport.ElapsedSeconds = static_cast<float>(FPlatformTime::Seconds() - StartTime);
+		OutReport.MegabytesPerSecond = OutReport.ElapsedSeconds > 0.f
+			? static_cast<float>(OutReport.BytesVerified / (1024.0 * 1024.0) / OutReport.ElapsedSeconds)
+			: 0.f;
+		OutReport.bValid = OutReport.Errors.Num() == 0 && OutReport.CorruptEntries.Num() == 0;
+	};
+
+	const TRefCountPtr<FPakFile> PakFile = FCPM_PakReader::OpenUnmounted(PakFilePath);
+	if (!PakFile.IsValid())
+	{
+		OutReport.Errors.Add(FString::Printf(TEXT("Failed to read pak index: %s"), *PakFilePath));
+		return false;
+	}
+
+	const FPakInfo& Info = PakFile->GetInfo();
+	const bool bRelativeBlockOffsets = Info.Version >= FPakInfo::PakFile_Version_RelativeChunkOffsets;
+
+	TArray<FVerifyEntry> Entries;
+	Entries.Reserve(PakFile->GetNumFiles());
+	for (FPakFile::FFilenameIterator It(*PakFile); It; ++It)
+	{
+		Entries.Add({ PakFile->GetMountPoint() / It.Filename(), It.Info() });
+	}
+
+	TArray<FVerifyWorkItem> WorkItems;
+	WorkItems.Reserve(Entries.Num());
+	for (int32 EntryIndex = 0; EntryIndex < Entries.Num(); ++EntryIndex)
+	{
+		const FPakEntry& Entry = Entries[EntryIndex].Entry;
+		if (Entry.IsEncrypted())
+		{
+			++OutReport.NumSkippedEntries;
+			continue;
+		}
+
+		WorkItems.Add({ EntryIndex, INDEX_NONE });
+		OutReport.BytesVerified += Entry.Size;
+
+		if (Entry.CompressionMethodIndex != 0)
+		{
+			for (int32 BlockIndex = 0; BlockIndex < Entry.CompressionBlocks.Num(); ++BlockIndex)
+			{
+				WorkItems.Add({ EntryIndex, BlockIndex });
+			}
+			OutReport.NumCompressedBlocks += Entry.CompressionBlocks.Num();
+		}
+	}
+	OutReport.NumEntries = Entries.Num();
+
+	const FPakBytes PakBytes(PakFilePath);
+	OutReport.bMemoryMapped = PakBytes.IsMapped();
+
+	FCriticalSection CorruptMutex;
+	auto ReportCorrupt = [&CorruptMutex, &OutReport](const FVerifyEntry& VerifyEntry, const int64 Offset, const int64 Size, const FString& Reason)
+	{
+		FScopeLock Lock(&CorruptMutex);
+		OutReport.CorruptEntries.Add({ VerifyEntry.Filename, Offset, Size, Reason });
+	};
+
+	ParallelFor(WorkItems.Num(), [&](const int32 WorkIndex)
+	{
+		const FVerifyWorkItem& Item = WorkItems[WorkIndex];
+		const FVerifyEntry& VerifyEntry = Entries[Item.EntryIndex];
+		const FPakEntry& Entry = VerifyEntry.Entry;
+		TArray<uint8> Scratch;
+
+		if (Item.BlockIndex == INDEX_NONE)
+		{
+			// Every entry is preceded by a copy of its index record, the payload hash only lives there
+			const int64 HeaderSize = Entry.GetSerializedSize(Info.Version);
+			const uint8* HeaderData = PakBytes.Read(Entry.Offset, HeaderSize, Scratch);
+			if (!HeaderData)
+			{
+				ReportCorrupt(VerifyEntry, Entry.Offset, Entry.Size, TEXT("Entry is out of bounds"));
+				return;
+			}
+
+			FPakEntry Header;
+			FMemoryReaderView HeaderReader(MakeArrayView(HeaderData, HeaderSize));
+			Header.Serialize(HeaderReader, Info.Version);
+			if (HeaderReader.IsError() || !Header.IndexDataEquals(Entry))
+			{
+				ReportCorrupt(VerifyEntry, Entry.Offset, Entry.Size, TEXT("Entry header does not match the index"));
+				return;
+			}
+
+			const uint8* Payload = PakBytes.Read(Entry.Offset + HeaderSize, Entry.Size, Scratch);
+			if (!Payload)
+			{
+				ReportCorrupt(VerifyEntry, Entry.Offset, Entry.Size, TEXT("Entry payload is out of bounds"));
+				return;
+			}
+
+			uint8 Hash[20];
+			FSHA1::HashBuffer(Payload, Entry.Size, Hash);
+			if (FMemory::Memcmp(Hash, Header.Hash, sizeof(Hash)) != 0)
+			{
+				ReportCorrupt(VerifyEntry, Entry.Offset, Entry.Size, TEXT("Entry hash mismatch"));
+			}
+			return;
+		}
+
+		const FPakCompressedBlock& Block = Entry.CompressionBlocks[Item.BlockIndex];
+		const int64 BlockOffset = (bRelativeBlockOffsets ? Entry.Offset : 0) + Block.CompressedStart;
+		const int64 BlockSize = Block.CompressedEnd - Block.CompressedStart;
+		const int64 BlockUncompressedSize = FMath::Min<int64>(Entry.CompressionBlockSize, Entry.UncompressedSize - static_cast<int64>(Item.BlockIndex) * Entry.CompressionBlockSize);
+
+		const uint8* Compressed = PakBytes.Read(BlockOffset, BlockSize, Scratch);
+		if (!Compressed || BlockUncompressedSize <= 0)
+		{
+			ReportCorrupt(VerifyEntry, BlockOffset, BlockSize, FString::Printf(TEXT("Block %d is out of bounds"), Item.BlockIndex));
+			return;
+		}
+
+		TArray<uint8> Uncompressed;
+		Uncompressed.SetNumUninitialized(BlockUncompressedSize);
+		const FName Method = Info.GetCompressionMethod(Entry.CompressionMethodIndex);
+		if (!FCompression::UncompressMemory(Method, Uncompressed.GetData(), BlockUncompressedSize, Compressed, BlockSize))
+		{
+			ReportCorrupt(VerifyEntry, BlockOffset, BlockSize, FString::Printf(TEXT("Block %d failed to decompress with %s"), Item.BlockIndex, *Method.ToString()));
+		}
+	}, EParallelForFlags::Unbalanced);
+
+	OutReport.CorruptEntries.Sort([](const FCPM_PakCorruptEntry& A, const FCPM_PakCorruptEntry& B)
+	{
+		return A.Offset < B.Offset;
+	});
+
+	const double Elapsed = FPlatformTime::Seconds() - StartTime;
+	UCPM_UtilityLibrary::CPM_LogMessage(FString::Printf(TEXT("Verified %d entries (%d compressed blocks) of %s in %.2fs, %.1f MB/s, %d corrupt"),
+		OutReport.NumEntries, OutReport.NumCompressedBlocks, *PakFilePath, Elapsed,
+		Elapsed > 0.0 ? OutReport.BytesVerified / (1024.0 * 1024.0) / Elapsed : 0.0, OutReport.CorruptEntries.Num()),
+		OutReport.CorruptEntries.Num() > 0 ? ECPM_LogLevel::Error : ECPM_LogLevel::Log);
+
+	return OutReport.CorruptEntries.Num() == 0;
+}
@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Proxy/CPM_DownloadProxy.h"
+
+UCPM_DownloadFileProxy* UCPM_DownloadFileProxy::DownloadFileProxy(const FString& URL, const FString& TargetPath, const FString& ExpectedMD5, UCPM_DownloadFileProxy*& OutProxy)
+{
+	UCPM_DownloadFileProxy* Proxy = NewObject<UCPM_DownloadFileProxy>();
+	Proxy->M_URL = URL;
+	Proxy->M_TargetPath = TargetPath;
+	Proxy->M_ExpectedMD5 = ExpectedMD5;
+	OutProxy = Proxy;
+	return Proxy;
+}
+
+void UCPM_DownloadFileProxy::Activate()
+{
+	AddToRoot();
+
+	TWeakObjectPtr<UCPM_DownloadFileProxy> WeakThis(this);
+
+	FCPM_DownloadRequest Request;
+	Request.URL = M_URL;
+	Request.TargetPath = M_TargetPath;
+	Request.ExpectedMD5 = M_ExpectedMD5;
+	Request.OnProgress.BindLambda([WeakThis](const FCPM_DownloadProgress& Progress)
+	{
+		if (WeakThis.IsValid())
+		{
+			WeakThis->M_LastProgress = Progress;
+			WeakThis->OnProgress.Broadcast(WeakThis->M_TargetPath, Progress);
+		}
+	});
+	Request.OnComplete.BindLambda([WeakThis](const bool bSuccess, const FString& PathOrError)
+	{
+		if (!WeakThis.IsValid())
+		{
+			return;
+		}
+
+		UCPM_DownloadFileProxy* Proxy = WeakThis.Get();
+		if (bSuccess)
+		{
+			Proxy->OnSuccess.Broadcast(PathOrError, Proxy->M_LastProgress);
+		}
+		else
+		{
+			Proxy->OnFailure.Broadcast(PathOrError, Proxy->M_LastProgress);
+		}
+
+		Proxy->RemoveFromRoot();
+		Proxy->SetReadyToDestroy();
+	});
+
+	M_DownloadId = FCPM_DownloadManager::Get().StartDownload(Request);
+}
+
+void UCPM_DownloadFileProxy::CancelDownload(const bool bDeletePartialFile)
+{
+	FCPM_DownloadManager::Get().CancelDownload(M_DownloadId, bDeletePartialFile);
+}
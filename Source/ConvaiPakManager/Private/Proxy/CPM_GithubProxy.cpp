@@ -2,6 +2,7 @@
 
 
 #include "Proxy/CPM_GithubProxy.h"
+#include "Utility/CPM_HttpCache.h"
 
 UCPM_GetGithubRepoFileProxy* UCPM_GetGithubRepoFileProxy::GetGithubRepoFileProxy(
 	const FString& GithubRepoName, const FString& BranchName, const FString& FileName)
@@ -11,12 +12,34 @@ UCPM_GetGithubRepoFileProxy* UCPM_GetGithubRepoFileProxy::GetGithubRepoFileProxy
 	return Proxy;
 }
 
+void UCPM_GetGithubRepoFileProxy::Activate()
+{
+	FString CachedBody;
+	if (FCPM_HttpCache::Get().TryGetFresh(URL, CachedBody))
+	{
+		ResponseString = CachedBody;
+		OnSuccess.Broadcast(ResponseString);
+		return;
+	}
+
+	if (FCPM_HttpCache::Get().IsOfflineMode())
+	{
+		OnFailure.Broadcast(ResponseString);
+		return;
+	}
+
+	Super::Activate();
+}
+
 bool UCPM_GetGithubRepoFileProxy::ConfigureRequest(TSharedRef<IConvaihttpRequest> Request, const TCHAR* Verb)
 {
 	if (!Super::ConfigureRequest(Request, ConvaiHttpConstants::GET))
 	{
 		return false;
 	}
+
+	ActiveHttpRequest = Request;
+	FCPM_HttpCache::Get().AddConditionalHeaders(URL, Request);
 	
 	// Request->OnRequestProgress().BindLambda(
 	// [&](CONVAI_HTTP_REQUEST_PTR InRequest, CONVAI_HTTP_DOWN_PROGRESS_TYPE BytesSent, CONVAI_HTTP_DOWN_PROGRESS_TYPE BytesReceived)
@@ -33,12 +56,23 @@ bool UCPM_GetGithubRepoFileProxy::ConfigureRequest(TSharedRef<IConvaihttpRequest
 void UCPM_GetGithubRepoFileProxy::HandleSuccess()
 {
 	Super::HandleSuccess();
+	FCPM_HttpCache::Get().ResolveResponse(URL, ActiveHttpRequest, ResponseString);
+	ActiveHttpRequest.Reset();
 	OnSuccess.Broadcast(ResponseString);
 }
 
 void UCPM_GetGithubRepoFileProxy::HandleFailure()
 {
 	Super::HandleFailure();
+
+	// 304 Not Modified and offline failures are answered from the cache
+	const bool bServedFromCache = FCPM_HttpCache::Get().ResolveResponse(URL, ActiveHttpRequest, ResponseString);
+	ActiveHttpRequest.Reset();
+	if (bServedFromCache)
+	{
+		OnSuccess.Broadcast(ResponseString);
+		return;
+	}
 	OnFailure.Broadcast(ResponseString);
 }
 
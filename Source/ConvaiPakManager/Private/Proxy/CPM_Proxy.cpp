@@ -5,8 +5,10 @@
 #include "HAL/PlatformFileManager.h"
 #include "Misc/FileHelper.h"
 #include "Misc/Paths.h"
+#include "Misc/SecureHash.h"
 #include "Engine/Texture2D.h"
 #include "Utility/CPM_UtilityLibrary.h"
+#include "Utility/CPM_HttpCache.h"
 #include "ConvaiUtils.h"
 
 namespace
@@ -15,6 +17,14 @@ namespace
     static FString UpdatePakAssetURL() { return UConvaiURL::GetFullURL(TEXT("assets/update"), true); }
     static FString GetPakAssetURL()    { return UConvaiURL::GetFullURL(TEXT("assets/get"), true); }
     static FString DeletePakAssetURL() { return UConvaiURL::GetFullURL(TEXT("assets/delete"), true); }
+
+    // Keyed by the auth identity too, a response cached for one account or experience session is never served to another
+    static FString AssetMetaDataCacheKey(const FString& AssetID)
+    {
+        const TPair<FString, FString> AuthHeaderAndKey = UConvaiUtils::GetAuthHeaderAndKey();
+        const FString AuthIdentity = FMD5::HashAnsiString(*(AuthHeaderAndKey.Key + TEXT(":") + AuthHeaderAndKey.Value));
+        return GetPakAssetURL() + TEXT("|") + AuthIdentity + TEXT("|") + AssetID;
+    }
 }
 
 
@@ -167,6 +177,7 @@ UCPM_UpdatePakAssetProxy* UCPM_UpdatePakAssetProxy::UpdatePakAssetProxy(const FS
 void UCPM_UpdatePakAssetProxy::HandleSuccess()
 {
 	Super::HandleSuccess();
+	FCPM_HttpCache::Get().Remove(AssetMetaDataCacheKey(M_AssetId));
 
 	TSharedPtr<FJsonObject> JsonObject;
 	const TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(ResponseString);
@@ -299,6 +310,23 @@ UCPM_GetAssetMetaDataProxy* UCPM_GetAssetMetaDataProxy::GetAssetProxy(UObject* W
     return Proxy;
 }
 
+void UCPM_GetAssetMetaDataProxy::Activate()
+{
+	// A cached body that no longer parses was dropped by BroadcastResponse, the server is asked instead
+	if (FCPM_HttpCache::Get().TryGetFresh(AssetMetaDataCacheKey(AssociatedAssetIdD), ResponseString) && BroadcastResponse())
+	{
+		return;
+	}
+
+	if (FCPM_HttpCache::Get().IsOfflineMode())
+	{
+		OnFailure.Broadcast(FCPM_AssetResponse(), ResponseString);
+		return;
+	}
+
+	Super::Activate();
+}
+
 bool UCPM_GetAssetMetaDataProxy::ConfigureRequest(TSharedRef<CONVAI_HTTP_REQUEST_INTERFACE> Request, const TCHAR* Verb)
 {
     if (!Super::ConfigureRequest(Request, ConvaiHttpConstants::POST))
@@ -306,6 +334,10 @@ bool UCPM_GetAssetMetaDataProxy::ConfigureRequest(TSharedRef<CONVAI_HTTP_REQUEST
         return false;
     }
 
+	// assets/get is a POST, where If-None-Match / If-Modified-Since are preconditions (412) rather than
+	// revalidation (304). No conditional headers are sent, the cache only answers while an entry is fresh
+	// or when the server cannot be reached.
+	ActiveHttpRequest = Request;
     return true;
 } 
 
@@ -316,6 +348,8 @@ bool UCPM_GetAssetMetaDataProxy::AddContentToRequestAsString(TSharedPtr<FJsonObj
 
 	if (!UConvaiFormValidation::ValidateAuthKey(AuthKey) || !UConvaiFormValidation::ValidateInputText(AssociatedAssetIdD))
 	{
+		// Never sent, so there is no 304 or unreachable server the cache could stand in for
+		bRejectedLocally = true;
 		HandleFailure();
 		return false;
 	}
@@ -331,24 +365,48 @@ bool UCPM_GetAssetMetaDataProxy::AddContentToRequestAsString(TSharedPtr<FJsonObj
 void UCPM_GetAssetMetaDataProxy::HandleSuccess()
 {
     Super::HandleSuccess();
-    
-    if (UCPM_UtilityLibrary::ExtractAssetListFromResponseString(ResponseString, AssetResponse))
-    {
-        OnSuccess.Broadcast(AssetResponse, ResponseString);
-    }
-    else
-    {
-    	UCPM_UtilityLibrary::CPM_LogMessage(TEXT("Failed to parse response"), ECPM_LogLevel::Error);
-        HandleFailure();
-    }
+
+	FCPM_HttpCache::Get().ResolveResponse(AssetMetaDataCacheKey(AssociatedAssetIdD), ActiveHttpRequest, ResponseString);
+	ActiveHttpRequest.Reset();
+	if (!BroadcastResponse())
+	{
+		OnFailure.Broadcast(FCPM_AssetResponse(), ResponseString);
+	}
 }
 
 void UCPM_GetAssetMetaDataProxy::HandleFailure()
 {
     Super::HandleFailure();
+
+	// A 304 or an unreachable server is answered from the cache
+	if (!bRejectedLocally && ActiveHttpRequest.IsValid()
+		&& FCPM_HttpCache::Get().ResolveResponse(AssetMetaDataCacheKey(AssociatedAssetIdD), ActiveHttpRequest, ResponseString))
+	{
+		ActiveHttpRequest.Reset();
+		if (BroadcastResponse())
+		{
+			return;
+		}
+	}
+
+	ActiveHttpRequest.Reset();
     OnFailure.Broadcast(FCPM_AssetResponse(), ResponseString);
 }
 
+bool UCPM_GetAssetMetaDataProxy::BroadcastResponse()
+{
+    if (UCPM_UtilityLibrary::ExtractAssetListFromResponseString(ResponseString, AssetResponse))
+    {
+        OnSuccess.Broadcast(AssetResponse, ResponseString);
+        return true;
+    }
+
+	// Failure is left to the caller, which knows whether the base proxy already reported one
+	UCPM_UtilityLibrary::CPM_LogMessage(TEXT("Failed to parse response"), ECPM_LogLevel::Error);
+	FCPM_HttpCache::Get().Remove(AssetMetaDataCacheKey(AssociatedAssetIdD));
+	return false;
+}
+
 
 // Delete asset
 UCPM_DeleteAssetProxy* UCPM_DeleteAssetProxy::DeleteAssetProxy(const FString& AssetID, const FString& Version)
@@ -393,6 +451,7 @@ bool UCPM_DeleteAssetProxy::AddContentToRequestAsString(TSharedPtr<FJsonObject>&
 void UCPM_DeleteAssetProxy::HandleSuccess()
 {
 	Super::HandleSuccess();
+	FCPM_HttpCache::Get().Remove(AssetMetaDataCacheKey(AssociatedAssetIdD));
 	OnSuccess.Broadcast(ResponseString);
 }
 
@@ -0,0 +1,128 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Proxy/CPM_SnapshotProxy.h"
+#include "Cache/CPM_ChunkStore.h"
+#include "Utility/CPM_FileWalker.h"
+#include "Utility/CPM_UtilityLibrary.h"
+#include "Async/Async.h"
+#include "Misc/Paths.h"
+#include <atomic>
+
+namespace
+{
+	/** Minimum time between two progress updates */
+	constexpr double ProgressInterval = 0.1;
+
+	/** Pruning must not delete chunks a snapshot still being created reuses, so only one runs at a time */
+	std::atomic<bool> bSnapshotInProgress { false };
+}
+
+UCPM_CreateSnapshotProxy* UCPM_CreateSnapshotProxy::CreateSnapshotProxy(const int32 SnapshotsToKeep)
+{
+	UCPM_CreateSnapshotProxy* Proxy = NewObject<UCPM_CreateSnapshotProxy>();
+	Proxy->M_SnapshotsToKeep = SnapshotsToKeep;
+	return Proxy;
+}
+
+void UCPM_CreateSnapshotProxy::Activate()
+{
+	AddToRoot();
+
+	if (bSnapshotInProgress.exchange(true))
+	{
+		Finish(false, TEXT("A project snapshot is already being created"), FCPM_SnapshotProgress());
+		return;
+	}
+
+	// What to snapshot comes from the project settings, only the walk and the chunking leave the game thread
+	const TArray<FString> Directories = UCPM_UtilityLibrary::GetProjectDirectoriesToZip();
+	const TArray<FString> Files = UCPM_UtilityLibrary::GetProjectFilesToZip();
+	const FCPM_IgnoreRules IgnoreRules = FCPM_IgnoreRules::MakeForProject();
+	const FString ProjectDir = FPaths::ProjectDir();
+	const int32 SnapshotsToKeep = M_SnapshotsToKeep;
+
+	TWeakObjectPtr<UCPM_CreateSnapshotProxy> WeakThis(this);
+	Async(EAsyncExecution::Thread, [WeakThis, Directories, Files, IgnoreRules, ProjectDir, SnapshotsToKeep]()
+	{
+		const TArray<FCPM_WalkedFile> WalkedFiles = FCPM_FileWalker::Walk(Directories, Files, IgnoreRules, ProjectDir);
+
+		FCPM_SnapshotProgress Progress;
+		Progress.TotalFiles = WalkedFiles.Num();
+		for (const FCPM_WalkedFile& File : WalkedFiles)
+		{
+			Progress.TotalBytes += File.Size;
+		}
+
+		auto PostProgress = [WeakThis](const FCPM_SnapshotProgress& InProgress)
+		{
+			AsyncTask(ENamedThreads::GameThread, [WeakThis, InProgress]()
+			{
+				if (WeakThis.IsValid())
+				{
+					WeakThis->OnProgress.Broadcast(FString(), InProgress);
+				}
+			});
+		};
+		PostProgress(Progress);
+
+		FCPM_Snapshot Previous;
+		const bool bHasPrevious = FCPM_ChunkStore::LoadLatestSnapshot(Previous);
+
+		// Called from every chunking thread, only the one that moves the deadline on posts
+		std::atomic<double> NextProgressTime { 0.0 };
+		const FCPM_ChunkStore::FOnSnapshotProgress OnProgress = [&](const int32 FilesProcessed, const int64 BytesProcessed)
+		{
+			const double Now = FPlatformTime::Seconds();
+			double NextTime = NextProgressTime.load();
+			if (Now >= NextTime && NextProgressTime.compare_exchange_strong(NextTime, Now + ProgressInterval))
+			{
+				FCPM_SnapshotProgress Update = Progress;
+				Update.FilesProcessed = FilesProcessed;
+				Update.BytesProcessed = BytesProcessed;
+				Update.Progress = Update.TotalBytes > 0 ? static_cast<float>(static_cast<double>(BytesProcessed) / Update.TotalBytes) : 0.f;
+				PostProgress(Update);
+			}
+		};
+
+		FCPM_Snapshot Snapshot;
+		FCPM_SnapshotStats Stats;
+		const bool bSuccess = FCPM_ChunkStore::CreateSnapshot(WalkedFiles, ProjectDir, Snapshot, bHasPrevious ? &Previous : nullptr, &Stats,
+			FCPM_ChunkStore::FChunkingParams(), OnProgress) && FCPM_ChunkStore::SaveSnapshot(Snapshot);
+		if (bSuccess && SnapshotsToKeep > 0)
+		{
+			FCPM_ChunkStore::PruneSnapshots(SnapshotsToKeep);
+		}
+		bSnapshotInProgress = false;
+
+		Progress.FilesProcessed = Stats.NumFiles;
+		Progress.BytesProcessed = Stats.TotalBytes;
+		Progress.NewBytes = Stats.NewBytes;
+		Progress.Progress = 1.f;
+		const FString SnapshotIdOrError = bSuccess ? Snapshot.Id : FString(TEXT("Failed to create project snapshot"));
+
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, bSuccess, SnapshotIdOrError, Progress]()
+		{
+			if (WeakThis.IsValid())
+			{
+				WeakThis->Finish(bSuccess, SnapshotIdOrError, Progress);
+			}
+		});
+	});
+}
+
+void UCPM_CreateSnapshotProxy::Finish(const bool bSuccess, const FString& SnapshotIdOrError, const FCPM_SnapshotProgress& Progress)
+{
+	if (bSuccess)
+	{
+		OnSuccess.Broadcast(SnapshotIdOrError, Progress);
+	}
+	else
+	{
+		UCPM_UtilityLibrary::CPM_LogMessage(SnapshotIdOrError, ECPM_LogLevel::Error);
+		OnFailure.Broadcast(SnapshotIdOrError, Progress);
+	}
+
+	RemoveFromRoot();
+	SetReadyToDestroy();
+}
@@ -0,0 +1,52 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Utility/CPM_FileHash.h"
+#include "HAL/FileManager.h"
+
+namespace
+{
+	constexpr int64 HashBufferSize = 1024 * 1024;
+}
+
+bool FCPM_FileHash::SHA1File(const FString& FilePath, FSHAHash& OutHash)
+{
+	const TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*FilePath));
+	if (!Reader.IsValid())
+	{
+		return false;
+	}
+
+	TArray<uint8> Buffer;
+	Buffer.SetNumUninitialized(HashBufferSize);
+
+	FSHA1 Sha;
+	const int64 TotalSize = Reader->TotalSize();
+	int64 Remaining = TotalSize;
+	while (Remaining > 0)
+	{
+		const int64 ToRead = FMath::Min(Remaining, HashBufferSize);
+		Reader->Serialize(Buffer.GetData(), ToRead);
+		if (Reader->IsError())
+		{
+			return false;
+		}
+		Sha.Update(Buffer.GetData(), ToRead);
+		Remaining -= ToRead;
+	}
+
+	Sha.Final();
+	Sha.GetHash(OutHash.Hash);
+	return true;
+}
+
+FString FCPM_FileHash::SHA1FileHex(const FString& FilePath)
+{
+	FSHAHash Hash;
+	return SHA1File(FilePath, Hash) ? ToHex(Hash) : FString();
+}
+
+FString FCPM_FileHash::ToHex(const FSHAHash& Hash)
+{
+	return BytesToHex(Hash.Hash, sizeof(Hash.Hash)).ToLower();
+}
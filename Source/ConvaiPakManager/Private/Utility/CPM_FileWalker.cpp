@@ -0,0 +1,224 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Utility/CPM_FileWalker.h"
+#include "Async/ParallelFor.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Utility/CPM_UtilityLibrary.h"
+
+namespace
+{
+	FString MakeRelative(const FString& Path, const FString& RootDirectory)
+	{
+		FString Relative = Path;
+		if (!RootDirectory.IsEmpty() && Relative.StartsWith(RootDirectory))
+		{
+			Relative.RightChopInline(RootDirectory.Len());
+		}
+		while (Relative.StartsWith(TEXT("/")))
+		{
+			Relative.RightChopInline(1);
+		}
+		return Relative;
+	}
+
+	FString NormalizeDirectory(const FString& Directory)
+	{
+		FString Result = FPaths::ConvertRelativePathToFull(Directory);
+		FPaths::NormalizeDirectoryName(Result);
+		return Result;
+	}
+}
+
+FCPM_IgnoreRules FCPM_IgnoreRules::MakeDefault()
+{
+	// The engine folders are anchored, a Content/Saved or Source/Backup folder is the project's own.
+	// Autosaves and Backup only exist under Saved.
+	FCPM_IgnoreRules Rules;
+	for (const TCHAR* Pattern : { TEXT(".git/"), TEXT(".svn/"), TEXT(".vs/"), TEXT(".idea/"), TEXT(".vscode/"),
+		TEXT("/Intermediate/"), TEXT("/DerivedDataCache/"), TEXT("/Saved/"),
+		TEXT("*.tmp"), TEXT("*.bak"), TEXT("~*"), TEXT(".DS_Store"), TEXT("Thumbs.db") })
+	{
+		Rules.AddPattern(Pattern);
+	}
+	return Rules;
+}
+
+FCPM_IgnoreRules FCPM_IgnoreRules::MakeForProject()
+{
+	FCPM_IgnoreRules Rules = MakeDefault();
+	Rules.LoadFromFile(FPaths::Combine(FPaths::ProjectDir(), GetIgnoreFileName()));
+	return Rules;
+}
+
+void FCPM_IgnoreRules::AddPattern(const FString& Line)
+{
+	FString Text = Line.TrimStartAndEnd();
+	if (Text.IsEmpty() || Text.StartsWith(TEXT("#")))
+	{
+		return;
+	}
+
+	FPattern Pattern;
+	if (Text.StartsWith(TEXT("!")))
+	{
+		Pattern.bNegated = true;
+		Text.RightChopInline(1);
+	}
+	Text.ReplaceInline(TEXT("\\"), TEXT("/"));
+	if (Text.EndsWith(TEXT("/")))
+	{
+		Pattern.bDirectoryOnly = true;
+		Text.LeftChopInline(1);
+	}
+	if (Text.StartsWith(TEXT("/")))
+	{
+		Text.RightChopInline(1);
+		Pattern.bAnchored = true;
+	}
+	Pattern.bAnchored |= Text.Contains(TEXT("/"));
+
+	if (!Text.IsEmpty())
+	{
+		Pattern.Wildcard = MoveTemp(Text);
+		Patterns.Add(MoveTemp(Pattern));
+	}
+}
+
+bool FCPM_IgnoreRules::LoadFromFile(const FString& IgnoreFilePath)
+{
+	TArray<FString> Lines;
+	if (!FFileHelper::LoadFileToStringArray(Lines, *IgnoreFilePath))
+	{
+		return false;
+	}
+
+	for (const FString& Line : Lines)
+	{
+		AddPattern(Line);
+	}
+	return true;
+}
+
+bool FCPM_IgnoreRules::IsIgnored(const FString& RelativePath, const bool bIsDirectory) const
+{
+	const FString Name = FPaths::GetCleanFilename(RelativePath);
+
+	bool bIgnored = false;
+	for (const FPattern& Pattern : Patterns)
+	{
+		if (Pattern.bDirectoryOnly && !bIsDirectory)
+		{
+			continue;
+		}
+
+		const FString& Subject = Pattern.bAnchored ? RelativePath : Name;
+		if (Subject.MatchesWildcard(Pattern.Wildcard, ESearchCase::IgnoreCase))
+		{
+			bIgnored = !Pattern.bNegated;
+		}
+	}
+	return bIgnored;
+}
+
+TArray<FCPM_WalkedFile> FCPM_FileWalker::Walk(const TArray<FString>& Directories, const TArray<FString>& Files, const FCPM_IgnoreRules& Rules, const FString& RootDirectory)
+{
+	const double StartTime = FPlatformTime::Seconds();
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	const FString Root = NormalizeDirectory(RootDirectory);
+
+	TArray<FCPM_WalkedFile> Result;
+	FCriticalSection ResultMutex;
+
+	TArray<FString> Frontier;
+	for (const FString& Directory : Directories)
+	{
+		if (PlatformFile.DirectoryExists(*Directory))
+		{
+			Frontier.AddUnique(NormalizeDirectory(Directory));
+		}
+		else
+		{
+			UCPM_UtilityLibrary::CPM_LogMessage(FString::Printf(TEXT("Directory not found: %s"), *Directory), ECPM_LogLevel::Warning);
+		}
+	}
+
+	int32 NumDirectories = 0;
+	while (Frontier.Num() > 0)
+	{
+		NumDirectories += Frontier.Num();
+		TArray<FString> NextFrontier;
+
+		ParallelFor(Frontier.Num(), [&](const int32 Index)
+		{
+			TArray<FCPM_WalkedFile> LocalFiles;
+			TArray<FString> LocalDirectories;
+
+			PlatformFile.IterateDirectoryStat(*Frontier[Index], [&](const TCHAR* Path, const FFileStatData& StatData)
+			{
+				FString FullPath(Path);
+				FPaths::NormalizeFilename(FullPath);
+				if (Rules.IsIgnored(MakeRelative(FullPath, Root), StatData.bIsDirectory))
+				{
+					return true;
+				}
+
+				if (StatData.bIsDirectory)
+				{
+					LocalDirectories.Add(MoveTemp(FullPath));
+				}
+				else
+				{
+					LocalFiles.Add({ MoveTemp(FullPath), StatData.FileSize, StatData.ModificationTime });
+				}
+				return true;
+			});
+
+			FScopeLock Lock(&ResultMutex);
+			Result.Append(MoveTemp(LocalFiles));
+			NextFrontier.Append(MoveTemp(LocalDirectories));
+		}, EParallelForFlags::Unbalanced);
+
+		Frontier = MoveTemp(NextFrontier);
+	}
+
+	for (const FString& File : Files)
+	{
+		const FFileStatData StatData = PlatformFile.GetStatData(*File);
+		if (StatData.bIsValid && !StatData.bIsDirectory)
+		{
+			FString FullPath = FPaths::ConvertRelativePathToFull(File);
+			FPaths::NormalizeFilename(FullPath);
+			Result.Add({ MoveTemp(FullPath), StatData.FileSize, StatData.ModificationTime });
+		}
+		else
+		{
+			UCPM_UtilityLibrary::CPM_LogMessage(FString::Printf(TEXT("File not found: %s"), *File), ECPM_LogLevel::Warning);
+		}
+	}
+
+	// Sorted output makes archives reproducible, and duplicates end up next to each other
+	Result.Sort([](const FCPM_WalkedFile& A, const FCPM_WalkedFile& B)
+	{
+		return A.Path < B.Path;
+	});
+	int32 NumUnique = 0;
+	for (int32 Index = 0; Index < Result.Num(); ++Index)
+	{
+		if (NumUnique == 0 || Result[Index].Path != Result[NumUnique - 1].Path)
+		{
+			if (Index != NumUnique)
+			{
+				Result[NumUnique] = MoveTemp(Result[Index]);
+			}
+			++NumUnique;
+		}
+	}
+	Result.SetNum(NumUnique);
+
+	UCPM_UtilityLibrary::CPM_LogMessage(FString::Printf(TEXT("Walked %d directories and found %d files in %.3fs"),
+		NumDirectories, Result.Num(), FPlatformTime::Seconds() - StartTime));
+	return Result;
+}
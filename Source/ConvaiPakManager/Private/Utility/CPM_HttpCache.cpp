@@ -0,0 +1,360 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Utility/CPM_HttpCache.h"
+#include "Utility/CPM_UtilityLibrary.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/SecureHash.h"
+#include "HAL/FileManager.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/JsonSerializer.h"
+
+namespace
+{
+	constexpr int32 HttpNotModified = 304;
+	constexpr double IndexFlushIntervalSeconds = 30.0;
+}
+
+bool FCPM_HttpCacheEntry::IsFresh() const
+{
+	return MaxAgeSeconds > 0 && (FDateTime::UtcNow() - StoredAt).GetTotalSeconds() < MaxAgeSeconds;
+}
+
+FCPM_HttpCache& FCPM_HttpCache::Get()
+{
+	static FCPM_HttpCache Instance;
+	return Instance;
+}
+
+FCPM_HttpCache::FCPM_HttpCache()
+{
+	LoadIndex();
+}
+
+FString FCPM_HttpCache::GetCacheDirectory()
+{
+	return FPaths::Combine(UCPM_UtilityLibrary::CPM_GetCacheDirectory(), TEXT("HttpCache"));
+}
+
+FString FCPM_HttpCache::GetIndexFilePath() const
+{
+	return FPaths::Combine(GetCacheDirectory(), TEXT("Index.json"));
+}
+
+bool FCPM_HttpCache::TryGetFresh(const FString& Key, FString& OutBody)
+{
+	FScopeLock Lock(&Mutex);
+	FCPM_HttpCacheEntry* Entry = Entries.Find(Key);
+	if (!Entry || (!bOfflineMode && !Entry->IsFresh()))
+	{
+		return false;
+	}
+
+	if (!ReadBody(*Entry, OutBody))
+	{
+		return false;
+	}
+
+	Entry->LastAccess = FDateTime::UtcNow();
+	MarkIndexDirty();
+	return true;
+}
+
+bool FCPM_HttpCache::TryGetStale(const FString& Key, FString& OutBody)
+{
+	FScopeLock Lock(&Mutex);
+	FCPM_HttpCacheEntry* Entry = Entries.Find(Key);
+	if (!Entry || !ReadBody(*Entry, OutBody))
+	{
+		return false;
+	}
+
+	Entry->LastAccess = FDateTime::UtcNow();
+	MarkIndexDirty();
+	return true;
+}
+
+void FCPM_HttpCache::AddConditionalHeaders(const FString& Key, const TSharedRef<CONVAI_HTTP_REQUEST_INTERFACE>& Request)
+{
+	FScopeLock Lock(&Mutex);
+	const FCPM_HttpCacheEntry* Entry = Entries.Find(Key);
+	if (!Entry)
+	{
+		return;
+	}
+
+	if (!Entry->ETag.IsEmpty())
+	{
+		Request->SetHeader(TEXT("If-None-Match"), Entry->ETag);
+	}
+	if (!Entry->LastModified.IsEmpty())
+	{
+		Request->SetHeader(TEXT("If-Modified-Since"), Entry->LastModified);
+	}
+}
+
+bool FCPM_HttpCache::ResolveResponse(const FString& Key, const TSharedPtr<CONVAI_HTTP_REQUEST_INTERFACE>& Request, FString& OutBody)
+{
+	const CONVAI_HTTP_RESPONSE_PTR Response = Request.IsValid() ? Request->GetResponse() : nullptr;
+	if (!Response.IsValid())
+	{
+		// No response at all, we are most likely offline. A stale entry is better than nothing.
+		return TryGetStale(Key, OutBody);
+	}
+
+	const int32 ResponseCode = Response->GetResponseCode();
+	if (ResponseCode == HttpNotModified)
+	{
+		{
+			FScopeLock Lock(&Mutex);
+			if (FCPM_HttpCacheEntry* Entry = Entries.Find(Key))
+			{
+				Entry->StoredAt = FDateTime::UtcNow();
+				const int32 MaxAge = ParseMaxAge(Response->GetHeader(TEXT("Cache-Control")));
+				Entry->MaxAgeSeconds = MaxAge > 0 ? MaxAge : Entry->MaxAgeSeconds;
+				bIndexDirty = true;
+			}
+		}
+		return TryGetStale(Key, OutBody);
+	}
+
+	if (ResponseCode >= 200 && ResponseCode < 300)
+	{
+		OutBody = Response->GetContentAsString();
+		Store(Key, OutBody, Response->GetHeader(TEXT("ETag")), Response->GetHeader(TEXT("Last-Modified")), Response->GetHeader(TEXT("Cache-Control")));
+		return true;
+	}
+
+	// Any other answer, 5xx included, is the server's and is not papered over with an old body
+	return false;
+}
+
+void FCPM_HttpCache::Store(const FString& Key, const FString& Body, const FString& ETag, const FString& LastModified, const FString& CacheControl)
+{
+	if (CacheControl.Contains(TEXT("no-store")))
+	{
+		return;
+	}
+
+	FScopeLock Lock(&Mutex);
+
+	FCPM_HttpCacheEntry& Entry = Entries.FindOrAdd(Key);
+	TotalSizeBytes -= Entry.Size;
+
+	Entry.Key = Key;
+	Entry.BodyFile = FMD5::HashAnsiString(*Key) + TEXT(".body");
+	Entry.ETag = ETag;
+	Entry.LastModified = LastModified;
+	Entry.MaxAgeSeconds = ParseMaxAge(CacheControl);
+	Entry.StoredAt = FDateTime::UtcNow();
+	Entry.LastAccess = Entry.StoredAt;
+
+	const FString BodyPath = FPaths::Combine(GetCacheDirectory(), Entry.BodyFile);
+	if (!FFileHelper::SaveStringToFile(Body, *BodyPath, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM))
+	{
+		UCPM_UtilityLibrary::CPM_LogMessage(FString::Printf(TEXT("Failed to write http cache entry: %s"), *BodyPath), ECPM_LogLevel::Warning);
+		Entries.Remove(Key);
+		return;
+	}
+
+	Entry.Size = IFileManager::Get().FileSize(*BodyPath);
+	TotalSizeBytes += Entry.Size;
+
+	EvictToBudget();
+	SaveIndex();
+}
+
+void FCPM_HttpCache::Remove(const FString& Key)
+{
+	FScopeLock Lock(&Mutex);
+	FCPM_HttpCacheEntry Entry;
+	if (Entries.RemoveAndCopyValue(Key, Entry))
+	{
+		TotalSizeBytes -= Entry.Size;
+		IFileManager::Get().Delete(*FPaths::Combine(GetCacheDirectory(), Entry.BodyFile), false, true, true);
+		SaveIndex();
+	}
+}
+
+void FCPM_HttpCache::Clear()
+{
+	FScopeLock Lock(&Mutex);
+	Entries.Reset();
+	TotalSizeBytes = 0;
+	IFileManager::Get().DeleteDirectory(*GetCacheDirectory(), false, true);
+}
+
+void FCPM_HttpCache::SetMaxSizeBytes(const int64 InMaxSizeBytes)
+{
+	FScopeLock Lock(&Mutex);
+	MaxSizeBytes = FMath::Max<int64>(0, InMaxSizeBytes);
+	EvictToBudget();
+	SaveIndex();
+}
+
+void FCPM_HttpCache::Flush()
+{
+	FScopeLock Lock(&Mutex);
+	if (bIndexDirty)
+	{
+		SaveIndex();
+	}
+}
+
+void FCPM_HttpCache::MarkIndexDirty()
+{
+	bIndexDirty = true;
+	if (FPlatformTime::Seconds() - LastIndexSaveTime >= IndexFlushIntervalSeconds)
+	{
+		SaveIndex();
+	}
+}
+
+int64 FCPM_HttpCache::GetTotalSizeBytes() const
+{
+	FScopeLock Lock(&Mutex);
+	return TotalSizeBytes;
+}
+
+bool FCPM_HttpCache::ReadBody(const FCPM_HttpCacheEntry& Entry, FString& OutBody) const
+{
+	return FFileHelper::LoadFileToString(OutBody, *FPaths::Combine(GetCacheDirectory(), Entry.BodyFile));
+}
+
+void FCPM_HttpCache::EvictToBudget()
+{
+	if (TotalSizeBytes <= MaxSizeBytes)
+	{
+		return;
+	}
+
+	TArray<const FCPM_HttpCacheEntry*> ByAccess;
+	ByAccess.Reserve(Entries.Num());
+	for (const TPair<FString, FCPM_HttpCacheEntry>& Pair : Entries)
+	{
+		ByAccess.Add(&Pair.Value);
+	}
+	ByAccess.Sort([](const FCPM_HttpCacheEntry& A, const FCPM_HttpCacheEntry& B)
+	{
+		return A.LastAccess < B.LastAccess;
+	});
+
+	TArray<FString> KeysToEvict;
+	int64 Remaining = TotalSizeBytes;
+	for (const FCPM_HttpCacheEntry* Entry : ByAccess)
+	{
+		if (Remaining <= MaxSizeBytes)
+		{
+			break;
+		}
+		Remaining -= Entry->Size;
+		KeysToEvict.Add(Entry->Key);
+	}
+
+	for (const FString& Key : KeysToEvict)
+	{
+		FCPM_HttpCacheEntry Entry;
+		Entries.RemoveAndCopyValue(Key, Entry);
+		IFileManager::Get().Delete(*FPaths::Combine(GetCacheDirectory(), Entry.BodyFile), false, true, true);
+	}
+	TotalSizeBytes = Remaining;
+}
+
+int32 FCPM_HttpCache::ParseMaxAge(const FString& CacheControl)
+{
+	if (CacheControl.Contains(TEXT("no-cache")))
+	{
+		return 0;
+	}
+
+	int32 MaxAge = 0;
+	FParse::Value(*CacheControl, TEXT("max-age="), MaxAge);
+	return FMath::Max(0, MaxAge);
+}
+
+void FCPM_HttpCache::LoadIndex()
+{
+	FString FileContent;
+	if (!FFileHelper::LoadFileToString(FileContent, *GetIndexFilePath()))
+	{
+		return;
+	}
+
+	TSharedPtr<FJsonObject> JsonObject;
+	const TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(FileContent);
+	if (!FJsonSerializer::Deserialize(Reader, JsonObject) || !JsonObject.IsValid())
+	{
+		return;
+	}
+
+	const TArray<TSharedPtr<FJsonValue>>* EntriesArray;
+	if (!JsonObject->TryGetArrayField(TEXT("entries"), EntriesArray))
+	{
+		return;
+	}
+
+	for (const TSharedPtr<FJsonValue>& Value : *EntriesArray)
+	{
+		const TSharedPtr<FJsonObject> EntryObject = Value->AsObject();
+		if (!EntryObject.IsValid())
+		{
+			continue;
+		}
+
+		FCPM_HttpCacheEntry Entry;
+		FString StoredAt, LastAccess;
+		EntryObject->TryGetStringField(TEXT("key"), Entry.Key);
+		EntryObject->TryGetStringField(TEXT("body_file"), Entry.BodyFile);
+		EntryObject->TryGetStringField(TEXT("etag"), Entry.ETag);
+		EntryObject->TryGetStringField(TEXT("last_modified"), Entry.LastModified);
+		EntryObject->TryGetNumberField(TEXT("size"), Entry.Size);
+		EntryObject->TryGetNumberField(TEXT("max_age"), Entry.MaxAgeSeconds);
+		EntryObject->TryGetStringField(TEXT("stored_at"), StoredAt);
+		EntryObject->TryGetStringField(TEXT("last_access"), LastAccess);
+		FDateTime::ParseIso8601(*StoredAt, Entry.StoredAt);
+		FDateTime::ParseIso8601(*LastAccess, Entry.LastAccess);
+
+		// Drop index entries whose body went missing
+		if (Entry.Key.IsEmpty() || !FPaths::FileExists(FPaths::Combine(GetCacheDirectory(), Entry.BodyFile)))
+		{
+			continue;
+		}
+
+		TotalSizeBytes += Entry.Size;
+		Entries.Add(Entry.Key, MoveTemp(Entry));
+	}
+}
+
+void FCPM_HttpCache::SaveIndex()
+{
+	bIndexDirty = false;
+	LastIndexSaveTime = FPlatformTime::Seconds();
+
+	TArray<TSharedPtr<FJsonValue>> EntriesArray;
+	EntriesArray.Reserve(Entries.Num());
+	for (const TPair<FString, FCPM_HttpCacheEntry>& Pair : Entries)
+	{
+		const FCPM_HttpCacheEntry& Entry = Pair.Value;
+		TSharedPtr<FJsonObject> EntryObject = MakeShared<FJsonObject>();
+		EntryObject->SetStringField(TEXT("key"), Entry.Key);
+		EntryObject->SetStringField(TEXT("body_file"), Entry.BodyFile);
+		EntryObject->SetStringField(TEXT("etag"), Entry.ETag);
+		EntryObject->SetStringField(TEXT("last_modified"), Entry.LastModified);
+		EntryObject->SetNumberField(TEXT("size"), Entry.Size);
+		EntryObject->SetNumberField(TEXT("max_age"), Entry.MaxAgeSeconds);
+		EntryObject->SetStringField(TEXT("stored_at"), Entry.StoredAt.ToIso8601());
+		EntryObject->SetStringField(TEXT("last_access"), Entry.LastAccess.ToIso8601());
+		EntriesArray.Add(MakeShared<FJsonValueObject>(EntryObject));
+	}
+
+	const TSharedPtr<FJsonObject> JsonObject = MakeShared<FJsonObject>();
+	JsonObject->SetArrayField(TEXT("entries"), EntriesArray);
+
+	FString Output;
+	const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Output);
+	FJsonSerializer::Serialize(JsonObject.ToSharedRef(), Writer);
+	FFileHelper::SaveStringToFile(Output, *GetIndexFilePath());
+}
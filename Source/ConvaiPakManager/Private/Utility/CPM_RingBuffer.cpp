@@ -0,0 +1,166 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Utility/CPM_RingBuffer.h"
+#include "HAL/Event.h"
+#include "HAL/PlatformProcess.h"
+#include "Misc/ScopeLock.h"
+
+FCPM_RingBuffer::FCPM_RingBuffer(const int64 InCapacity)
+{
+	Buffer.SetNumUninitialized(FMath::Max<int64>(InCapacity, 64 * 1024));
+	DataAvailableEvent = FPlatformProcess::GetSynchEventFromPool(false);
+	SpaceAvailableEvent = FPlatformProcess::GetSynchEventFromPool(false);
+}
+
+FCPM_RingBuffer::~FCPM_RingBuffer()
+{
+	FPlatformProcess::ReturnSynchEventToPool(DataAvailableEvent);
+	FPlatformProcess::ReturnSynchEventToPool(SpaceAvailableEvent);
+}
+
+bool FCPM_RingBuffer::Write(const void* Data, int64 Size)
+{
+	const uint8* Source = static_cast<const uint8*>(Data);
+	while (Size > 0)
+	{
+		int64 Written = 0;
+		{
+			FScopeLock Lock(&Mutex);
+			if (bAborted || bClosed)
+			{
+				return false;
+			}
+
+			const int64 Capacity = Buffer.Num();
+			const int64 Free = Capacity - NumBuffered;
+			if (Free > 0)
+			{
+				// Copy in up to two pieces, around the end of the buffer
+				const int64 WritePosition = (ReadPosition + NumBuffered) % Capacity;
+				Written = FMath::Min(Size, Free);
+				const int64 FirstPart = FMath::Min(Written, Capacity - WritePosition);
+				FMemory::Memcpy(Buffer.GetData() + WritePosition, Source, FirstPart);
+				FMemory::Memcpy(Buffer.GetData(), Source + FirstPart, Written - FirstPart);
+				NumBuffered += Written;
+			}
+		}
+
+		if (Written > 0)
+		{
+			DataAvailableEvent->Trigger();
+			Source += Written;
+			Size -= Written;
+		}
+		else
+		{
+			SpaceAvailableEvent->Wait();
+		}
+	}
+	return true;
+}
+
+int64 FCPM_RingBuffer::Read(void* Data, const int64 Size)
+{
+	while (Size > 0)
+	{
+		int64 Read = 0;
+		{
+			FScopeLock Lock(&Mutex);
+			if (bAborted)
+			{
+				return 0;
+			}
+
+			if (NumBuffered > 0)
+			{
+				const int64 Capacity = Buffer.Num();
+				Read = FMath::Min(Size, NumBuffered);
+				const int64 FirstPart = FMath::Min(Read, Capacity - ReadPosition);
+				FMemory::Memcpy(Data, Buffer.GetData() + ReadPosition, FirstPart);
+				FMemory::Memcpy(static_cast<uint8*>(Data) + FirstPart, Buffer.GetData(), Read - FirstPart);
+				ReadPosition = (ReadPosition + Read) % Capacity;
+				NumBuffered -= Read;
+				TotalRead += Read;
+			}
+			else if (bClosed)
+			{
+				return 0;
+			}
+		}
+
+		if (Read > 0)
+		{
+			SpaceAvailableEvent->Trigger();
+			return Read;
+		}
+		DataAvailableEvent->Wait();
+	}
+	return 0;
+}
+
+void FCPM_RingBuffer::Close()
+{
+	{
+		FScopeLock Lock(&Mutex);
+		bClosed = true;
+	}
+	DataAvailableEvent->Trigger();
+}
+
+void FCPM_RingBuffer::Abort()
+{
+	{
+		FScopeLock Lock(&Mutex);
+		bAborted = true;
+	}
+	DataAvailableEvent->Trigger();
+	SpaceAvailableEvent->Trigger();
+}
+
+bool FCPM_RingBuffer::IsAborted() const
+{
+	FScopeLock Lock(&Mutex);
+	return bAborted;
+}
+
+int64 FCPM_RingBuffer::GetTotalRead() const
+{
+	FScopeLock Lock(&Mutex);
+	return TotalRead;
+}
+
+FCPM_RingBufferReader::FCPM_RingBufferReader(const TSharedRef<FCPM_RingBuffer, ESPMode::ThreadSafe>& InRingBuffer, const int64 InTotalSize)
+	: RingBuffer(InRingBuffer)
+	, Size(InTotalSize)
+{
+	SetIsLoading(true);
+	SetIsPersistent(false);
+}
+
+void FCPM_RingBufferReader::Serialize(void* Data, int64 Num)
+{
+	uint8* Destination = static_cast<uint8*>(Data);
+	while (Num > 0 && !IsError())
+	{
+		const int64 Read = RingBuffer->Read(Destination, Num);
+		if (Read <= 0)
+		{
+			// The producer stopped early, the receiver must not see padding as data
+			SetError();
+			FMemory::Memzero(Destination, Num);
+			break;
+		}
+		Destination += Read;
+		Position += Read;
+		Num -= Read;
+	}
+}
+
+void FCPM_RingBufferReader::Seek(const int64 InPos)
+{
+	if (InPos != Position)
+	{
+		SetError();
+	}
+}
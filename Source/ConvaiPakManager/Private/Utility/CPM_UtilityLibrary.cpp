@@ -23,6 +23,13 @@
 #include "Dom/JsonValue.h"
 #include "Serialization/JsonWriter.h"
 #include "Utility/CPM_Log.h"
+#include "Utility/CPM_HttpCache.h"
+#include "Cache/CPM_PakStore.h"
+#include "Pak/CPM_PakReader.h"
+#include "Pak/CPM_PakVerifier.h"
+#include "Pak/CPM_PakInventory.h"
+#include "Utility/CPM_FileWalker.h"
+#include "Cache/CPM_ChunkStore.h"
 #include "Interfaces/IPluginManager.h"
 
 #include "Misc/Paths.h"
@@ -102,33 +109,55 @@ FString UCPM_UtilityLibrary::GetProjectName()
 
 bool UCPM_UtilityLibrary::ValidatePakFile(const FString& PakFilePath)
 {
-	if (!FPaths::FileExists(PakFilePath))
+	FCPM_PakValidationReport Report;
+	return CPM_InspectPakFile(PakFilePath, Report);
+}
+
+bool UCPM_UtilityLibrary::CPM_InspectPakFile(const FString& PakFilePath, FCPM_PakValidationReport& OutReport)
+{
+	// Reads the footer and index directly instead of mounting, so validating is cheap and side effect free
+	const bool bValid = FCPM_PakReader::Validate(PakFilePath, OutReport);
+	for (const FString& Error : OutReport.Errors)
 	{
-		CPM_LogMessage(FString::Printf(TEXT("Pak file does not exist: %s"), *PakFilePath), ECPM_LogLevel::Error);
-		return false;
+		CPM_LogMessage(FString::Printf(TEXT("Invalid pak file %s: %s"), *PakFilePath, *Error), ECPM_LogLevel::Error);
 	}
+	return bValid;
+}
 
-	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
-	FPakPlatformFile* PakPlatformFile = new FPakPlatformFile();
-
-	if (!PakPlatformFile->Initialize(&PlatformFile, TEXT("")))
+bool UCPM_UtilityLibrary::CPM_VerifyPakEntries(const FString& PakFilePath, FCPM_PakVerifyReport& OutReport)
+{
+	const bool bValid = FCPM_PakVerifier::Verify(PakFilePath, OutReport);
+	for (const FString& Error : OutReport.Errors)
 	{
-		CPM_LogMessage(TEXT("Failed to initialize PakPlatformFile."), ECPM_LogLevel::Error);
-		delete PakPlatformFile;
-		return false;
+		CPM_LogMessage(Error, ECPM_LogLevel::Error);
 	}
-
-	if (!PakPlatformFile->Mount(*PakFilePath, 0, *FPaths::ProjectContentDir()))
+	for (const FCPM_PakCorruptEntry& Corrupt : OutReport.CorruptEntries)
 	{
-		CPM_LogMessage(FString::Printf(TEXT("Failed to mount Pak file: %s"), *PakFilePath), ECPM_LogLevel::Error);
-		delete PakPlatformFile;
-		return false;
+		CPM_LogMessage(FString::Printf(TEXT("Corrupt pak entry %s at offset %lld: %s"), *Corrupt.Filename, Corrupt.Offset, *Corrupt.Reason), ECPM_LogLevel::Error);
 	}
+	return bValid;
+}
 
-	PakPlatformFile->Unmount(*PakFilePath);
-	
-	delete PakPlatformFile;
-	return true;
+bool UCPM_UtilityLibrary::CPM_GetPakInventory(const FString& PakFilePath, FCPM_PakInventory& OutInventory)
+{
+	return FCPM_PakInventoryBuilder::Build(PakFilePath, OutInventory);
+}
+
+FCPM_PakInventoryDiff UCPM_UtilityLibrary::CPM_DiffPakInventories(const FCPM_PakInventory& OldInventory, const FCPM_PakInventory& NewInventory)
+{
+	return FCPM_PakInventoryBuilder::Diff(OldInventory, NewInventory);
+}
+
+bool UCPM_UtilityLibrary::CPM_ExportPakInventory(const FCPM_PakInventory& Inventory, const FString& OutFilePath)
+{
+	const bool bSaved = FPaths::GetExtension(OutFilePath).Equals(TEXT("csv"), ESearchCase::IgnoreCase)
+		? FCPM_PakInventoryBuilder::ExportCsv(Inventory, OutFilePath)
+		: FCPM_PakInventoryBuilder::ExportJson(Inventory, OutFilePath);
+	if (!bSaved)
+	{
+		CPM_LogMessage(FString::Printf(TEXT("Failed to export pak inventory to %s"), *OutFilePath), ECPM_LogLevel::Error);
+	}
+	return bSaved;
 }
 
 void UCPM_UtilityLibrary::GetAssetID(FString& AssetID)
@@ -222,6 +251,36 @@ FString UCPM_UtilityLibrary::CPM_GetRawProjectZipPath()
         return ZipPath;
 }
 
+void UCPM_UtilityLibrary::CPM_SetHttpCacheOfflineMode(const bool bOffline)
+{
+	FCPM_HttpCache::Get().SetOfflineMode(bOffline);
+}
+
+void UCPM_UtilityLibrary::CPM_SetHttpCacheMaxSize(const int64 MaxSizeBytes)
+{
+	FCPM_HttpCache::Get().SetMaxSizeBytes(MaxSizeBytes);
+}
+
+void UCPM_UtilityLibrary::CPM_ClearHttpCache()
+{
+	FCPM_HttpCache::Get().Clear();
+}
+
+bool UCPM_UtilityLibrary::CPM_AddPakToStore(const FString& PakFilePath, FString& OutHash, const bool bMoveFile)
+{
+	return FCPM_PakStore::Get().Import(PakFilePath, OutHash, bMoveFile);
+}
+
+bool UCPM_UtilityLibrary::CPM_LinkStoredPakToChunk(const FString& Hash, const ECPM_Platform Platform, const FString& ChunkID)
+{
+	return FCPM_PakStore::Get().LinkToChunk(Hash, Platform, ChunkID);
+}
+
+void UCPM_UtilityLibrary::CPM_SetPakStoreBudget(const int64 BudgetBytes)
+{
+	FCPM_PakStore::Get().SetBudgetBytes(BudgetBytes);
+}
+
 FString UCPM_UtilityLibrary::GetPackageDirectory()
 {
 	return FPaths::Combine(FPaths::ProjectDir(), TEXT("PackagedApp"));
@@ -951,6 +1010,67 @@ TArray<FString> UCPM_UtilityLibrary::GetProjectFilesToZip()
     return FilesToZip;
 }
 
+TArray<FString> UCPM_UtilityLibrary::CPM_ListProjectFilesToZip()
+{
+	const TArray<FCPM_WalkedFile> WalkedFiles = FCPM_FileWalker::Walk(GetProjectDirectoriesToZip(), GetProjectFilesToZip(),
+		FCPM_IgnoreRules::MakeForProject(), FPaths::ProjectDir());
+
+	TArray<FString> Result;
+	Result.Reserve(WalkedFiles.Num());
+	for (const FCPM_WalkedFile& File : WalkedFiles)
+	{
+		Result.Add(File.Path);
+	}
+	return Result;
+}
+
+bool UCPM_UtilityLibrary::CPM_CreateProjectSnapshot(FString& OutSnapshotId, int64& OutNewBytes)
+{
+	const TArray<FCPM_WalkedFile> Files = FCPM_FileWalker::Walk(GetProjectDirectoriesToZip(), GetProjectFilesToZip(),
+		FCPM_IgnoreRules::MakeForProject(), FPaths::ProjectDir());
+
+	FCPM_Snapshot Previous;
+	const bool bHasPrevious = FCPM_ChunkStore::LoadLatestSnapshot(Previous);
+
+	FCPM_Snapshot Snapshot;
+	FCPM_SnapshotStats Stats;
+	if (!FCPM_ChunkStore::CreateSnapshot(Files, FPaths::ProjectDir(), Snapshot, bHasPrevious ? &Previous : nullptr, &Stats)
+		|| !FCPM_ChunkStore::SaveSnapshot(Snapshot))
+	{
+		CPM_LogMessage(TEXT("Failed to create project snapshot"), ECPM_LogLevel::Error);
+		return false;
+	}
+	FCPM_ChunkStore::PruneSnapshots(FCPM_ChunkStore::DefaultSnapshotsToKeep);
+
+	OutSnapshotId = Snapshot.Id;
+	OutNewBytes = Stats.NewBytes;
+	return true;
+}
+
+bool UCPM_UtilityLibrary::CPM_PruneProjectSnapshots(const int32 SnapshotsToKeep, int64& OutDeletedBytes)
+{
+	FCPM_SnapshotPruneStats Stats;
+	const bool bPruned = FCPM_ChunkStore::PruneSnapshots(SnapshotsToKeep, &Stats);
+	OutDeletedBytes = Stats.DeletedBytes;
+	return bPruned;
+}
+
+bool UCPM_UtilityLibrary::CPM_RestoreProjectSnapshot(const FString& SnapshotId, const FString& TargetDirectory)
+{
+	FCPM_Snapshot Snapshot;
+	if (!FCPM_ChunkStore::LoadSnapshot(SnapshotId, Snapshot))
+	{
+		CPM_LogMessage(FString::Printf(TEXT("Snapshot not found: %s"), *SnapshotId), ECPM_LogLevel::Error);
+		return false;
+	}
+	return FCPM_ChunkStore::RestoreSnapshot(Snapshot, TargetDirectory);
+}
+
+TArray<FString> UCPM_UtilityLibrary::CPM_ListProjectSnapshots()
+{
+	return FCPM_ChunkStore::ListSnapshots();
+}
+
 bool UCPM_UtilityLibrary::CPM_SetSystemEnvVar(const FString& VarName, const FString& VarValue)
 {
 #if PLATFORM_WINDOWS
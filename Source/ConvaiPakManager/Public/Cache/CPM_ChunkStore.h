@@ -0,0 +1,120 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Utility/CPM_FileWalker.h"
+
+struct FCPM_SnapshotChunk
+{
+	/** Lower case hex SHA1 of the chunk content */
+	FString Hash;
+	int64 Size = 0;
+};
+
+struct FCPM_SnapshotFile
+{
+	/** Relative to the snapshot root, forward slashes */
+	FString Path;
+	int64 Size = 0;
+	FDateTime Timestamp;
+	TArray<FCPM_SnapshotChunk> Chunks;
+};
+
+/** A project state as a list of files, each one the concatenation of its chunks */
+struct CONVAIPAKMANAGER_API FCPM_Snapshot
+{
+	FString Id;
+	FDateTime CreatedAt;
+	TArray<FCPM_SnapshotFile> Files;
+
+	int64 GetTotalBytes() const;
+
+	/** Every distinct chunk hash in the order it is first used */
+	TArray<FString> GetUniqueChunks() const;
+};
+
+struct FCPM_SnapshotStats
+{
+	int32 NumFiles = 0;
+
+	/** Files whose size and timestamp matched the previous snapshot and were not read again */
+	int32 NumReusedFiles = 0;
+	int32 NumChunks = 0;
+	int32 NumNewChunks = 0;
+	int64 TotalBytes = 0;
+	int64 NewBytes = 0;
+	double Seconds = 0.0;
+};
+
+struct FCPM_SnapshotPruneStats
+{
+	int32 NumDeletedSnapshots = 0;
+	int32 NumDeletedChunks = 0;
+	int64 DeletedBytes = 0;
+};
+
+/**
+ * Content defined chunk store for raw project snapshots.
+ * Files are cut with a FastCDC style gear hash, so an edit only changes the chunks around it and
+ * successive snapshots share most of their chunks. Chunks live in <Cache>/ChunkStore/Chunks/<ab>/<sha1>,
+ * snapshots are json manifests in <Cache>/ChunkStore/Snapshots/<id>.json.
+ */
+class CONVAIPAKMANAGER_API FCPM_ChunkStore
+{
+public:
+	struct FChunkingParams
+	{
+		int32 MinSize = 16 * 1024;
+		int32 AverageSize = 64 * 1024;
+		int32 MaxSize = 256 * 1024;
+	};
+
+	/** Files and bytes done so far, called from the chunking threads after every file */
+	using FOnSnapshotProgress = TFunction<void(int32 FilesProcessed, int64 BytesProcessed)>;
+
+	/** Snapshots CPM_CreateProjectSnapshot keeps, older ones and the chunks only they use are pruned */
+	static constexpr int32 DefaultSnapshotsToKeep = 10;
+
+	/**
+	 * Chunks and stores Files in parallel on background priority workers. Files with the same size and
+	 * timestamp as in Previous reuse its chunk list without being read, as long as those chunks are still in the store.
+	 */
+	static bool CreateSnapshot(const TArray<FCPM_WalkedFile>& Files, const FString& RootDirectory, FCPM_Snapshot& OutSnapshot,
+		const FCPM_Snapshot* Previous = nullptr, FCPM_SnapshotStats* OutStats = nullptr, const FChunkingParams& Params = FChunkingParams(),
+		const FOnSnapshotProgress& OnProgress = nullptr);
+
+	/**
+	 * Deletes all but the NumToKeep newest snapshots (at least one), then every chunk none of the remaining
+	 * ones uses. Chunks written after the newest snapshot was created are kept, they may belong to one that
+	 * is being created; pruning still must not run while a snapshot reuses chunks of the ones it deletes.
+	 */
+	static bool PruneSnapshots(int32 NumToKeep, FCPM_SnapshotPruneStats* OutStats = nullptr);
+
+	static bool SaveSnapshot(const FCPM_Snapshot& Snapshot);
+	static bool LoadSnapshot(const FString& SnapshotId, FCPM_Snapshot& OutSnapshot);
+
+	/** Snapshot ids, oldest first */
+	static TArray<FString> ListSnapshots();
+	static bool LoadLatestSnapshot(FCPM_Snapshot& OutSnapshot);
+
+	/** Rebuilds every file of the snapshot under TargetDirectory, each chunk is verified against its hash */
+	static bool RestoreSnapshot(const FCPM_Snapshot& Snapshot, const FString& TargetDirectory);
+
+	/** Chunks of the snapshot that are not in KnownChunks, i.e. what still has to be uploaded */
+	static TArray<FString> GetMissingChunks(const FCPM_Snapshot& Snapshot, const TSet<FString>& KnownChunks);
+
+	/** Chunks of the snapshot the local store does not have, a snapshot can only be restored when this is empty */
+	static TArray<FString> GetChunksMissingFromStore(const FCPM_Snapshot& Snapshot);
+
+	static bool HasChunk(const FString& Hash);
+	static FString GetChunkPath(const FString& Hash);
+	static FString GetStoreDirectory();
+
+	/** Length of the next chunk at the start of Data, Size is at most Params.MaxSize */
+	static int32 FindChunkBoundary(const uint8* Data, int32 Size, const FChunkingParams& Params);
+
+private:
+	static bool ChunkFile(const FCPM_WalkedFile& File, const FChunkingParams& Params, FCPM_SnapshotFile& OutFile, int32& OutNumNewChunks, int64& OutNewBytes);
+	static bool StoreChunk(const FString& Hash, const uint8* Data, int64 Size);
+};
@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Utility/CPM_Utils.h"
+#include <atomic>
+
+struct FCPM_PakStoreObject
+{
+	FString Hash;
+	int64 Size = 0;
+	FDateTime LastAccess;
+
+	/** Download urls, asset ids or chunk names known to resolve to this content */
+	TArray<FString> Aliases;
+
+	/** Paths this object has been linked into. They are never deleted by the store, removing the object leaves them in place. */
+	TArray<FString> LinkedPaths;
+};
+
+DECLARE_DELEGATE_TwoParams(FCPM_OnPakStoreScrubCompleted, int32 /*NumChecked*/, const TArray<FString>& /*CorruptHashes*/);
+
+/**
+ * Content addressed store for downloaded and built paks.
+ * Objects live in <Cache>/PakStore/Objects/<ab>/<sha1>.pak, a json index tracks size, last access
+ * and where each object is linked to. Identical content is kept once and hard linked into
+ * the paths callers expect (e.g. GetPakFilePathFromChunkID), falling back to a copy.
+ */
+class CONVAIPAKMANAGER_API FCPM_PakStore
+{
+public:
+	static FCPM_PakStore& Get();
+
+	/** Adds a file to the store and returns its content hash. Identical content is only stored once. */
+	bool Import(const FString& SourceFilePath, FString& OutHash, bool bMoveSource = false, const FString& Alias = FString());
+
+	bool Contains(const FString& Hash) const;
+	bool FindByAlias(const FString& Alias, FString& OutHash) const;
+	void AddAlias(const FString& Hash, const FString& Alias);
+	FString GetObjectPath(const FString& Hash) const;
+
+	/** Hard links (or copies) an object to DestinationPath */
+	bool LinkTo(const FString& Hash, const FString& DestinationPath);
+
+	/** Links an object to the pak path a packaged chunk would have */
+	bool LinkToChunk(const FString& Hash, ECPM_Platform Platform, const FString& ChunkID);
+
+	bool Remove(const FString& Hash);
+
+	/** Byte budget for the store, least recently used objects are evicted past it. 0 disables the budget. */
+	void SetBudgetBytes(int64 InBudgetBytes);
+	int64 GetBudgetBytes() const;
+	int64 GetTotalBytes() const;
+	void EnforceBudget();
+
+	/** Re-hashes every object on a background thread and drops the ones that no longer match their name */
+	void StartIntegrityScrub(FCPM_OnPakStoreScrubCompleted OnCompleted);
+	bool IsScrubbing() const { return bScrubbing; }
+
+	static FString GetStoreDirectory();
+
+private:
+	FCPM_PakStore();
+
+	void Touch(FCPM_PakStoreObject& Object);
+	void RemoveLocked(const FString& Hash);
+	void EnforceBudgetLocked(const FString& KeepHash = FString());
+	void LoadIndex();
+	void SaveIndex() const;
+	static bool CreateHardLink(const FString& SourcePath, const FString& DestinationPath);
+
+	mutable FCriticalSection Mutex;
+	TMap<FString, FCPM_PakStoreObject> Objects;
+	TMap<FString, FString> AliasToHash;
+	int64 TotalBytes = 0;
+	int64 BudgetBytes = 20ll * 1024 * 1024 * 1024;
+	std::atomic<bool> bScrubbing{ false };
+};
@@ -0,0 +1,90 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Ticker.h"
+#include "CPM_DownloadManager.generated.h"
+
+USTRUCT(BlueprintType)
+struct FCPM_DownloadProgress
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int64 BytesReceived = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int64 TotalBytes = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	float Progress = 0.f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	float BytesPerSecond = 0.f;
+};
+
+DECLARE_DELEGATE_OneParam(FCPM_OnDownloadProgress, const FCPM_DownloadProgress&);
+
+/** bSuccess, and either the final file path or the failure reason */
+DECLARE_DELEGATE_TwoParams(FCPM_OnDownloadComplete, bool, const FString&);
+
+struct FCPM_DownloadRequest
+{
+	FString URL;
+	FString TargetPath;
+
+	/** Hex MD5 of the complete file. When empty the x-goog-hash md5 returned by the server is used, if any */
+	FString ExpectedMD5;
+
+	FCPM_OnDownloadProgress OnProgress;
+	FCPM_OnDownloadComplete OnComplete;
+};
+
+struct FCPM_DownloadJob;
+
+/**
+ * Downloads signed urls straight to disk as HTTP range segments.
+ * Segments are written into <Target>.part and tracked in a <Target>.part.json sidecar so an
+ * interrupted download resumes where it stopped. The whole file is verified before it is moved in place.
+ * Works against any server that honours Range (and falls back to a single GET when it doesn't).
+ */
+class CONVAIPAKMANAGER_API FCPM_DownloadManager : public FTSTickerObjectBase
+{
+public:
+	static FCPM_DownloadManager& Get();
+
+	FGuid StartDownload(const FCPM_DownloadRequest& Request);
+	void CancelDownload(const FGuid& DownloadId, bool bDeletePartialFile = false);
+	bool IsDownloading(const FGuid& DownloadId) const;
+
+	/** Global limits shared by every download */
+	void SetMaxConcurrentSegments(int32 InMaxConcurrentSegments) { MaxConcurrentSegments = FMath::Max(1, InMaxConcurrentSegments); }
+	void SetMaxBytesPerSecond(int64 InMaxBytesPerSecond) { MaxBytesPerSecond = FMath::Max<int64>(0, InMaxBytesPerSecond); }
+	void SetSegmentSize(int64 InSegmentSize) { SegmentSize = FMath::Max<int64>(256 * 1024, InSegmentSize); }
+
+	//~ FTSTickerObjectBase
+	virtual bool Tick(float DeltaTime) override;
+
+private:
+	FCPM_DownloadManager() = default;
+
+	void Pump();
+	void StartSegment(const TSharedRef<FCPM_DownloadJob>& Job, int32 SegmentIndex);
+	void OnSegmentResponse(const TSharedRef<FCPM_DownloadJob>& Job, int32 SegmentIndex, int32 ResponseCode, const FString& ContentRange, const FString& ETag, const FString& GoogHash, TArray<uint8>&& Data);
+	void WriteSegment(const TSharedRef<FCPM_DownloadJob>& Job, int32 SegmentIndex, TArray<uint8>&& Data);
+	void OnSegmentWritten(const TSharedRef<FCPM_DownloadJob>& Job, int32 SegmentIndex, int32 Generation, int64 BytesWritten, bool bWriteSucceeded);
+	void RestartAsWholeFile(const TSharedRef<FCPM_DownloadJob>& Job);
+	void Finalize(const TSharedRef<FCPM_DownloadJob>& Job);
+	void FailJob(const TSharedRef<FCPM_DownloadJob>& Job, const FString& Reason);
+	void BroadcastProgress(const TSharedRef<FCPM_DownloadJob>& Job);
+
+	TMap<FGuid, TSharedRef<FCPM_DownloadJob>> Jobs;
+	TArray<FGuid> JobOrder;
+
+	int32 ActiveSegments = 0;
+	int32 MaxConcurrentSegments = 6;
+	int64 MaxBytesPerSecond = 0;
+	int64 SegmentSize = 8 * 1024 * 1024;
+	double ByteTokens = 0.0;
+};
@@ -0,0 +1,140 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CPM_PakInventory.generated.h"
+
+USTRUCT(BlueprintType)
+struct FCPM_PakInventoryEntry
+{
+	GENERATED_BODY()
+
+	/** Full path of the file inside the pak, mount point included */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	FString Filename;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int64 UncompressedSize = 0;
+
+	/** Bytes the entry takes in the pak, equal to UncompressedSize for stored entries */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int64 CompressedSize = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	FString CompressionMethod;
+
+	/** Long package name the file belongs to, empty for loose non package files */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	FString PackageName;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	FString Folder;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	FString AssetClass;
+};
+
+USTRUCT(BlueprintType)
+struct FCPM_PakSizeBucket
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	FString Key;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int32 NumEntries = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int64 UncompressedSize = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int64 CompressedSize = 0;
+};
+
+USTRUCT(BlueprintType)
+struct FCPM_PakInventory
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	FString PakFilePath;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int64 FileSize = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int64 TotalUncompressedSize = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int64 TotalCompressedSize = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	TArray<FCPM_PakInventoryEntry> Entries;
+
+	/** Sorted by compressed size, largest first */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	TArray<FCPM_PakSizeBucket> ByFolder;
+
+	/** Sorted by compressed size, largest first */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	TArray<FCPM_PakSizeBucket> ByAssetClass;
+};
+
+USTRUCT(BlueprintType)
+struct FCPM_PakEntryDelta
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	FString Filename;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int64 OldCompressedSize = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int64 NewCompressedSize = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int64 Delta = 0;
+};
+
+USTRUCT(BlueprintType)
+struct FCPM_PakInventoryDiff
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	TArray<FCPM_PakEntryDelta> Added;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	TArray<FCPM_PakEntryDelta> Removed;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	TArray<FCPM_PakEntryDelta> Changed;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int64 TotalDelta = 0;
+};
+
+/**
+ * Lists what is inside a pak and where its size goes. Entries are read from the index of an
+ * unmounted pak, mapped back to their package and classified through the asset registry.
+ */
+class CONVAIPAKMANAGER_API FCPM_PakInventoryBuilder
+{
+public:
+	static bool Build(const FString& PakFilePath, FCPM_PakInventory& OutInventory);
+
+	/** Compares two inventories by file name, deltas are sorted by absolute size change */
+	static FCPM_PakInventoryDiff Diff(const FCPM_PakInventory& OldInventory, const FCPM_PakInventory& NewInventory);
+
+	static bool ExportJson(const FCPM_PakInventory& Inventory, const FString& OutFilePath);
+
+	/** One row per entry, suitable for spreadsheets and budget scripts */
+	static bool ExportCsv(const FCPM_PakInventory& Inventory, const FString& OutFilePath);
+
+	/** Maps a file path inside a pak (e.g. ../../../Project/Content/Foo/Bar.uasset) to its long package name */
+	static FString FilenameToPackageName(const FString& Filename);
+};
@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/RefCounting.h"
+#include "CPM_PakReader.generated.h"
+
+struct FPakInfo;
+class FPakFile;
+
+USTRUCT(BlueprintType)
+struct FCPM_PakValidationReport
+{
+	GENERATED_BODY()
+
+	/** True when the footer, version and index hash all check out */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	bool bValid = false;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	bool bMagicValid = false;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int32 Version = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	bool bVersionSupported = false;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	bool bIndexEncrypted = false;
+
+	/** False for encrypted indices, the hash is over the decrypted data and we have no key here */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	bool bIndexHashVerified = false;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	bool bIndexHashValid = false;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int64 FileSize = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int64 IndexOffset = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int64 IndexSize = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	FString IndexHash;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	FString MountPoint;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int32 NumEntries = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	TArray<FString> CompressionMethods;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	TArray<FString> Errors;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	float ElapsedMilliseconds = 0.f;
+};
+
+/**
+ * Reads a pak's footer and index straight from disk. Nothing is mounted and no
+ * FPakPlatformFile is created, so it has no effect on the running file system.
+ */
+class CONVAIPAKMANAGER_API FCPM_PakReader
+{
+public:
+	/** Locates and deserializes the FPakInfo footer, trying every known footer version from newest to oldest */
+	static bool ReadPakInfo(FArchive& Reader, FPakInfo& OutInfo);
+
+	/** Footer and primary index check, including the path hash and directory index hashes when present */
+	static bool Validate(const FString& PakFilePath, FCPM_PakValidationReport& OutReport);
+
+	/** Loads a pak and its index for enumeration without registering it with the pak platform file */
+	static TRefCountPtr<FPakFile> OpenUnmounted(const FString& PakFilePath);
+};
@@ -0,0 +1,75 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CPM_PakVerifier.generated.h"
+
+USTRUCT(BlueprintType)
+struct FCPM_PakCorruptEntry
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	FString Filename;
+
+	/** Absolute offset of the entry (or of the failing compressed block) in the pak */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int64 Offset = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int64 Size = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	FString Reason;
+};
+
+USTRUCT(BlueprintType)
+struct FCPM_PakVerifyReport
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	bool bValid = false;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int32 NumEntries = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int32 NumCompressedBlocks = 0;
+
+	/** Encrypted entries are counted here, their payload cannot be checked without the key */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int32 NumSkippedEntries = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int64 BytesVerified = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	float ElapsedSeconds = 0.f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	float MegabytesPerSecond = 0.f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	bool bMemoryMapped = false;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	TArray<FCPM_PakCorruptEntry> CorruptEntries;
+
+	/** Problems that prevented the verification from running at all */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	TArray<FString> Errors;
+};
+
+/**
+ * Checks every entry of a pak without mounting it. The pak is memory mapped and split into
+ * work items, one per entry hash and one per compressed block, which are spread across the
+ * task graph so large paks verify at close to disk/core speed.
+ */
+class CONVAIPAKMANAGER_API FCPM_PakVerifier
+{
+public:
+	/** Blocking, call from a worker thread for large paks */
+	static bool Verify(const FString& PakFilePath, FCPM_PakVerifyReport& OutReport);
+};
@@ -0,0 +1,43 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Kismet/BlueprintAsyncActionBase.h"
+#include "Download/CPM_DownloadManager.h"
+#include "CPM_DownloadProxy.generated.h"
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FCPM_DownloadResultDelegate, const FString&, FilePathOrError, const FCPM_DownloadProgress&, Progress);
+
+/** Downloads a signed url (e.g. FCPM_AssetData::signed_url or a thumbnail path) through FCPM_DownloadManager */
+UCLASS()
+class CONVAIPAKMANAGER_API UCPM_DownloadFileProxy : public UBlueprintAsyncActionBase
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(BlueprintAssignable)
+	FCPM_DownloadResultDelegate OnSuccess;
+
+	UPROPERTY(BlueprintAssignable)
+	FCPM_DownloadResultDelegate OnFailure;
+
+	UPROPERTY(BlueprintAssignable)
+	FCPM_DownloadResultDelegate OnProgress;
+
+	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = "true", DisplayName = "Convai Download File"), Category = "Convai|PakManager")
+	static UCPM_DownloadFileProxy* DownloadFileProxy(const FString& URL, const FString& TargetPath, const FString& ExpectedMD5, UCPM_DownloadFileProxy*& OutProxy);
+
+	/** Cancel the download, the partial file is kept for resuming unless asked otherwise */
+	UFUNCTION(BlueprintCallable, Category = "Convai|PakManager")
+	void CancelDownload(const bool bDeletePartialFile = false);
+
+	virtual void Activate() override;
+
+private:
+	FString M_URL;
+	FString M_TargetPath;
+	FString M_ExpectedMD5;
+	FGuid M_DownloadId;
+	FCPM_DownloadProgress M_LastProgress;
+};
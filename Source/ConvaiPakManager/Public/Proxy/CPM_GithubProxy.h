@@ -23,8 +23,15 @@ public:
 	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = "true", DisplayName = "Get Github Repo file" , WorldContext = "WorldContextObject"), Category = "Convai|PakManager")
 	static UCPM_GetGithubRepoFileProxy* GetGithubRepoFileProxy(const FString& GithubRepoName, const FString& BranchName, const FString& FileName);
 
+	/** Serves unchanged files from the http cache without a round-trip */
+	virtual void Activate() override;
+
 protected:
 	virtual bool ConfigureRequest(TSharedRef<CONVAI_HTTP_REQUEST_INTERFACE> Request, const TCHAR* Verb) override;
 	virtual void HandleSuccess() override;
 	virtual void HandleFailure() override;
+
+private:
+	/** Kept so the response validators can be read back into the http cache */
+	TSharedPtr<CONVAI_HTTP_REQUEST_INTERFACE> ActiveHttpRequest;
 };
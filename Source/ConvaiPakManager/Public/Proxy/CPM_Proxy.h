@@ -143,6 +143,9 @@ public:
 	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = "true", DisplayName = "Convai Get Asset Metadata" , WorldContext = "WorldContextObject"), Category = "Convai|PakManager")
 	static UCPM_GetAssetMetaDataProxy* GetAssetProxy(UObject* WorldContextObject, FString AssetID);
 
+	/** Serves cached metadata while it is fresh or while the http cache is offline */
+	virtual void Activate() override;
+
 protected:
 	virtual bool ConfigureRequest(TSharedRef<CONVAI_HTTP_REQUEST_INTERFACE> Request, const TCHAR* Verb) override;
 	virtual bool AddContentToRequest(CONVAI_HTTP_PAYLOAD_ARRAY_TYPE& DataToSend, const FString& Boundary)  override { return false; }
@@ -150,9 +153,16 @@ protected:
 	virtual void HandleSuccess() override;
 	virtual void HandleFailure() override;
 
+	/** Broadcasts OnSuccess if ResponseString parses, otherwise drops it from the cache and returns false */
+	bool BroadcastResponse();
+
 public:
 	FString AssociatedAssetIdD;
 	FCPM_AssetResponse AssetResponse;
+
+private:
+	TSharedPtr<CONVAI_HTTP_REQUEST_INTERFACE> ActiveHttpRequest;
+	bool bRejectedLocally = false;
 };
 
 //--------------------------------------------------------------------------------------------------
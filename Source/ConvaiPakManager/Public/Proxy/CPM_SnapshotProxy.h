@@ -0,0 +1,67 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Kismet/BlueprintAsyncActionBase.h"
+#include "CPM_SnapshotProxy.generated.h"
+
+USTRUCT(BlueprintType)
+struct FCPM_SnapshotProgress
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int32 FilesProcessed = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int32 TotalFiles = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int64 BytesProcessed = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int64 TotalBytes = 0;
+
+	/** Bytes written to the chunk store, set once the snapshot is done */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int64 NewBytes = 0;
+
+	/** 0 to 1, by bytes */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	float Progress = 0.f;
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FCPM_SnapshotResultDelegate, const FString&, SnapshotIdOrError, const FCPM_SnapshotProgress&, Progress);
+
+/**
+ * CPM_CreateProjectSnapshot off the game thread: the files are walked and chunked in the background,
+ * progress is throttled and, like completion, delivered on the game thread. Once the snapshot is saved
+ * all but the SnapshotsToKeep newest ones are pruned along with the chunks only they used.
+ */
+UCLASS()
+class CONVAIPAKMANAGER_API UCPM_CreateSnapshotProxy : public UBlueprintAsyncActionBase
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(BlueprintAssignable)
+	FCPM_SnapshotResultDelegate OnSuccess;
+
+	UPROPERTY(BlueprintAssignable)
+	FCPM_SnapshotResultDelegate OnFailure;
+
+	UPROPERTY(BlueprintAssignable)
+	FCPM_SnapshotResultDelegate OnProgress;
+
+	/** SnapshotsToKeep 0 keeps every snapshot */
+	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = "true", DisplayName = "Convai Create Project Snapshot"), Category = "Convai|PakManager")
+	static UCPM_CreateSnapshotProxy* CreateSnapshotProxy(const int32 SnapshotsToKeep = 10);
+
+	virtual void Activate() override;
+
+private:
+	void Finish(bool bSuccess, const FString& SnapshotIdOrError, const FCPM_SnapshotProgress& Progress);
+
+	int32 M_SnapshotsToKeep = 0;
+};
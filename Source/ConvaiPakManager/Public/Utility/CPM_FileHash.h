@@ -0,0 +1,17 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/SecureHash.h"
+
+/** Streaming file hashes, files are read through a fixed buffer and never loaded whole */
+struct CONVAIPAKMANAGER_API FCPM_FileHash
+{
+	static bool SHA1File(const FString& FilePath, FSHAHash& OutHash);
+
+	/** Lower case hex SHA1, empty if the file could not be read */
+	static FString SHA1FileHex(const FString& FilePath);
+
+	static FString ToHex(const FSHAHash& Hash);
+};
@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FCPM_WalkedFile
+{
+	FString Path;
+	int64 Size = 0;
+	FDateTime Timestamp;
+};
+
+/**
+ * Subset of .gitignore syntax: '#' comments, '!' negation, a trailing '/' for directories only,
+ * and '*' / '?' wildcards. Patterns containing a '/' are matched against the path relative to
+ * the root, the others against every file or directory name. The last matching pattern wins.
+ */
+class CONVAIPAKMANAGER_API FCPM_IgnoreRules
+{
+public:
+	/** Version control, IDE and engine scratch folders that never belong in an upload */
+	static FCPM_IgnoreRules MakeDefault();
+
+	/** Default rules plus <ProjectDir>/.convaiignore when present */
+	static FCPM_IgnoreRules MakeForProject();
+
+	void AddPattern(const FString& Line);
+	bool LoadFromFile(const FString& IgnoreFilePath);
+
+	bool IsIgnored(const FString& RelativePath, bool bIsDirectory) const;
+
+	static const TCHAR* GetIgnoreFileName() { return TEXT(".convaiignore"); }
+
+private:
+	struct FPattern
+	{
+		FString Wildcard;
+		bool bNegated = false;
+		bool bDirectoryOnly = false;
+		bool bAnchored = false;
+	};
+
+	TArray<FPattern> Patterns;
+};
+
+/**
+ * Walks directory trees in parallel, one level at a time, collecting size and timestamp from the
+ * same directory listing so no extra stat call is needed per file.
+ */
+class CONVAIPAKMANAGER_API FCPM_FileWalker
+{
+public:
+	/**
+	 * Returns every file under Directories plus the explicit Files, sorted by path and without duplicates.
+	 * Ignore rules are evaluated relative to RootDirectory and only apply to files found by walking.
+	 */
+	static TArray<FCPM_WalkedFile> Walk(const TArray<FString>& Directories, const TArray<FString>& Files, const FCPM_IgnoreRules& Rules, const FString& RootDirectory);
+};
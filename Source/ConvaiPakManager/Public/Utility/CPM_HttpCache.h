@@ -0,0 +1,86 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RestAPI/ConvaiAPIBase.h"
+#include <atomic>
+
+/** A single cached GET/metadata response, stored as <Cache>/HttpCache/<Hash>.body */
+struct CONVAIPAKMANAGER_API FCPM_HttpCacheEntry
+{
+	FString Key;
+	FString BodyFile;
+	FString ETag;
+	FString LastModified;
+	int64 Size = 0;
+	int32 MaxAgeSeconds = 0;
+	FDateTime StoredAt;
+	FDateTime LastAccess;
+
+	bool IsFresh() const;
+};
+
+/**
+ * Disk backed response cache shared by the GitHub and Convai proxies.
+ * Bodies are stored together with their validators so requests can be revalidated with
+ * If-None-Match / If-Modified-Since, and a 304 is answered from disk.
+ */
+class CONVAIPAKMANAGER_API FCPM_HttpCache
+{
+public:
+	static FCPM_HttpCache& Get();
+
+	/** Returns the cached body if the entry is still within its max-age (or offline mode is on) */
+	bool TryGetFresh(const FString& Key, FString& OutBody);
+
+	/** Returns the cached body regardless of its age */
+	bool TryGetStale(const FString& Key, FString& OutBody);
+
+	/** Adds the conditional request headers for a previously cached response */
+	void AddConditionalHeaders(const FString& Key, const TSharedRef<CONVAI_HTTP_REQUEST_INTERFACE>& Request);
+
+	/**
+	 * Resolves a completed request against the cache. A 200 is stored, a 304 or a request that got no response at all is answered from disk.
+	 * Returns true when OutBody holds a usable response body.
+	 */
+	bool ResolveResponse(const FString& Key, const TSharedPtr<CONVAI_HTTP_REQUEST_INTERFACE>& Request, FString& OutBody);
+
+	void Store(const FString& Key, const FString& Body, const FString& ETag, const FString& LastModified, const FString& CacheControl);
+	void Remove(const FString& Key);
+	void Clear();
+
+	/** Writes the index when cache hits updated access times since it was last written */
+	void Flush();
+
+	void SetMaxSizeBytes(int64 InMaxSizeBytes);
+	int64 GetMaxSizeBytes() const { return MaxSizeBytes; }
+	int64 GetTotalSizeBytes() const;
+
+	/** When offline, any cached entry is served and no request leaves the machine */
+	void SetOfflineMode(bool bInOffline) { bOfflineMode = bInOffline; }
+	bool IsOfflineMode() const { return bOfflineMode; }
+
+	static FString GetCacheDirectory();
+
+private:
+	FCPM_HttpCache();
+
+	FString GetIndexFilePath() const;
+	void LoadIndex();
+	void SaveIndex();
+
+	/** Access times of hits only reach disk every IndexFlushIntervalSeconds, on insert or removal, or at shutdown */
+	void MarkIndexDirty();
+	bool ReadBody(const FCPM_HttpCacheEntry& Entry, FString& OutBody) const;
+	void EvictToBudget();
+	static int32 ParseMaxAge(const FString& CacheControl);
+
+	mutable FCriticalSection Mutex;
+	TMap<FString, FCPM_HttpCacheEntry> Entries;
+	int64 TotalSizeBytes = 0;
+	int64 MaxSizeBytes = 64ll * 1024 * 1024;
+	bool bIndexDirty = false;
+	double LastIndexSaveTime = 0.0;
+	std::atomic<bool> bOfflineMode{ false };
+};
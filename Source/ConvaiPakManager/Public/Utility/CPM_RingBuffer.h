@@ -0,0 +1,70 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Serialization/Archive.h"
+
+/**
+ * Bounded single producer / single consumer byte pipe. Write blocks while the buffer is full and
+ * Read blocks until data arrives, so a fast producer can never get more than the capacity ahead.
+ */
+class CONVAIPAKMANAGER_API FCPM_RingBuffer
+{
+public:
+	explicit FCPM_RingBuffer(int64 InCapacity);
+	~FCPM_RingBuffer();
+
+	/** Returns false once the pipe was aborted */
+	bool Write(const void* Data, int64 Size);
+
+	/** Reads up to Size bytes, waiting for at least one. Returns 0 at the end of the stream or after an abort. */
+	int64 Read(void* Data, int64 Size);
+
+	/** No more writes, the reader drains what is left */
+	void Close();
+
+	/** Wakes both sides, pending and later calls fail */
+	void Abort();
+
+	bool IsAborted() const;
+	int64 GetCapacity() const { return Buffer.Num(); }
+
+	/** Bytes the consumer has taken out so far */
+	int64 GetTotalRead() const;
+
+private:
+	TArray<uint8> Buffer;
+	int64 ReadPosition = 0;
+	int64 NumBuffered = 0;
+	int64 TotalRead = 0;
+	bool bClosed = false;
+	bool bAborted = false;
+
+	mutable FCriticalSection Mutex;
+	FEvent* DataAvailableEvent = nullptr;
+	FEvent* SpaceAvailableEvent = nullptr;
+};
+
+/**
+ * Read side of a ring buffer as an FArchive, e.g. for IHttpRequest::SetContentFromStream. The total
+ * size has to be declared up front, reading stops with an error if the producer delivers less.
+ */
+class CONVAIPAKMANAGER_API FCPM_RingBufferReader : public FArchive
+{
+public:
+	FCPM_RingBufferReader(const TSharedRef<FCPM_RingBuffer, ESPMode::ThreadSafe>& InRingBuffer, int64 InTotalSize);
+
+	virtual void Serialize(void* Data, int64 Num) override;
+	virtual int64 Tell() override { return Position; }
+	virtual int64 TotalSize() override { return Size; }
+
+	/** Only seeking to the current position is possible, the data before it is gone */
+	virtual void Seek(int64 InPos) override;
+	virtual FString GetArchiveName() const override { return TEXT("FCPM_RingBufferReader"); }
+
+private:
+	TSharedRef<FCPM_RingBuffer, ESPMode::ThreadSafe> RingBuffer;
+	int64 Size = 0;
+	int64 Position = 0;
+};
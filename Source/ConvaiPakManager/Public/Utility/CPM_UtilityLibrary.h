@@ -7,6 +7,9 @@
 #include "IImageWrapper.h"
 #include "AssetRegistry/AssetData.h"
 #include "Engine/Texture2D.h"
+#include "Pak/CPM_PakReader.h"
+#include "Pak/CPM_PakVerifier.h"
+#include "Pak/CPM_PakInventory.h"
 #include "Kismet/BlueprintFunctionLibrary.h"
 #include "CPM_UtilityLibrary.generated.h"
 
@@ -26,6 +29,26 @@ public:
 
 	UFUNCTION(BlueprintCallable, Category = "Convai|PakManager")
 	static bool ValidatePakFile(const FString& PakFilePath);
+
+	/** Checks a pak's footer, version and index hashes without mounting it */
+	UFUNCTION(BlueprintCallable, Category = "Convai|PakManager")
+	static bool CPM_InspectPakFile(const FString& PakFilePath, FCPM_PakValidationReport& OutReport);
+
+	/** Hashes and decompresses every entry in parallel, blocks until done */
+	UFUNCTION(BlueprintCallable, Category = "Convai|PakManager")
+	static bool CPM_VerifyPakEntries(const FString& PakFilePath, FCPM_PakVerifyReport& OutReport);
+
+	// Pak inventory utility functions
+	UFUNCTION(BlueprintCallable, Category = "Convai|PakManager")
+	static bool CPM_GetPakInventory(const FString& PakFilePath, FCPM_PakInventory& OutInventory);
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Convai|PakManager")
+	static FCPM_PakInventoryDiff CPM_DiffPakInventories(const FCPM_PakInventory& OldInventory, const FCPM_PakInventory& NewInventory);
+
+	/** Writes json or csv depending on the extension of OutFilePath */
+	UFUNCTION(BlueprintCallable, Category = "Convai|PakManager")
+	static bool CPM_ExportPakInventory(const FCPM_PakInventory& Inventory, const FString& OutFilePath);
+	// END Pak inventory utility functions
 	
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Convai|PakManager")
 	static void GetAssetID(FString& AssetID);
@@ -60,6 +83,28 @@ public:
 
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Convai|PakManager")
 	static FString CPM_GetRawProjectZipPath();
+
+	// Http cache utility functions
+	UFUNCTION(BlueprintCallable, Category = "Convai|PakManager")
+	static void CPM_SetHttpCacheOfflineMode(const bool bOffline);
+
+	UFUNCTION(BlueprintCallable, Category = "Convai|PakManager")
+	static void CPM_SetHttpCacheMaxSize(const int64 MaxSizeBytes);
+
+	UFUNCTION(BlueprintCallable, Category = "Convai|PakManager")
+	static void CPM_ClearHttpCache();
+	// END Http cache utility functions
+
+	// Pak store utility functions
+	UFUNCTION(BlueprintCallable, Category = "Convai|PakManager")
+	static bool CPM_AddPakToStore(const FString& PakFilePath, FString& OutHash, const bool bMoveFile = false);
+
+	UFUNCTION(BlueprintCallable, Category = "Convai|PakManager")
+	static bool CPM_LinkStoredPakToChunk(const FString& Hash, const ECPM_Platform Platform, const FString& ChunkID);
+
+	UFUNCTION(BlueprintCallable, Category = "Convai|PakManager")
+	static void CPM_SetPakStoreBudget(const int64 BudgetBytes);
+	// END Pak store utility functions
 	
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Convai|PakManager")
 	static FString GetPackageDirectory();
@@ -109,8 +154,33 @@ public:
 
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Convai|PakManager")
 	static TArray<FString> GetProjectFilesToZip();
+
+	/** Every file the raw project zip would contain, sorted, deduplicated and filtered by .convaiignore */
+	UFUNCTION(BlueprintCallable, Category = "Convai|PakManager")
+	static TArray<FString> CPM_ListProjectFilesToZip();
 	// END Project Zipping utility functions
 
+	// Project snapshot utility functions
+	/**
+	 * Stores the files CPM_ListProjectFilesToZip returns as content defined chunks, only content not already stored
+	 * is written, and prunes all but the last few snapshots. Blocks until done, the Convai Create Project Snapshot
+	 * node does the same in the background with progress.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Convai|PakManager")
+	static bool CPM_CreateProjectSnapshot(FString& OutSnapshotId, int64& OutNewBytes);
+
+	/** Deletes all but the SnapshotsToKeep newest snapshots and the chunks only the deleted ones used */
+	UFUNCTION(BlueprintCallable, Category = "Convai|PakManager")
+	static bool CPM_PruneProjectSnapshots(int32 SnapshotsToKeep, int64& OutDeletedBytes);
+
+	/** Rebuilds a snapshot byte for byte under TargetDirectory */
+	UFUNCTION(BlueprintCallable, Category = "Convai|PakManager")
+	static bool CPM_RestoreProjectSnapshot(const FString& SnapshotId, const FString& TargetDirectory);
+
+	UFUNCTION(BlueprintCallable, Category = "Convai|PakManager")
+	static TArray<FString> CPM_ListProjectSnapshots();
+	// END Project snapshot utility functions
+
 	UFUNCTION(BlueprintCallable, Category = "Convai|System|Environment")
 	static bool CPM_SetSystemEnvVar(const FString& VarName, const FString& VarValue);
 
@@ -39,11 +39,26 @@ public class ConvaiPakManagerEditor : ModuleRules
                 "AssetTools",
                 "DesktopPlatform", 
                 "UATHelper", 
+                "TurnkeySupport",
                 "LiveCoding",
                 "RenderCore",
-                "FileUtilities"
+                "FileUtilities",
+                "Json",
+                "JsonUtilities",
+                "HTTP",
+                "DirectoryWatcher"
 			}
 			);
-		
+
+		// Raw deflate for the project zip
+		AddEngineThirdPartyPrivateStaticDependencies(Target, "zlib");
+
+		// Zstd zip entries need a zstd third party module in the engine, off by default
+		const bool bEnableZstd = false;
+		PrivateDefinitions.Add("CPM_WITH_ZSTD=" + (bEnableZstd ? "1" : "0"));
+		if (bEnableZstd)
+		{
+			AddEngineThirdPartyPrivateStaticDependencies(Target, "zstd");
+		}
 	}
 }
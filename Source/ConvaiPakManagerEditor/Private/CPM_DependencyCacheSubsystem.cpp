@@ -0,0 +1,455 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CPM_DependencyCacheSubsystem.h"
+#include "CPM_DependencyWalker.h"
+#include "Utility/CPM_UtilityLibrary.h"
+#include "AssetRegistry/AssetData.h"
+#include "AssetRegistry/IAssetRegistry.h"
+#include "Misc/FileHelper.h"
+#include "Misc/PackageName.h"
+#include "Misc/Paths.h"
+#include "UObject/ObjectSaveContext.h"
+#include "UObject/Package.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/JsonSerializer.h"
+
+namespace
+{
+	constexpr int32 DependencyCacheFormatVersion = 2;
+
+	TArray<TSharedPtr<FJsonValue>> ToJsonArray(const TArray<FName>& Names)
+	{
+		TArray<TSharedPtr<FJsonValue>> Values;
+		Values.Reserve(Names.Num());
+		for (const FName Name : Names)
+		{
+			Values.Add(MakeShared<FJsonValueString>(Name.ToString()));
+		}
+		return Values;
+	}
+
+	TArray<TSharedPtr<FJsonValue>> ToJsonArray(const TArray<FString>& Strings)
+	{
+		TArray<TSharedPtr<FJsonValue>> Values;
+		Values.Reserve(Strings.Num());
+		for (const FString& String : Strings)
+		{
+			Values.Add(MakeShared<FJsonValueString>(String));
+		}
+		return Values;
+	}
+
+	void FromJsonArray(const TArray<TSharedPtr<FJsonValue>>& Values, TArray<FName>& OutNames)
+	{
+		OutNames.Reserve(Values.Num());
+		FString String;
+		for (const TSharedPtr<FJsonValue>& Value : Values)
+		{
+			if (Value.IsValid() && Value->TryGetString(String))
+			{
+				OutNames.Add(FName(*String));
+			}
+		}
+	}
+
+	void FromJsonArray(const TArray<TSharedPtr<FJsonValue>>& Values, TArray<FString>& OutStrings)
+	{
+		OutStrings.Reserve(Values.Num());
+		FString String;
+		for (const TSharedPtr<FJsonValue>& Value : Values)
+		{
+			if (Value.IsValid() && Value->TryGetString(String))
+			{
+				OutStrings.Add(String);
+			}
+		}
+	}
+}
+
+void UCPM_DependencyCacheSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	LoadCache();
+
+	IAssetRegistry& AssetRegistry = IAssetRegistry::GetChecked();
+	AssetAddedHandle = AssetRegistry.OnAssetAdded().AddUObject(this, &UCPM_DependencyCacheSubsystem::OnAssetAdded);
+	AssetRemovedHandle = AssetRegistry.OnAssetRemoved().AddUObject(this, &UCPM_DependencyCacheSubsystem::OnAssetRemoved);
+	AssetUpdatedHandle = AssetRegistry.OnAssetUpdated().AddUObject(this, &UCPM_DependencyCacheSubsystem::OnAssetUpdated);
+	AssetRenamedHandle = AssetRegistry.OnAssetRenamed().AddUObject(this, &UCPM_DependencyCacheSubsystem::OnAssetRenamed);
+
+	// A save rewrites the package's imports before the registry reports the update
+	PackageSavedHandle = UPackage::PackageSavedWithContextEvent.AddUObject(this, &UCPM_DependencyCacheSubsystem::OnPackageSaved);
+}
+
+void UCPM_DependencyCacheSubsystem::Deinitialize()
+{
+	UPackage::PackageSavedWithContextEvent.Remove(PackageSavedHandle);
+
+	if (IAssetRegistry* AssetRegistry = IAssetRegistry::Get())
+	{
+		AssetRegistry->OnAssetAdded().Remove(AssetAddedHandle);
+		AssetRegistry->OnAssetRemoved().Remove(AssetRemovedHandle);
+		AssetRegistry->OnAssetUpdated().Remove(AssetUpdatedHandle);
+		AssetRegistry->OnAssetRenamed().Remove(AssetRenamedHandle);
+	}
+
+	SaveCache();
+	UE_LOG(LogTemp, Log, TEXT("Dependency cache: %d hits, %d misses this session"), NumHits, NumMisses);
+
+	Super::Deinitialize();
+}
+
+FString UCPM_DependencyCacheSubsystem::GetCachePath()
+{
+	return FPaths::Combine(UCPM_UtilityLibrary::CPM_GetCacheDirectory(), TEXT("DependencyCache"), TEXT("DependencyCache.json"));
+}
+
+FString UCPM_DependencyCacheSubsystem::MakeKey(const FName RootPackage, const TArray<FString>& FilterPaths)
+{
+	TArray<FString> SortedFilters = FilterPaths;
+	SortedFilters.Sort();
+	return RootPackage.ToString() + TEXT("|") + FString::Join(SortedFilters, TEXT(";"));
+}
+
+FString UCPM_DependencyCacheSubsystem::GetFingerprint(const FName PackageName) const
+{
+	const TOptional<FAssetPackageData> PackageData = IAssetRegistry::GetChecked().GetAssetPackageDataCopy(PackageName);
+	if (!PackageData.IsSet())
+	{
+		return FString();
+	}
+	return FString::Printf(TEXT("%lld-%s"), PackageData->DiskSize, *LexToString(PackageData->GetPackageSavedHash()));
+}
+
+void UCPM_DependencyCacheSubsystem::GetDependencies(const FName RootPackage, const TArray<FString>& FilterPaths, TSet<FName>& AllDependencies,
+	TSet<FString>& ExternalObjectsPaths, TSet<FName>& ExcludedDependencies)
+{
+	const FString Key = MakeKey(RootPackage, FilterPaths);
+	FClosure* Closure = Closures.Find(Key);
+
+	if (Closure && !Closure->bVerified)
+	{
+		if (IsStillValid(*Closure))
+		{
+			Closure->bVerified = true;
+		}
+		else
+		{
+			Closures.Remove(Key);
+			Closure = nullptr;
+			bDirty = true;
+		}
+	}
+
+	if (Closure)
+	{
+		++NumHits;
+	}
+	else
+	{
+		++NumMisses;
+
+		FClosure NewClosure;
+		NewClosure.RootPackage = RootPackage;
+		NewClosure.FilterPaths = FilterPaths;
+		ComputeClosure(NewClosure);
+
+		// Until the initial scan is done the registry is incomplete, and no events would keep the closure current
+		if (!ShouldHandleRegistryEvents())
+		{
+			AllDependencies.Append(NewClosure.AllDependencies);
+			ExcludedDependencies.Append(NewClosure.ExcludedDependencies);
+			ExternalObjectsPaths.Append(NewClosure.ExternalObjectsPaths);
+			return;
+		}
+
+		NewClosure.bVerified = true;
+		Closure = &Closures.Add(Key, MoveTemp(NewClosure));
+		bDirty = true;
+
+		// A miss paid for a full walk, so writing the cache is cheap next to it and survives an editor crash.
+		// Invalidations are only saved with the next miss or on shutdown, a stale closure on disk fails its fingerprints.
+		SaveCache();
+	}
+
+	AllDependencies.Append(Closure->AllDependencies);
+	ExcludedDependencies.Append(Closure->ExcludedDependencies);
+	ExternalObjectsPaths.Append(Closure->ExternalObjectsPaths);
+}
+
+void UCPM_DependencyCacheSubsystem::ComputeClosure(FClosure& Closure) const
+{
+	// Deterministic order so a cached closure and a fresh one iterate the same way
+	FCPM_DependencyWalker::FSettings Settings;
+	Settings.bDeterministicOrder = true;
+	Settings.bRecordMissing = true;
+	FCPM_DependencyWalker Walker(IAssetRegistry::GetChecked(), Settings);
+
+	TSet<FName> AllDependencies;
+	TSet<FName> ExcludedDependencies;
+	TSet<FString> ExternalObjectsPaths;
+	Walker.Walk(Closure.RootPackage, AllDependencies, ExternalObjectsPaths, ExcludedDependencies, FCPM_DependencyWalker::MakeFilterPathsExclude(Closure.FilterPaths));
+
+	Closure.AllDependencies = AllDependencies.Array();
+	Closure.ExcludedDependencies = ExcludedDependencies.Array();
+	Closure.ExternalObjectsPaths = ExternalObjectsPaths.Array();
+
+	Closure.Fingerprints.Reset();
+	Closure.Fingerprints.Reserve(Closure.AllDependencies.Num() + Closure.ExcludedDependencies.Num() + Walker.GetMissingDependencies().Num() + 1);
+	Closure.Fingerprints.Add(Closure.RootPackage, GetFingerprint(Closure.RootPackage));
+	for (const FName Dependency : Closure.AllDependencies)
+	{
+		Closure.Fingerprints.Add(Dependency, GetFingerprint(Dependency));
+	}
+	for (const FName Dependency : Closure.ExcludedDependencies)
+	{
+		Closure.Fingerprints.Add(Dependency, GetFingerprint(Dependency));
+	}
+
+	// Skipped by the walk, an empty fingerprint that stops matching once the package shows up on disk
+	for (const FName Dependency : Walker.GetMissingDependencies())
+	{
+		Closure.Fingerprints.Add(Dependency, FString());
+	}
+}
+
+bool UCPM_DependencyCacheSubsystem::IsStillValid(const FClosure& Closure) const
+{
+	if (!ShouldHandleRegistryEvents())
+	{
+		return false;
+	}
+
+	for (const TPair<FName, FString>& Fingerprint : Closure.Fingerprints)
+	{
+		if (GetFingerprint(Fingerprint.Key) != Fingerprint.Value)
+		{
+			return false;
+		}
+	}
+
+	// External objects added while the editor was closed are in no fingerprint yet
+	IAssetRegistry& AssetRegistry = IAssetRegistry::GetChecked();
+	TArray<FAssetData> ExternalObjectAssets;
+	for (const FString& ExternalObjectsPath : Closure.ExternalObjectsPaths)
+	{
+		ExternalObjectAssets.Reset();
+		AssetRegistry.GetAssetsByPath(FName(*ExternalObjectsPath), ExternalObjectAssets, /*bRecursive*/true, /*bIncludeOnlyOnDiskAssets*/true);
+		for (const FAssetData& ExternalObjectAsset : ExternalObjectAssets)
+		{
+			if (!Closure.Fingerprints.Contains(ExternalObjectAsset.PackageName))
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+bool UCPM_DependencyCacheSubsystem::DependsOn(const FClosure& Closure, const FName PackageName) const
+{
+	if (Closure.Fingerprints.Contains(PackageName))
+	{
+		return true;
+	}
+
+	// A new external object belongs to its world even though nothing references it yet
+	for (const FString& ExternalObjectsPath : Closure.ExternalObjectsPaths)
+	{
+		if (FCPM_DependencyWalker::NameStartsWith(PackageName, ExternalObjectsPath))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void UCPM_DependencyCacheSubsystem::InvalidatePackage(const FName PackageName)
+{
+	int32 NumInvalidated = 0;
+	for (auto It = Closures.CreateIterator(); It; ++It)
+	{
+		if (DependsOn(It->Value, PackageName))
+		{
+			It.RemoveCurrent();
+			++NumInvalidated;
+		}
+	}
+
+	if (NumInvalidated > 0)
+	{
+		bDirty = true;
+		UE_LOG(LogTemp, Verbose, TEXT("Dependency cache: %s changed, dropped %d closures"), *PackageName.ToString(), NumInvalidated);
+	}
+}
+
+void UCPM_DependencyCacheSubsystem::ClearCache()
+{
+	bDirty |= Closures.Num() > 0;
+	Closures.Reset();
+}
+
+bool UCPM_DependencyCacheSubsystem::ShouldHandleRegistryEvents() const
+{
+	const IAssetRegistry* AssetRegistry = IAssetRegistry::Get();
+	return AssetRegistry && !AssetRegistry->IsLoadingAssets();
+}
+
+void UCPM_DependencyCacheSubsystem::OnAssetAdded(const FAssetData& AssetData)
+{
+	if (ShouldHandleRegistryEvents())
+	{
+		InvalidatePackage(AssetData.PackageName);
+	}
+}
+
+void UCPM_DependencyCacheSubsystem::OnAssetRemoved(const FAssetData& AssetData)
+{
+	if (ShouldHandleRegistryEvents())
+	{
+		InvalidatePackage(AssetData.PackageName);
+	}
+}
+
+void UCPM_DependencyCacheSubsystem::OnAssetUpdated(const FAssetData& AssetData)
+{
+	if (ShouldHandleRegistryEvents())
+	{
+		InvalidatePackage(AssetData.PackageName);
+	}
+}
+
+void UCPM_DependencyCacheSubsystem::OnAssetRenamed(const FAssetData& AssetData, const FString& OldObjectPath)
+{
+	if (ShouldHandleRegistryEvents())
+	{
+		InvalidatePackage(AssetData.PackageName);
+		InvalidatePackage(FName(*FPackageName::ObjectPathToPackageName(OldObjectPath)));
+	}
+}
+
+void UCPM_DependencyCacheSubsystem::OnPackageSaved(const FString& PackageFilename, UPackage* Package, FObjectPostSaveContext SaveContext)
+{
+	if (Package && !SaveContext.IsProceduralSave())
+	{
+		InvalidatePackage(Package->GetFName());
+	}
+}
+
+void UCPM_DependencyCacheSubsystem::LoadCache()
+{
+	FString Content;
+	if (!FFileHelper::LoadFileToString(Content, *GetCachePath()))
+	{
+		return;
+	}
+
+	TSharedPtr<FJsonObject> Root;
+	int32 Version = 0;
+	const TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(Content);
+	if (!FJsonSerializer::Deserialize(Reader, Root) || !Root.IsValid() || !Root->TryGetNumberField(TEXT("version"), Version) || Version != DependencyCacheFormatVersion)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Ignoring unreadable dependency cache %s"), *GetCachePath());
+		return;
+	}
+
+	const TArray<TSharedPtr<FJsonValue>>* ClosureValues = nullptr;
+	if (!Root->TryGetArrayField(TEXT("closures"), ClosureValues))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Ignoring unreadable dependency cache %s"), *GetCachePath());
+		return;
+	}
+
+	// A truncated or hand edited entry is skipped, it is recomputed on its next query
+	Closures.Reset();
+	int32 NumSkipped = 0;
+	for (const TSharedPtr<FJsonValue>& Value : *ClosureValues)
+	{
+		const TSharedPtr<FJsonObject>* Object = nullptr;
+		FString RootPackage;
+		const TArray<TSharedPtr<FJsonValue>>* Filters = nullptr;
+		const TArray<TSharedPtr<FJsonValue>>* All = nullptr;
+		const TArray<TSharedPtr<FJsonValue>>* Excluded = nullptr;
+		const TArray<TSharedPtr<FJsonValue>>* External = nullptr;
+		const TSharedPtr<FJsonObject>* FingerprintsObject = nullptr;
+		if (!Value.IsValid() || !Value->TryGetObject(Object)
+			|| !(*Object)->TryGetStringField(TEXT("root"), RootPackage)
+			|| !(*Object)->TryGetArrayField(TEXT("filters"), Filters)
+			|| !(*Object)->TryGetArrayField(TEXT("all"), All)
+			|| !(*Object)->TryGetArrayField(TEXT("excluded"), Excluded)
+			|| !(*Object)->TryGetArrayField(TEXT("external"), External)
+			|| !(*Object)->TryGetObjectField(TEXT("fingerprints"), FingerprintsObject))
+		{
+			++NumSkipped;
+			continue;
+		}
+
+		FClosure Closure;
+		Closure.RootPackage = FName(*RootPackage);
+		FromJsonArray(*Filters, Closure.FilterPaths);
+		FromJsonArray(*All, Closure.AllDependencies);
+		FromJsonArray(*Excluded, Closure.ExcludedDependencies);
+		FromJsonArray(*External, Closure.ExternalObjectsPaths);
+
+		Closure.Fingerprints.Reserve((*FingerprintsObject)->Values.Num());
+		for (const TPair<FString, TSharedPtr<FJsonValue>>& Fingerprint : (*FingerprintsObject)->Values)
+		{
+			FString Hash;
+			if (Fingerprint.Value.IsValid() && Fingerprint.Value->TryGetString(Hash))
+			{
+				Closure.Fingerprints.Add(FName(*Fingerprint.Key), Hash);
+			}
+		}
+
+		Closures.Add(MakeKey(Closure.RootPackage, Closure.FilterPaths), MoveTemp(Closure));
+	}
+
+	// Skipped entries are dropped from the file with the next save
+	bDirty = NumSkipped > 0;
+	UE_LOG(LogTemp, Log, TEXT("Loaded %d cached dependency closures, skipped %d unreadable ones"), Closures.Num(), NumSkipped);
+}
+
+void UCPM_DependencyCacheSubsystem::SaveCache()
+{
+	if (!bDirty)
+	{
+		return;
+	}
+
+	TArray<TSharedPtr<FJsonValue>> ClosureValues;
+	ClosureValues.Reserve(Closures.Num());
+	for (const TPair<FString, FClosure>& Pair : Closures)
+	{
+		const FClosure& Closure = Pair.Value;
+
+		const TSharedPtr<FJsonObject> FingerprintsObject = MakeShared<FJsonObject>();
+		for (const TPair<FName, FString>& Fingerprint : Closure.Fingerprints)
+		{
+			FingerprintsObject->SetStringField(Fingerprint.Key.ToString(), Fingerprint.Value);
+		}
+
+		const TSharedPtr<FJsonObject> Object = MakeShared<FJsonObject>();
+		Object->SetStringField(TEXT("root"), Closure.RootPackage.ToString());
+		Object->SetArrayField(TEXT("filters"), ToJsonArray(Closure.FilterPaths));
+		Object->SetArrayField(TEXT("all"), ToJsonArray(Closure.AllDependencies));
+		Object->SetArrayField(TEXT("excluded"), ToJsonArray(Closure.ExcludedDependencies));
+		Object->SetArrayField(TEXT("external"), ToJsonArray(Closure.ExternalObjectsPaths));
+		Object->SetObjectField(TEXT("fingerprints"), FingerprintsObject);
+		ClosureValues.Add(MakeShared<FJsonValueObject>(Object));
+	}
+
+	const TSharedPtr<FJsonObject> Root = MakeShared<FJsonObject>();
+	Root->SetNumberField(TEXT("version"), DependencyCacheFormatVersion);
+	Root->SetArrayField(TEXT("closures"), ClosureValues);
+
+	FString Output;
+	const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Output);
+	if (FJsonSerializer::Serialize(Root.ToSharedRef(), Writer) && FFileHelper::SaveStringToFile(Output, *GetCachePath()))
+	{
+		bDirty = false;
+	}
+}
@@ -0,0 +1,324 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CPM_DependencyGraph.h"
+#include "CPM_DependencyWalker.h"
+#include "Async/ParallelFor.h"
+#include "AssetRegistry/AssetData.h"
+#include "AssetRegistry/IAssetRegistry.h"
+#include "Engine/Level.h"
+
+namespace
+{
+	/** What one frontier package contributes to the graph */
+	struct FExpandedNode
+	{
+		TArray<FName> Dependencies;
+		bool bIsWorldPackage = false;
+	};
+}
+
+FCPM_DependencyGraph::FCPM_DependencyGraph()
+	: AssetRegistry(IAssetRegistry::GetChecked())
+{
+}
+
+FCPM_DependencyGraph::FCPM_DependencyGraph(IAssetRegistry& InAssetRegistry)
+	: AssetRegistry(InAssetRegistry)
+{
+}
+
+int32 FCPM_DependencyGraph::FindPackage(const FName PackageName) const
+{
+	const int32* PackageIndex = PackageIndices.Find(PackageName);
+	return PackageIndex ? *PackageIndex : INDEX_NONE;
+}
+
+void FCPM_DependencyGraph::Build(const TArray<FName>& RootPackages, const TFunction<bool(FName)>& ShouldExcludeFromDependenciesSearch)
+{
+	Packages.Reset();
+	PackageIndices.Reset();
+	Excluded.Reset();
+	RootIndices.Reset();
+	EdgeOffsets.Reset();
+	Edges.Reset();
+	ExternalEdges.Reset();
+	WorldExternalObjectsPaths.Reset();
+	NumProcessed = 0;
+
+	// Adjacency is collected per package and compressed once the graph is complete
+	TArray<TArray<int32>> Adjacency;
+	TArray<TArray<int32>> ExternalAdjacency;
+	TBitArray<> Expanded;
+	auto AddPackage = [&](const FName PackageName)
+	{
+		bool bAlreadyInTable = false;
+		const int32 PackageIndex = PackageIndices.Add(PackageName, Packages.Num(), &bAlreadyInTable);
+		if (!bAlreadyInTable)
+		{
+			Packages.Add(PackageName);
+			Excluded.Add(ShouldExcludeFromDependenciesSearch(PackageName));
+			Expanded.Add(false);
+			Adjacency.AddDefaulted();
+			ExternalAdjacency.AddDefaulted();
+		}
+		return PackageIndex;
+	};
+
+	// Roots are expanded even when the filter matches them, they only stop the walks of other roots
+	TArray<int32> Frontier;
+	for (const FName RootPackage : RootPackages)
+	{
+		const int32 RootIndex = AddPackage(RootPackage);
+		RootIndices.Add(RootIndex);
+		if (!Expanded[RootIndex])
+		{
+			Expanded[RootIndex] = true;
+			Frontier.Add(RootIndex);
+		}
+	}
+
+	// Registry reads from worker threads are only safe once the initial scan is complete
+	const bool bForceScan = AssetRegistry.IsLoadingAssets();
+	const EParallelForFlags ExpandFlags = bForceScan ? EParallelForFlags::ForceSingleThread : EParallelForFlags::Unbalanced;
+	TSet<FString> KnownPaths;
+	TArray<FString> PendingPaths;
+	TMap<FString, int32> PathOwners;
+
+	while (Frontier.Num() > 0 || PendingPaths.Num() > 0)
+	{
+		// Out of work, every external objects folder found so far is scanned in one batch
+		if (Frontier.Num() == 0)
+		{
+			AssetRegistry.ScanPathsSynchronous(PendingPaths, bForceScan, /*bIgnoreDenyListScanFilters*/true);
+
+			TArray<FAssetData> ExternalObjectAssets;
+			for (const FString& ExternalObjectsPath : PendingPaths)
+			{
+				const int32 Owner = PathOwners.FindChecked(ExternalObjectsPath);
+				ExternalObjectAssets.Reset();
+				AssetRegistry.GetAssetsByPath(FName(*ExternalObjectsPath), ExternalObjectAssets, /*bRecursive*/true, /*bIncludeOnlyOnDiskAssets*/true);
+				for (const FAssetData& ExternalObjectAsset : ExternalObjectAssets)
+				{
+					// External objects are part of the world that owns them, the exclude callback does not apply on
+					// that edge. Reached from anywhere else, an excluded one stays excluded.
+					const int32 PackageIndex = AddPackage(ExternalObjectAsset.PackageName);
+					ExternalAdjacency[Owner].Add(PackageIndex);
+					if (!Expanded[PackageIndex])
+					{
+						Expanded[PackageIndex] = true;
+						Frontier.Add(PackageIndex);
+					}
+				}
+			}
+			PendingPaths.Reset();
+			continue;
+		}
+
+		NumProcessed += Frontier.Num();
+		TArray<FExpandedNode> Results;
+		Results.SetNum(Frontier.Num());
+		ParallelFor(Frontier.Num(), [&](const int32 Index)
+		{
+			FExpandedNode& Result = Results[Index];
+			const FName PackageName = Packages[Frontier[Index]];
+
+			AssetRegistry.GetDependencies(PackageName, Result.Dependencies);
+
+			// The asset registry can give some reference to some deleted assets. We don't want to migrate these.
+			Result.Dependencies.RemoveAll([this](const FName Dependency)
+			{
+				return FCPM_DependencyWalker::IsScriptPackage(Dependency) || !AssetRegistry.DoesPackageExistOnDisk(Dependency);
+			});
+
+			TArray<FAssetData> Assets;
+			Result.bIsWorldPackage = FCPM_DependencyWalker::IsWorldPackage(AssetRegistry, PackageName, Assets);
+		}, ExpandFlags);
+
+		// Merged in frontier order so the package table comes out the same on every run
+		TArray<int32> NextFrontier;
+		for (int32 Index = 0; Index < Frontier.Num(); ++Index)
+		{
+			const int32 Node = Frontier[Index];
+			for (const FName Dependency : Results[Index].Dependencies)
+			{
+				const int32 PackageIndex = AddPackage(Dependency);
+				Adjacency[Node].Add(PackageIndex);
+				if (!Excluded[PackageIndex] && !Expanded[PackageIndex])
+				{
+					Expanded[PackageIndex] = true;
+					NextFrontier.Add(PackageIndex);
+				}
+			}
+
+			if (!Results[Index].bIsWorldPackage)
+			{
+				continue;
+			}
+
+			TArray<FString>& WorldPaths = WorldExternalObjectsPaths.Add(Node);
+			for (const FString& ExternalObjectsPath : ULevel::GetExternalObjectsPaths(Packages[Node].ToString()))
+			{
+				if (ExternalObjectsPath.IsEmpty())
+				{
+					continue;
+				}
+				WorldPaths.Add(ExternalObjectsPath);
+
+				bool bAlreadyKnown = false;
+				KnownPaths.Add(ExternalObjectsPath, &bAlreadyKnown);
+				if (!bAlreadyKnown)
+				{
+					PendingPaths.Add(ExternalObjectsPath);
+					PathOwners.Add(ExternalObjectsPath, Node);
+				}
+			}
+		}
+		Frontier = MoveTemp(NextFrontier);
+	}
+
+	EdgeOffsets.Reserve(Packages.Num() + 1);
+	int32 NumEdges = 0;
+	for (int32 PackageIndex = 0; PackageIndex < Adjacency.Num(); ++PackageIndex)
+	{
+		NumEdges += Adjacency[PackageIndex].Num() + ExternalAdjacency[PackageIndex].Num();
+	}
+	Edges.Reserve(NumEdges);
+	ExternalEdges.Reserve(NumEdges);
+	for (int32 PackageIndex = 0; PackageIndex < Adjacency.Num(); ++PackageIndex)
+	{
+		EdgeOffsets.Add(Edges.Num());
+		Edges.Append(Adjacency[PackageIndex]);
+		ExternalEdges.Add(false, Adjacency[PackageIndex].Num());
+		Edges.Append(ExternalAdjacency[PackageIndex]);
+		ExternalEdges.Add(true, ExternalAdjacency[PackageIndex].Num());
+	}
+	EdgeOffsets.Add(Edges.Num());
+}
+
+void FCPM_DependencyGraph::VisitClosure(const int32 RootNumber, TBitArray<>& Visited, TArray<int32>& Stack, TArray<int32>& OutDependencies, TArray<int32>& OutExcluded) const
+{
+	OutDependencies.Reset();
+	OutExcluded.Reset();
+	Stack.Reset();
+
+	// Like the walker, the root is only a dependency of itself when something refers back to it
+	const int32 RootIndex = RootIndices[RootNumber];
+	Stack.Add(RootIndex);
+	while (Stack.Num() > 0)
+	{
+		const int32 Node = Stack.Pop(/*bAllowShrinking*/false);
+		for (int32 EdgeIndex = EdgeOffsets[Node]; EdgeIndex < EdgeOffsets[Node + 1]; ++EdgeIndex)
+		{
+			const int32 Dependency = Edges[EdgeIndex];
+			if (Visited[Dependency])
+			{
+				// Reached as excluded first, its world's external objects edge still makes it a dependency, as in the walker.
+				// Promoted ones are no longer in OutExcluded, so this happens once per package.
+				if (ExternalEdges[EdgeIndex] && Excluded[Dependency] && OutExcluded.RemoveSingleSwap(Dependency, /*bAllowShrinking*/false) > 0)
+				{
+					OutDependencies.Add(Dependency);
+					if (Dependency != RootIndex)
+					{
+						Stack.Add(Dependency);
+					}
+				}
+				continue;
+			}
+			Visited[Dependency] = true;
+
+			if (Excluded[Dependency] && !ExternalEdges[EdgeIndex])
+			{
+				OutExcluded.Add(Dependency);
+				continue;
+			}
+
+			OutDependencies.Add(Dependency);
+			if (Dependency != RootIndex)
+			{
+				Stack.Add(Dependency);
+			}
+		}
+	}
+
+	OutDependencies.Sort();
+	OutExcluded.Sort();
+}
+
+void FCPM_DependencyGraph::ForEachClosure(FClosureVisitor Visitor) const
+{
+	TBitArray<> Visited(false, Packages.Num());
+	TArray<int32> Stack;
+	TArray<int32> Dependencies;
+	TArray<int32> ExcludedDependencies;
+
+	for (int32 RootNumber = 0; RootNumber < RootIndices.Num(); ++RootNumber)
+	{
+		VisitClosure(RootNumber, Visited, Stack, Dependencies, ExcludedDependencies);
+		Visitor(RootNumber, Dependencies, ExcludedDependencies);
+
+		// Only the bits this root touched are cleared, not the whole table
+		for (const int32 PackageIndex : Dependencies)
+		{
+			Visited[PackageIndex] = false;
+		}
+		for (const int32 PackageIndex : ExcludedDependencies)
+		{
+			Visited[PackageIndex] = false;
+		}
+	}
+}
+
+void FCPM_DependencyGraph::GetClosure(const int32 RootNumber, TBitArray<>& OutDependencies, TBitArray<>& OutExcludedDependencies) const
+{
+	TBitArray<> Visited(false, Packages.Num());
+	TArray<int32> Stack;
+	TArray<int32> Dependencies;
+	TArray<int32> ExcludedDependencies;
+	VisitClosure(RootNumber, Visited, Stack, Dependencies, ExcludedDependencies);
+
+	OutDependencies.Init(false, Packages.Num());
+	for (const int32 PackageIndex : Dependencies)
+	{
+		OutDependencies[PackageIndex] = true;
+	}
+	OutExcludedDependencies.Init(false, Packages.Num());
+	for (const int32 PackageIndex : ExcludedDependencies)
+	{
+		OutExcludedDependencies[PackageIndex] = true;
+	}
+}
+
+void FCPM_DependencyGraph::GetExternalObjectsPaths(const int32 RootNumber, const TArray<int32>& Dependencies, TSet<FString>& OutPaths) const
+{
+	if (const TArray<FString>* RootPaths = WorldExternalObjectsPaths.Find(RootIndices[RootNumber]))
+	{
+		OutPaths.Append(*RootPaths);
+	}
+	for (const int32 PackageIndex : Dependencies)
+	{
+		if (const TArray<FString>* Paths = WorldExternalObjectsPaths.Find(PackageIndex))
+		{
+			OutPaths.Append(*Paths);
+		}
+	}
+}
+
+TArray<int32> FCPM_DependencyGraph::CountRootsPerPackage() const
+{
+	TArray<int32> RootCounts;
+	RootCounts.SetNumZeroed(Packages.Num());
+	ForEachClosure([&RootCounts](int32, const TArray<int32>& Dependencies, const TArray<int32>&)
+	{
+		for (const int32 PackageIndex : Dependencies)
+		{
+			RootCounts[PackageIndex]++;
+		}
+	});
+	return RootCounts;
+}
+
+int32 FCPM_DependencyGraph::CountOverlap(const TBitArray<>& A, const TBitArray<>& B)
+{
+	return TBitArray<>::BitwiseAND(A, B, EBitwiseOperatorFlags::MinSize).CountSetBits();
+}
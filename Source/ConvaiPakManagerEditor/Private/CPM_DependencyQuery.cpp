@@ -0,0 +1,129 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CPM_DependencyQuery.h"
+#include "CPM_DependencyWalker.h"
+#include "AssetRegistry/IAssetRegistry.h"
+#include "Async/Async.h"
+#include "Misc/PackageName.h"
+
+TFuture<void> FCPM_DependencyQuery::ScanOnGameThread(const TArray<FString>& Paths, const bool bForceRescan)
+{
+	TSharedRef<TPromise<void>, ESPMode::ThreadSafe> Promise = MakeShared<TPromise<void>, ESPMode::ThreadSafe>();
+	TFuture<void> Future = Promise->GetFuture();
+
+	AsyncTask(ENamedThreads::GameThread, [Paths, bForceRescan, Promise]()
+	{
+		if (IAssetRegistry* AssetRegistry = IAssetRegistry::Get())
+		{
+			AssetRegistry->ScanPathsSynchronous(Paths, bForceRescan, /*bIgnoreDenyListScanFilters*/true);
+		}
+		Promise->SetValue();
+	});
+	return Future;
+}
+
+void FCPM_DependencyQuery::Start(const FName PackageName, const TArray<FString>& FilterPaths, const bool bDeterministicOrder, const bool bWithSizes, FOnCompleted InOnCompleted)
+{
+	FCPM_DependencyQueryResult Result;
+	Result.PackageName = PackageName;
+
+	if (PackageName.IsNone() || FPackageName::GetPackageMountPoint(PackageName.ToString()).IsNone())
+	{
+		InOnCompleted.ExecuteIfBound(Result);
+		return;
+	}
+
+	IAssetRegistry& AssetRegistry = IAssetRegistry::GetChecked();
+	if (AssetRegistry.IsLoadingAssets())
+	{
+		// The walk reads the registry from the thread pool, which only holds up once the initial scan is done
+		TSharedRef<FDelegateHandle> Handle = MakeShared<FDelegateHandle>();
+		*Handle = AssetRegistry.OnFilesLoaded().AddLambda([Handle, Result, FilterPaths, bDeterministicOrder, bWithSizes, OnCompleted = MoveTemp(InOnCompleted)]() mutable
+		{
+			const FDelegateHandle Registered = *Handle;
+			Dispatch(MoveTemp(Result), FilterPaths, bDeterministicOrder, bWithSizes, MoveTemp(OnCompleted));
+			IAssetRegistry::GetChecked().OnFilesLoaded().Remove(Registered);
+		});
+		return;
+	}
+
+	Dispatch(MoveTemp(Result), FilterPaths, bDeterministicOrder, bWithSizes, MoveTemp(InOnCompleted));
+}
+
+void FCPM_DependencyQuery::Dispatch(FCPM_DependencyQueryResult&& Result, const TArray<FString>& FilterPaths, const bool bDeterministicOrder, const bool bWithSizes, FOnCompleted&& InOnCompleted)
+{
+	Async(EAsyncExecution::ThreadPool, [Result = MoveTemp(Result), FilterPaths, bDeterministicOrder, bWithSizes, OnCompleted = MoveTemp(InOnCompleted)]() mutable
+	{
+		const double StartTime = FPlatformTime::Seconds();
+
+		FCPM_DependencyWalker::FSettings Settings;
+		Settings.bDeterministicOrder = bDeterministicOrder;
+		Settings.bRecordReferencers = bWithSizes;
+		Settings.ScanPaths = &FCPM_DependencyQuery::ScanOnGameThread;
+		FCPM_DependencyWalker Walker(IAssetRegistry::GetChecked(), Settings);
+
+		TSet<FName> AllDependencies;
+		TSet<FString> ExternalObjectsPaths;
+		TSet<FName> ExcludedDependencies;
+		Walker.Walk(Result.PackageName, AllDependencies, ExternalObjectsPaths, ExcludedDependencies, FCPM_DependencyWalker::MakeFilterPathsExclude(FilterPaths));
+
+		Result.bSuccess = true;
+		Result.bAllInsideSameRoot = FCPM_DependencyWalker::AreUnderSameMountPoint(Result.PackageName, AllDependencies);
+		Result.AllDependencies = AllDependencies.Array();
+		Result.ExternalObjectsPaths = ExternalObjectsPaths.Array();
+		Result.ExcludedDependencies = ExcludedDependencies.Array();
+		Result.NumScans = Walker.GetNumScans();
+		if (bWithSizes)
+		{
+			FCPM_DependencyAttribution::Build(IAssetRegistry::GetChecked(), Result.PackageName, AllDependencies, &Walker, Result.SizeReport);
+		}
+		Result.TotalSeconds = FPlatformTime::Seconds() - StartTime;
+
+		UE_LOG(LogTemp, Log, TEXT("Dependencies of %s: %d packages, %d excluded, %d processed, %d external object paths in %d scans, %.3fs (async)"),
+			*Result.PackageName.ToString(), Result.AllDependencies.Num(), Result.ExcludedDependencies.Num(), Walker.GetNumProcessed(),
+			Result.ExternalObjectsPaths.Num(), Result.NumScans, Result.TotalSeconds);
+
+		AsyncTask(ENamedThreads::GameThread, [Result = MoveTemp(Result), OnCompleted = MoveTemp(OnCompleted)]()
+		{
+			OnCompleted.ExecuteIfBound(Result);
+		});
+	});
+}
+
+UCPM_GetPackageDependenciesProxy* UCPM_GetPackageDependenciesProxy::GetPackageDependenciesProxy(const FName& PackageName, const TArray<FString>& FilterPaths, const bool bDeterministicOrder, const bool bWithSizes)
+{
+	UCPM_GetPackageDependenciesProxy* Proxy = NewObject<UCPM_GetPackageDependenciesProxy>();
+	Proxy->M_PackageName = PackageName;
+	Proxy->M_FilterPaths = FilterPaths;
+	Proxy->M_bDeterministicOrder = bDeterministicOrder;
+	Proxy->M_bWithSizes = bWithSizes;
+	return Proxy;
+}
+
+void UCPM_GetPackageDependenciesProxy::Activate()
+{
+	AddToRoot();
+
+	TWeakObjectPtr<UCPM_GetPackageDependenciesProxy> WeakThis(this);
+	FCPM_DependencyQuery::Start(M_PackageName, M_FilterPaths, M_bDeterministicOrder, M_bWithSizes, FCPM_DependencyQuery::FOnCompleted::CreateLambda([WeakThis](const FCPM_DependencyQueryResult& Result)
+	{
+		if (!WeakThis.IsValid())
+		{
+			return;
+		}
+
+		UCPM_GetPackageDependenciesProxy* Proxy = WeakThis.Get();
+		if (Result.bSuccess)
+		{
+			Proxy->OnSuccess.Broadcast(Result);
+		}
+		else
+		{
+			Proxy->OnFailure.Broadcast(Result);
+		}
+
+		Proxy->RemoveFromRoot();
+		Proxy->SetReadyToDestroy();
+	}));
+}
@@ -0,0 +1,93 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CPM_DependencyReport.h"
+#include "CPM_DependencyWalker.h"
+#include "AssetRegistry/AssetData.h"
+#include "AssetRegistry/IAssetRegistry.h"
+#include "Misc/PackageName.h"
+
+namespace
+{
+	void AddToBucket(TMap<FString, FCPM_DependencySizeBucket>& Buckets, const FString& Key, const int64 DiskSize)
+	{
+		FCPM_DependencySizeBucket& Bucket = Buckets.FindOrAdd(Key);
+		Bucket.Key = Key;
+		Bucket.NumPackages++;
+		Bucket.DiskSize += DiskSize;
+	}
+
+	TArray<FCPM_DependencySizeBucket> SortedBuckets(const TMap<FString, FCPM_DependencySizeBucket>& Buckets)
+	{
+		TArray<FCPM_DependencySizeBucket> Result;
+		Buckets.GenerateValueArray(Result);
+		Result.Sort([](const FCPM_DependencySizeBucket& A, const FCPM_DependencySizeBucket& B)
+		{
+			return A.DiskSize > B.DiskSize;
+		});
+		return Result;
+	}
+}
+
+FString FCPM_DependencyAttribution::GetPackageAssetClass(IAssetRegistry& AssetRegistry, const FName PackageName)
+{
+	TArray<FAssetData> Assets;
+	AssetRegistry.GetAssetsByPackageName(PackageName, Assets, /*bIncludeOnlyOnDiskAssets*/true);
+	if (Assets.Num() == 0)
+	{
+		return FString();
+	}
+
+	const FName ShortName = FPackageName::GetShortFName(PackageName);
+	const FAssetData* MainAsset = Assets.FindByPredicate([ShortName](const FAssetData& AssetData)
+	{
+		return AssetData.AssetName == ShortName;
+	});
+	return (MainAsset ? *MainAsset : Assets[0]).AssetClassPath.GetAssetName().ToString();
+}
+
+void FCPM_DependencyAttribution::Build(IAssetRegistry& AssetRegistry, const FName RootPackage, const TSet<FName>& Packages, const FCPM_DependencyWalker* Walker,
+	FCPM_DependencySizeReport& OutReport)
+{
+	OutReport = FCPM_DependencySizeReport();
+	OutReport.RootPackage = RootPackage;
+	OutReport.Packages.Reserve(Packages.Num());
+
+	TMap<FString, FCPM_DependencySizeBucket> RootBuckets;
+	TMap<FString, FCPM_DependencySizeBucket> FolderBuckets;
+	TMap<FString, FCPM_DependencySizeBucket> ClassBuckets;
+
+	for (const FName PackageName : Packages)
+	{
+		FCPM_DependencySizeEntry& Entry = OutReport.Packages.AddDefaulted_GetRef();
+		Entry.PackageName = PackageName;
+		Entry.AssetClass = GetPackageAssetClass(AssetRegistry, PackageName);
+		if (Walker)
+		{
+			Walker->GetReferencerChain(PackageName, Entry.ReferencerChain);
+		}
+
+		const TOptional<FAssetPackageData> PackageData = AssetRegistry.GetAssetPackageDataCopy(PackageName);
+		if (!PackageData.IsSet() || PackageData->DiskSize < 0)
+		{
+			Entry.DiskSize = -1;
+			OutReport.NumWithoutPackageData++;
+			continue;
+		}
+		Entry.DiskSize = PackageData->DiskSize;
+		OutReport.TotalDiskSize += Entry.DiskSize;
+
+		const FString PackageString = PackageName.ToString();
+		AddToBucket(RootBuckets, TEXT("/") + FPackageName::GetPackageMountPoint(PackageString).ToString() + TEXT("/"), Entry.DiskSize);
+		AddToBucket(FolderBuckets, FPackageName::GetLongPackagePath(PackageString), Entry.DiskSize);
+		AddToBucket(ClassBuckets, Entry.AssetClass.IsEmpty() ? TEXT("Unknown") : Entry.AssetClass, Entry.DiskSize);
+	}
+
+	OutReport.Packages.Sort([](const FCPM_DependencySizeEntry& A, const FCPM_DependencySizeEntry& B)
+	{
+		return A.DiskSize > B.DiskSize;
+	});
+	OutReport.ByRoot = SortedBuckets(RootBuckets);
+	OutReport.ByFolder = SortedBuckets(FolderBuckets);
+	OutReport.ByAssetClass = SortedBuckets(ClassBuckets);
+}
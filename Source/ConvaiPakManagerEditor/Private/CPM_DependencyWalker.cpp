@@ -0,0 +1,514 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CPM_DependencyWalker.h"
+#include "Algo/Reverse.h"
+#include "Async/ParallelFor.h"
+#include <atomic>
+#include "AssetRegistry/AssetData.h"
+#include "AssetRegistry/IAssetRegistry.h"
+#include "Engine/Level.h"
+#include "Engine/World.h"
+#include "Misc/PackageName.h"
+#include "UObject/NameTypes.h"
+
+namespace
+{
+	/** What one frontier package contributes to the next level */
+	struct FExpandedPackage
+	{
+		TArray<FName> Included;
+		TArray<FName> Excluded;
+		TArray<FName> Missing;
+		bool bIsWorldPackage = false;
+	};
+
+	void SortByName(TArray<FName>& Names)
+	{
+		Names.Sort(FNameLexicalLess());
+	}
+}
+
+FCPM_DependencyWalker::FCPM_DependencyWalker()
+	: AssetRegistry(IAssetRegistry::GetChecked())
+{
+}
+
+FCPM_DependencyWalker::FCPM_DependencyWalker(IAssetRegistry& InAssetRegistry)
+	: AssetRegistry(InAssetRegistry)
+{
+}
+
+FCPM_DependencyWalker::FCPM_DependencyWalker(IAssetRegistry& InAssetRegistry, const FSettings& InSettings)
+	: AssetRegistry(InAssetRegistry)
+	, Settings(InSettings)
+{
+}
+
+bool FCPM_DependencyWalker::FShardedNameSet::TryAdd(const FName Name)
+{
+	const uint32 Hash = GetTypeHash(Name);
+	FShard& Shard = Shards[Hash % NumShards];
+
+	bool bAlreadyInSet = false;
+	FScopeLock Lock(&Shard.Mutex);
+	Shard.Names.AddByHash(Hash, Name, &bAlreadyInSet);
+	return !bAlreadyInSet;
+}
+
+void FCPM_DependencyWalker::FShardedNameSet::Reset()
+{
+	for (FShard& Shard : Shards)
+	{
+		FScopeLock Lock(&Shard.Mutex);
+		Shard.Names.Reset();
+	}
+}
+
+bool FCPM_DependencyWalker::NameStartsWith(const FName Name, const FStringView Prefix)
+{
+	const FNameBuilder NameBuilder(Name);
+	return NameBuilder.ToView().StartsWith(Prefix);
+}
+
+bool FCPM_DependencyWalker::IsScriptPackage(const FName PackageName)
+{
+	return NameStartsWith(PackageName, TEXTVIEW("/Script"));
+}
+
+TFunction<bool(FName)> FCPM_DependencyWalker::MakeFilterPathsExclude(const TArray<FString>& FilterPaths)
+{
+	return [FilterPaths](const FName Dependency)
+	{
+		for (const FString& FilterPath : FilterPaths)
+		{
+			if (!FilterPath.IsEmpty() && NameStartsWith(Dependency, FilterPath))
+			{
+				return true;
+			}
+		}
+		return false;
+	};
+}
+
+bool FCPM_DependencyWalker::AreUnderSameMountPoint(const FName RootPackage, const TSet<FName>& Packages)
+{
+	const FName MountPoint = FPackageName::GetPackageMountPoint(RootPackage.ToString());
+	if (MountPoint.IsNone())
+	{
+		return false;
+	}
+
+	const FString Root = TEXT("/") + MountPoint.ToString() + TEXT("/");
+	for (const FName Package : Packages)
+	{
+		if (!NameStartsWith(Package, Root))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void FCPM_DependencyWalker::Enqueue(const FName PackageName)
+{
+	bool bAlreadyProcessed = false;
+	Processed.Add(PackageName, &bAlreadyProcessed);
+	if (!bAlreadyProcessed)
+	{
+		Worklist.Add(PackageName);
+	}
+}
+
+bool FCPM_DependencyWalker::AddDependency(const FName PackageName, TSet<FName>& AllDependencies)
+{
+	AllDependencies.Add(PackageName);
+	Enqueue(PackageName);
+	if (Settings.StopAt && Settings.StopAt(PackageName))
+	{
+		bStopped = true;
+	}
+	return !bStopped;
+}
+
+bool FCPM_DependencyWalker::IsPastDeadline() const
+{
+	return Deadline > 0.0 && FPlatformTime::Seconds() > Deadline;
+}
+
+void FCPM_DependencyWalker::RecordReferencer(const FName PackageName, const FName Referencer)
+{
+	if (Settings.bRecordReferencers && PackageName != Root)
+	{
+		Referencers.FindOrAdd(PackageName, Referencer);
+	}
+}
+
+bool FCPM_DependencyWalker::GetReferencerChain(const FName PackageName, TArray<FName>& OutChain) const
+{
+	OutChain.Reset();
+	FName Current = PackageName;
+	while (Current != Root)
+	{
+		const FName* Referencer = Referencers.Find(Current);
+		if (!Referencer || OutChain.Num() > Referencers.Num())
+		{
+			OutChain.Reset();
+			return false;
+		}
+		OutChain.Add(Current);
+		Current = *Referencer;
+	}
+	OutChain.Add(Root);
+	Algo::Reverse(OutChain);
+	return true;
+}
+
+void FCPM_DependencyWalker::Walk(const FName RootPackage, TSet<FName>& AllDependencies, TSet<FString>& ExternalObjectsPaths, TSet<FName>& ExcludedDependencies,
+	const TFunction<bool(FName)>& ShouldExcludeFromDependenciesSearch)
+{
+	Worklist.Reset();
+	Processed.Reset();
+	Seen.Reset();
+	PendingPaths.Reset();
+	ScanningPaths.Reset();
+	ScanFuture = TFuture<void>();
+	Referencers.Reset();
+	Missing.Reset();
+	ExternalPathOwners.Reset();
+	Root = RootPackage;
+	NumProcessed = 0;
+	NumLevels = 0;
+	NumScans = 0;
+	bStopped = false;
+	Deadline = Settings.TimeLimitSeconds > 0.0 ? FPlatformTime::Seconds() + Settings.TimeLimitSeconds : 0.0;
+
+	// Registry reads are only safe off the game thread once the initial scan is complete, and only then
+	// does the registry already know what is on disk so a scan does not need to be forced
+	const bool bRegistryReady = !AssetRegistry.IsLoadingAssets();
+	bWasParallel = Settings.bParallel && bRegistryReady;
+	bForceScan = Settings.bForceRescan || !bRegistryReady;
+	const bool bScanElsewhere = static_cast<bool>(Settings.ScanPaths);
+
+	if (bWasParallel)
+	{
+		// Everything already in the output sets counts as seen, like the contains checks of the serial walk
+		for (const FName Dependency : AllDependencies)
+		{
+			Seen.TryAdd(Dependency);
+		}
+		for (const FName Dependency : ExcludedDependencies)
+		{
+			Seen.TryAdd(Dependency);
+		}
+	}
+
+	Enqueue(RootPackage);
+
+	while (!bStopped)
+	{
+		if (Worklist.Num() > 0)
+		{
+			if (bWasParallel)
+			{
+				ExpandLevel(AllDependencies, ExternalObjectsPaths, ExcludedDependencies, ShouldExcludeFromDependenciesSearch);
+			}
+			else
+			{
+				ExpandSerial(AllDependencies, ExternalObjectsPaths, ExcludedDependencies, ShouldExcludeFromDependenciesSearch);
+			}
+
+			// A scan that runs elsewhere overlaps with expanding the rest of the graph
+			if (bScanElsewhere && !ScanFuture.IsValid() && PendingPaths.Num() > 0)
+			{
+				StartScan();
+			}
+			continue;
+		}
+
+		// Out of work, the external objects are the only way the walk can go on
+		if (ScanFuture.IsValid())
+		{
+			FinishScan(AllDependencies);
+			continue;
+		}
+		if (PendingPaths.Num() == 0)
+		{
+			break;
+		}
+		StartScan();
+	}
+}
+
+void FCPM_DependencyWalker::ExpandSerial(TSet<FName>& AllDependencies, TSet<FString>& ExternalObjectsPaths, TSet<FName>& ExcludedDependencies,
+	const TFunction<bool(FName)>& ShouldExcludeFromDependenciesSearch)
+{
+	// Packages are never removed from the worklist while it drains, the read index is the queue head
+	for (int32 Head = 0; Head < Worklist.Num(); ++Head)
+	{
+		if (IsPastDeadline())
+		{
+			bStopped = true;
+			return;
+		}
+
+		const FName PackageName = Worklist[Head];
+		++NumProcessed;
+
+		DependencyBuffer.Reset();
+		AssetRegistry.GetDependencies(PackageName, DependencyBuffer);
+
+		for (const FName Dependency : DependencyBuffer)
+		{
+			// The asset registry can give some reference to some deleted assets. We don't want to migrate these.
+			if (IsScriptPackage(Dependency))
+			{
+				continue;
+			}
+			if (!AssetRegistry.DoesPackageExistOnDisk(Dependency))
+			{
+				if (Settings.bRecordMissing)
+				{
+					Missing.Add(Dependency);
+				}
+				continue;
+			}
+
+			const uint32 DependencyHash = GetTypeHash(Dependency);
+			if (AllDependencies.ContainsByHash(DependencyHash, Dependency) || ExcludedDependencies.ContainsByHash(DependencyHash, Dependency))
+			{
+				continue;
+			}
+
+			// Early stop the dependency search
+			RecordReferencer(Dependency, PackageName);
+			if (ShouldExcludeFromDependenciesSearch(Dependency))
+			{
+				ExcludedDependencies.AddByHash(DependencyHash, Dependency);
+				continue;
+			}
+
+			if (!AddDependency(Dependency, AllDependencies))
+			{
+				return;
+			}
+		}
+
+		if (IsWorldPackage(AssetRegistry, PackageName, AssetBuffer))
+		{
+			CollectExternalObjectsPaths(PackageName, ExternalObjectsPaths);
+		}
+	}
+	Worklist.Reset();
+}
+
+void FCPM_DependencyWalker::ExpandLevel(TSet<FName>& AllDependencies, TSet<FString>& ExternalObjectsPaths, TSet<FName>& ExcludedDependencies,
+	const TFunction<bool(FName)>& ShouldExcludeFromDependenciesSearch)
+{
+	// Worklist collects the next level, Processed keeps a package from being expanded twice
+	const TArray<FName> Frontier = MoveTemp(Worklist);
+	Worklist.Reset();
+	++NumLevels;
+	NumProcessed += Frontier.Num();
+
+	TArray<FExpandedPackage> Expanded;
+	Expanded.SetNum(Frontier.Num());
+
+	const EParallelForFlags Flags = Frontier.Num() < Settings.MinParallelFrontier
+		? EParallelForFlags::ForceSingleThread : EParallelForFlags::Unbalanced;
+	std::atomic<bool> bPastDeadline { false };
+	ParallelFor(Frontier.Num(), [&](const int32 Index)
+	{
+		if (bPastDeadline || IsPastDeadline())
+		{
+			bPastDeadline = true;
+			return;
+		}
+		FExpandedPackage& Result = Expanded[Index];
+
+		TArray<FName> Dependencies;
+		AssetRegistry.GetDependencies(Frontier[Index], Dependencies);
+
+		for (const FName Dependency : Dependencies)
+		{
+			// The asset registry can give some reference to some deleted assets. We don't want to migrate these.
+			if (IsScriptPackage(Dependency))
+			{
+				continue;
+			}
+			if (!AssetRegistry.DoesPackageExistOnDisk(Dependency))
+			{
+				if (Settings.bRecordMissing)
+				{
+					Result.Missing.Add(Dependency);
+				}
+				continue;
+			}
+
+			// Only the worker that claims a package decides whether it is excluded
+			if (!Seen.TryAdd(Dependency))
+			{
+				continue;
+			}
+
+			if (ShouldExcludeFromDependenciesSearch(Dependency))
+			{
+				Result.Excluded.Add(Dependency);
+			}
+			else
+			{
+				Result.Included.Add(Dependency);
+			}
+		}
+
+		TArray<FAssetData> Assets;
+		Result.bIsWorldPackage = IsWorldPackage(AssetRegistry, Frontier[Index], Assets);
+	}, Flags);
+
+	// Which worker claimed a package varies between runs, the set found on a level does not
+	TArray<FName> LevelIncluded;
+	TArray<FName> LevelExcluded;
+	for (int32 Index = 0; Index < Frontier.Num(); ++Index)
+	{
+		FExpandedPackage& Result = Expanded[Index];
+		if (Settings.bRecordReferencers)
+		{
+			for (const FName Dependency : Result.Included)
+			{
+				RecordReferencer(Dependency, Frontier[Index]);
+			}
+			for (const FName Dependency : Result.Excluded)
+			{
+				RecordReferencer(Dependency, Frontier[Index]);
+			}
+		}
+		LevelIncluded.Append(MoveTemp(Result.Included));
+		LevelExcluded.Append(MoveTemp(Result.Excluded));
+		Missing.Append(Result.Missing);
+	}
+	if (Settings.bDeterministicOrder)
+	{
+		SortByName(LevelIncluded);
+		SortByName(LevelExcluded);
+	}
+
+	ExcludedDependencies.Append(LevelExcluded);
+	for (const FName Dependency : LevelIncluded)
+	{
+		if (!AddDependency(Dependency, AllDependencies))
+		{
+			return;
+		}
+	}
+
+	// What the level found before the deadline is still reported, but it is not expanded further
+	if (bPastDeadline)
+	{
+		bStopped = true;
+		return;
+	}
+
+	for (int32 Index = 0; Index < Frontier.Num(); ++Index)
+	{
+		if (Expanded[Index].bIsWorldPackage)
+		{
+			CollectExternalObjectsPaths(Frontier[Index], ExternalObjectsPaths);
+		}
+	}
+}
+
+bool FCPM_DependencyWalker::IsWorldPackage(IAssetRegistry& AssetRegistry, const FName PackageName, TArray<FAssetData>& OutAssets)
+{
+	// The migration only work on the saved version of the assets so no need to scan the for the in memory only assets
+	const bool bOnlyIncludeOnDiskAssets = true;
+
+	OutAssets.Reset();
+	if (!AssetRegistry.GetAssetsByPackageName(PackageName, OutAssets, bOnlyIncludeOnDiskAssets))
+	{
+		return false;
+	}
+
+	// Compared by path, GetClass() resolves the class object and that is not safe off the game thread
+	const FTopLevelAssetPath WorldClassPath = UWorld::StaticClass()->GetClassPathName();
+	return OutAssets.ContainsByPredicate([&WorldClassPath](const FAssetData& AssetData)
+	{
+		return AssetData.AssetClassPath == WorldClassPath;
+	});
+}
+
+void FCPM_DependencyWalker::CollectExternalObjectsPaths(const FName PackageName, TSet<FString>& ExternalObjectsPaths)
+{
+	for (const FString& ExternalObjectsPath : ULevel::GetExternalObjectsPaths(PackageName.ToString()))
+	{
+		if (ExternalObjectsPath.IsEmpty())
+		{
+			continue;
+		}
+
+		bool bAlreadyKnown = false;
+		ExternalObjectsPaths.Add(ExternalObjectsPath, &bAlreadyKnown);
+		if (!bAlreadyKnown)
+		{
+			PendingPaths.Add(ExternalObjectsPath);
+			ExternalPathOwners.Add(ExternalObjectsPath, PackageName);
+		}
+	}
+}
+
+void FCPM_DependencyWalker::StartScan()
+{
+	ScanningPaths = MoveTemp(PendingPaths);
+	PendingPaths.Reset();
+	++NumScans;
+
+	if (Settings.ScanPaths)
+	{
+		ScanFuture = Settings.ScanPaths(ScanningPaths, bForceScan);
+	}
+	else
+	{
+		AssetRegistry.ScanPathsSynchronous(ScanningPaths, bForceScan, /*bIgnoreDenyListScanFilters*/true);
+		ScanFuture = MakeFulfilledPromise<void>().GetFuture();
+	}
+}
+
+void FCPM_DependencyWalker::FinishScan(TSet<FName>& AllDependencies)
+{
+	ScanFuture.Wait();
+	ScanFuture = TFuture<void>();
+
+	// The migration only work on the saved version of the assets so no need to scan the for the in memory only assets
+	const bool bOnlyIncludeOnDiskAssets = true;
+
+	TArray<FName> ExternalPackages;
+	for (const FString& ExternalObjectsPath : ScanningPaths)
+	{
+		AssetBuffer.Reset();
+		AssetRegistry.GetAssetsByPath(FName(*ExternalObjectsPath), AssetBuffer, /*bRecursive*/true, bOnlyIncludeOnDiskAssets);
+		const FName Owner = ExternalPathOwners.FindRef(ExternalObjectsPath);
+		for (const FAssetData& ExternalObjectAsset : AssetBuffer)
+		{
+			ExternalPackages.Add(ExternalObjectAsset.PackageName);
+			RecordReferencer(ExternalObjectAsset.PackageName, Owner);
+		}
+	}
+	ScanningPaths.Reset();
+
+	if (Settings.bDeterministicOrder)
+	{
+		SortByName(ExternalPackages);
+	}
+
+	for (const FName ExternalPackage : ExternalPackages)
+	{
+		// External objects are part of the world that owns them, the exclude callback does not apply to them
+		if (bWasParallel)
+		{
+			Seen.TryAdd(ExternalPackage);
+		}
+		if (!AddDependency(ExternalPackage, AllDependencies))
+		{
+			return;
+		}
+	}
+}
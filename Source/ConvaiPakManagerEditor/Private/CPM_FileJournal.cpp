@@ -0,0 +1,696 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CPM_FileJournal.h"
+#include "Utility/CPM_FileHash.h"
+#include "Utility/CPM_UtilityLibrary.h"
+#include "Algo/BinarySearch.h"
+#include "Algo/Reverse.h"
+#include "Async/Async.h"
+#include "DirectoryWatcherModule.h"
+#include "IDirectoryWatcher.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/QueuedThreadPool.h"
+#include "Modules/ModuleManager.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/JsonSerializer.h"
+
+namespace
+{
+	constexpr int32 JournalFormatVersion = 1;
+
+	FString NormalizePath(const FString& Path)
+	{
+		FString Result = FPaths::ConvertRelativePathToFull(Path);
+		FPaths::NormalizeFilename(Result);
+		FPaths::RemoveDuplicateSlashes(Result);
+		return Result;
+	}
+
+	const TCHAR* LexChange(const ECPM_FileChange Change)
+	{
+		switch (Change)
+		{
+		case ECPM_FileChange::Added: return TEXT("added");
+		case ECPM_FileChange::Removed: return TEXT("removed");
+		default: return TEXT("modified");
+		}
+	}
+
+	ECPM_FileChange ParseChange(const FString& Change)
+	{
+		return Change == TEXT("added") ? ECPM_FileChange::Added : Change == TEXT("removed") ? ECPM_FileChange::Removed : ECPM_FileChange::Modified;
+	}
+}
+
+FCPM_FileJournal& FCPM_FileJournal::Get()
+{
+	static FCPM_FileJournal Instance;
+	return Instance;
+}
+
+FString FCPM_FileJournal::GetJournalPath()
+{
+	return FPaths::Combine(UCPM_UtilityLibrary::CPM_GetCacheDirectory(), TEXT("FileJournal"), TEXT("Journal.json"));
+}
+
+void FCPM_FileJournal::Start()
+{
+	if (bStarted)
+	{
+		return;
+	}
+	bStarted = true;
+
+	ProjectDir = NormalizePath(FPaths::ProjectDir());
+	FPaths::NormalizeDirectoryName(ProjectDir);
+	IgnoreRules = FCPM_IgnoreRules::MakeForProject();
+
+	TrackedDirectories.Reset();
+	for (const FString& Directory : UCPM_UtilityLibrary::GetProjectDirectoriesToZip())
+	{
+		TrackedDirectories.Add(ToRelativePath(NormalizePath(Directory)));
+	}
+	// ConvaiEssentials is zipped whole except for zips, as a directory the files added to it later are tracked too
+	const FString EssentialsDirectory = TEXT("ConvaiEssentials");
+	if (FPaths::DirectoryExists(ToFullPath(EssentialsDirectory)))
+	{
+		TrackedDirectories.Add(EssentialsDirectory);
+		IgnoreRules.AddPattern(TEXT("/ConvaiEssentials/*.zip"));
+	}
+
+	TrackedFiles.Reset();
+	for (const FString& File : UCPM_UtilityLibrary::GetProjectFilesToZip())
+	{
+		const FString RelativePath = ToRelativePath(NormalizePath(File));
+		if (!RelativePath.StartsWith(EssentialsDirectory + TEXT("/")))
+		{
+			TrackedFiles.Add(RelativePath);
+		}
+	}
+
+	Load();
+	bStopRequested = false;
+
+	if (FDirectoryWatcherModule* DirectoryWatcherModule = FModuleManager::LoadModulePtr<FDirectoryWatcherModule>(TEXT("DirectoryWatcher")))
+	{
+		IDirectoryWatcher* DirectoryWatcher = DirectoryWatcherModule->Get();
+
+		// Tracked directories are watched with their subtree, loose files through their parent only
+		TMap<FString, uint32> DirectoriesToWatch;
+		for (const FString& Directory : TrackedDirectories)
+		{
+			DirectoriesToWatch.Add(ToFullPath(Directory), 0);
+		}
+		for (const FString& File : TrackedFiles)
+		{
+			DirectoriesToWatch.FindOrAdd(FPaths::GetPath(ToFullPath(File)), IDirectoryWatcher::WatchOptions::IgnoreChangesInSubtree);
+		}
+
+		for (const TPair<FString, uint32>& Directory : DirectoriesToWatch)
+		{
+			FDelegateHandle Handle;
+			if (DirectoryWatcher && DirectoryWatcher->RegisterDirectoryChangedCallback_Handle(Directory.Key,
+				IDirectoryWatcher::FDirectoryChanged::CreateRaw(this, &FCPM_FileJournal::OnDirectoryChanged), Handle, Directory.Value))
+			{
+				WatcherHandles.Emplace(Directory.Key, Handle);
+			}
+		}
+	}
+
+	// The first reconcile hashes the whole project, on its own lowest priority thread it only takes idle time
+	ReconcilePool = FQueuedThreadPool::Allocate();
+	if (!ReconcilePool->Create(1, 128 * 1024, TPri_Lowest, TEXT("CPM_FileJournal")))
+	{
+		delete ReconcilePool;
+		ReconcilePool = nullptr;
+	}
+	if (ReconcilePool)
+	{
+		ReconcileFuture = AsyncPool(*ReconcilePool, [this]() { Reconcile(); });
+	}
+	else
+	{
+		ReconcileFuture = Async(EAsyncExecution::ThreadPool, [this]() { Reconcile(); });
+	}
+}
+
+void FCPM_FileJournal::Stop()
+{
+	if (!bStarted)
+	{
+		return;
+	}
+	bStarted = false;
+
+	if (FDirectoryWatcherModule* DirectoryWatcherModule = FModuleManager::GetModulePtr<FDirectoryWatcherModule>(TEXT("DirectoryWatcher")))
+	{
+		if (IDirectoryWatcher* DirectoryWatcher = DirectoryWatcherModule->Get())
+		{
+			for (const TPair<FString, FDelegateHandle>& WatcherHandle : WatcherHandles)
+			{
+				DirectoryWatcher->UnregisterDirectoryChangedCallback_Handle(WatcherHandle.Key, WatcherHandle.Value);
+			}
+		}
+	}
+	WatcherHandles.Reset();
+
+	// A reconcile still hashing stops at the next file, what it did not get to is picked up on the next start
+	bStopRequested = true;
+	Flush();
+	if (ReconcilePool)
+	{
+		ReconcilePool->Destroy();
+		delete ReconcilePool;
+		ReconcilePool = nullptr;
+	}
+	Save();
+}
+
+void FCPM_FileJournal::Flush()
+{
+	if (ReconcileFuture.IsValid())
+	{
+		ReconcileFuture.Wait();
+	}
+
+	// Processing may have been restarted by a change that arrived while waiting
+	while (true)
+	{
+		TFuture<void> Pending;
+		{
+			FScopeLock Lock(&Mutex);
+			if (!bProcessing || !ProcessFuture.IsValid())
+			{
+				break;
+			}
+			Pending = MoveTemp(ProcessFuture);
+		}
+		Pending.Wait();
+	}
+}
+
+bool FCPM_FileJournal::IsReconciled() const
+{
+	return bStarted && ReconcileFuture.IsValid() && ReconcileFuture.IsReady();
+}
+
+void FCPM_FileJournal::Reconcile()
+{
+	const double StartTime = FPlatformTime::Seconds();
+
+	TArray<FString> Directories;
+	for (const FString& Directory : TrackedDirectories)
+	{
+		Directories.Add(ToFullPath(Directory));
+	}
+	TArray<FString> Files;
+	for (const FString& File : TrackedFiles)
+	{
+		Files.Add(ToFullPath(File));
+	}
+	const TArray<FCPM_WalkedFile> WalkedFiles = FCPM_FileWalker::Walk(Directories, Files, IgnoreRules, ProjectDir);
+
+	// Only files whose size or timestamp differ from the journal are hashed
+	TSet<FString> Seen;
+	TArray<FString> ToRefresh;
+	TArray<FString> Removed;
+	{
+		FScopeLock Lock(&Mutex);
+		Seen.Reserve(WalkedFiles.Num());
+		for (const FCPM_WalkedFile& File : WalkedFiles)
+		{
+			const FString RelativePath = ToRelativePath(File.Path);
+			Seen.Add(RelativePath);
+
+			const FCPM_FileRecord* Record = Records.Find(RelativePath);
+			if (!Record || Record->Size != File.Size || Record->Timestamp != File.Timestamp)
+			{
+				ToRefresh.Add(RelativePath);
+			}
+		}
+
+		for (const TPair<FString, FCPM_FileRecord>& Record : Records)
+		{
+			if (!Seen.Contains(Record.Key))
+			{
+				Removed.Add(Record.Key);
+			}
+		}
+		for (const FString& RelativePath : Removed)
+		{
+			RemoveRecordsLocked(RelativePath);
+		}
+	}
+
+	// One file at a time, spreading this over the shared workers would compete with the editor
+	int32 NumRefreshed = 0;
+	for (; NumRefreshed < ToRefresh.Num() && !bStopRequested; ++NumRefreshed)
+	{
+		RefreshFile(ToRefresh[NumRefreshed]);
+	}
+
+	Save();
+	UE_LOG(LogTemp, Log, TEXT("File journal reconciled %d files in %.2fs, %d of %d rehashed, %d removed, sequence %llu"),
+		WalkedFiles.Num(), FPlatformTime::Seconds() - StartTime, NumRefreshed, ToRefresh.Num(), Removed.Num(), GetCurrentSequence());
+}
+
+void FCPM_FileJournal::OnDirectoryChanged(const TArray<FFileChangeData>& FileChanges)
+{
+	FScopeLock Lock(&Mutex);
+	for (const FFileChangeData& FileChange : FileChanges)
+	{
+		// The action does not matter, every path is re-checked against the disk
+		PendingPaths.Add(ToRelativePath(NormalizePath(FileChange.Filename)));
+	}
+
+	if (!bProcessing && PendingPaths.Num() > 0)
+	{
+		bProcessing = true;
+		ProcessFuture = Async(EAsyncExecution::ThreadPool, [this]() { ProcessPendingPaths(); });
+	}
+}
+
+void FCPM_FileJournal::ProcessPendingPaths()
+{
+	while (true)
+	{
+		TSet<FString> Paths;
+		{
+			FScopeLock Lock(&Mutex);
+			if (PendingPaths.Num() == 0)
+			{
+				bProcessing = false;
+				break;
+			}
+			Paths = MoveTemp(PendingPaths);
+			PendingPaths.Reset();
+		}
+
+		for (const FString& RelativePath : Paths)
+		{
+			RefreshFile(RelativePath);
+		}
+	}
+
+	// A build or a source control sync changes files in many small batches
+	SaveIfDue();
+}
+
+void FCPM_FileJournal::RefreshFile(const FString& RelativePath)
+{
+	// Anything that did not end up relative to the project is outside of it
+	if (RelativePath.IsEmpty() || RelativePath.StartsWith(TEXT("..")) || RelativePath.StartsWith(TEXT("/")) || RelativePath.Contains(TEXT(":")))
+	{
+		return;
+	}
+
+	const FString FullPath = ToFullPath(RelativePath);
+	const FFileStatData StatData = FPlatformFileManager::Get().GetPlatformFile().GetStatData(*FullPath);
+
+	if (!StatData.bIsValid)
+	{
+		// A removed directory is only reported once, every record below it goes with it
+		FScopeLock Lock(&Mutex);
+		RemoveRecordsLocked(RelativePath);
+		return;
+	}
+
+	if (StatData.bIsDirectory)
+	{
+		if (IsTracked(RelativePath, true))
+		{
+			for (const FCPM_WalkedFile& File : FCPM_FileWalker::Walk({ FullPath }, {}, IgnoreRules, ProjectDir))
+			{
+				RefreshFile(ToRelativePath(File.Path));
+			}
+		}
+		return;
+	}
+
+	if (!IsTracked(RelativePath, false))
+	{
+		return;
+	}
+
+	{
+		FScopeLock Lock(&Mutex);
+		const FCPM_FileRecord* Record = Records.Find(RelativePath);
+		if (Record && Record->Size == StatData.FileSize && Record->Timestamp == StatData.ModificationTime)
+		{
+			return;
+		}
+	}
+
+	// Hashing happens outside the lock, a file that cannot be read yet is picked up by its next change event
+	const FString Hash = FCPM_FileHash::SHA1FileHex(FullPath);
+	if (Hash.IsEmpty())
+	{
+		return;
+	}
+
+	FScopeLock Lock(&Mutex);
+	FCPM_FileRecord* Record = Records.Find(RelativePath);
+	const bool bContentChanged = !Record || Record->Hash != Hash;
+	if (!Record)
+	{
+		Record = &Records.Add(RelativePath);
+		Record->Path = RelativePath;
+	}
+	Record->Size = StatData.FileSize;
+	Record->Timestamp = StatData.ModificationTime;
+	Record->Hash = Hash;
+	bDirty = true;
+
+	// A save without content changes only refreshes size and timestamp
+	if (bContentChanged)
+	{
+		AppendChangeLocked(RelativePath, Record->Sequence == 0 ? ECPM_FileChange::Added : ECPM_FileChange::Modified);
+	}
+}
+
+void FCPM_FileJournal::RemoveRecordsLocked(const FString& RelativePath)
+{
+	if (Records.Remove(RelativePath) > 0)
+	{
+		AppendChangeLocked(RelativePath, ECPM_FileChange::Removed);
+		return;
+	}
+
+	const FString DirectoryPrefix = RelativePath + TEXT("/");
+	TArray<FString> Removed;
+	for (const TPair<FString, FCPM_FileRecord>& Record : Records)
+	{
+		if (Record.Key.StartsWith(DirectoryPrefix))
+		{
+			Removed.Add(Record.Key);
+		}
+	}
+	for (const FString& Path : Removed)
+	{
+		Records.Remove(Path);
+		AppendChangeLocked(Path, ECPM_FileChange::Removed);
+	}
+}
+
+void FCPM_FileJournal::AppendChangeLocked(const FString& RelativePath, const ECPM_FileChange Change)
+{
+	FCPM_FileChangeEntry& Entry = ChangeLog.AddDefaulted_GetRef();
+	Entry.Sequence = ++Sequence;
+	Entry.Path = RelativePath;
+	Entry.Change = Change;
+
+	if (FCPM_FileRecord* Record = Records.Find(RelativePath))
+	{
+		Record->Sequence = Entry.Sequence;
+	}
+	bDirty = true;
+
+	if (ChangeLog.Num() > Records.Num() * 2 + 10000)
+	{
+		CompactLogLocked();
+	}
+}
+
+void FCPM_FileJournal::CompactLogLocked()
+{
+	// Only the latest entry of a path can show up in a query, older ones are dropped
+	TSet<FString> Seen;
+	TArray<FCPM_FileChangeEntry> Compacted;
+	for (int32 Index = ChangeLog.Num() - 1; Index >= 0; --Index)
+	{
+		bool bAlreadySeen = false;
+		Seen.Add(ChangeLog[Index].Path, &bAlreadySeen);
+		if (!bAlreadySeen)
+		{
+			Compacted.Add(MoveTemp(ChangeLog[Index]));
+		}
+	}
+	Algo::Reverse(Compacted);
+	ChangeLog = MoveTemp(Compacted);
+}
+
+uint64 FCPM_FileJournal::GetCurrentSequence() const
+{
+	FScopeLock Lock(&Mutex);
+	return Sequence;
+}
+
+uint64 FCPM_FileJournal::MarkSnapshot(const FString& Name)
+{
+	uint64 SnapshotSequence = 0;
+	{
+		FScopeLock Lock(&Mutex);
+		Snapshots.Add(Name, Sequence);
+		SnapshotSequence = Sequence;
+		bDirty = true;
+	}
+	Save();
+	return SnapshotSequence;
+}
+
+bool FCPM_FileJournal::GetSnapshotSequence(const FString& Name, uint64& OutSequence) const
+{
+	FScopeLock Lock(&Mutex);
+	if (const uint64* Found = Snapshots.Find(Name))
+	{
+		OutSequence = *Found;
+		return true;
+	}
+	return false;
+}
+
+TArray<FCPM_FileChangeEntry> FCPM_FileJournal::GetChangesSince(const uint64 InSequence) const
+{
+	FScopeLock Lock(&Mutex);
+
+	// The log is ordered by sequence, so the first entry after InSequence is found by binary search
+	const int32 First = Algo::UpperBoundBy(ChangeLog, InSequence, &FCPM_FileChangeEntry::Sequence);
+
+	TSet<FString> Seen;
+	TArray<FCPM_FileChangeEntry> Result;
+	for (int32 Index = ChangeLog.Num() - 1; Index >= First; --Index)
+	{
+		bool bAlreadySeen = false;
+		Seen.Add(ChangeLog[Index].Path, &bAlreadySeen);
+		if (!bAlreadySeen)
+		{
+			Result.Add(ChangeLog[Index]);
+		}
+	}
+	Algo::Reverse(Result);
+	return Result;
+}
+
+bool FCPM_FileJournal::GetChangesSinceSnapshot(const FString& Name, TArray<FCPM_FileChangeEntry>& OutChanges) const
+{
+	uint64 SnapshotSequence = 0;
+	if (!GetSnapshotSequence(Name, SnapshotSequence))
+	{
+		return false;
+	}
+	OutChanges = GetChangesSince(SnapshotSequence);
+	return true;
+}
+
+bool FCPM_FileJournal::FindRecord(const FString& RelativePath, FCPM_FileRecord& OutRecord) const
+{
+	FScopeLock Lock(&Mutex);
+	if (const FCPM_FileRecord* Record = Records.Find(RelativePath))
+	{
+		OutRecord = *Record;
+		return true;
+	}
+	return false;
+}
+
+bool FCPM_FileJournal::IsTracked(const FString& RelativePath, const bool bIsDirectory) const
+{
+	if (TrackedFiles.Contains(RelativePath))
+	{
+		return true;
+	}
+
+	const bool bUnderTrackedDirectory = TrackedDirectories.ContainsByPredicate([&RelativePath](const FString& Directory)
+	{
+		return RelativePath == Directory || RelativePath.StartsWith(Directory + TEXT("/"));
+	});
+	if (!bUnderTrackedDirectory)
+	{
+		return false;
+	}
+
+	// Same answer as the walker, which never descends into an ignored directory
+	for (int32 SlashIndex = RelativePath.Find(TEXT("/")); SlashIndex != INDEX_NONE; SlashIndex = RelativePath.Find(TEXT("/"), ESearchCase::CaseSensitive, ESearchDir::FromStart, SlashIndex + 1))
+	{
+		if (IgnoreRules.IsIgnored(RelativePath.Left(SlashIndex), true))
+		{
+			return false;
+		}
+	}
+	return !IgnoreRules.IsIgnored(RelativePath, bIsDirectory);
+}
+
+FString FCPM_FileJournal::ToRelativePath(const FString& FullPath) const
+{
+	FString RelativePath = FullPath;
+	if (RelativePath.StartsWith(ProjectDir + TEXT("/")))
+	{
+		RelativePath.RightChopInline(ProjectDir.Len() + 1);
+	}
+	else
+	{
+		FPaths::MakePathRelativeTo(RelativePath, *(ProjectDir + TEXT("/")));
+	}
+	return RelativePath;
+}
+
+FString FCPM_FileJournal::ToFullPath(const FString& RelativePath) const
+{
+	return FPaths::Combine(ProjectDir, RelativePath);
+}
+
+void FCPM_FileJournal::Load()
+{
+	FString Content;
+	if (!FFileHelper::LoadFileToString(Content, *GetJournalPath()))
+	{
+		return;
+	}
+
+	TSharedPtr<FJsonObject> Root;
+	const TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(Content);
+	if (!FJsonSerializer::Deserialize(Reader, Root) || !Root.IsValid() || Root->GetIntegerField(TEXT("version")) != JournalFormatVersion)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Ignoring unreadable file journal %s"), *GetJournalPath());
+		return;
+	}
+
+	FScopeLock Lock(&Mutex);
+	Records.Reset();
+	ChangeLog.Reset();
+	Snapshots.Reset();
+	Sequence = FCString::Strtoui64(*Root->GetStringField(TEXT("sequence")), nullptr, 10);
+
+	for (const TSharedPtr<FJsonValue>& Value : Root->GetArrayField(TEXT("files")))
+	{
+		const TSharedPtr<FJsonObject>& Object = Value->AsObject();
+		FCPM_FileRecord Record;
+		Record.Path = Object->GetStringField(TEXT("path"));
+		Record.Size = FCString::Atoi64(*Object->GetStringField(TEXT("size")));
+		Record.Timestamp = FDateTime(FCString::Atoi64(*Object->GetStringField(TEXT("mtime"))));
+		Record.Hash = Object->GetStringField(TEXT("hash"));
+		Record.Sequence = FCString::Strtoui64(*Object->GetStringField(TEXT("seq")), nullptr, 10);
+		Records.Add(Record.Path, MoveTemp(Record));
+	}
+
+	for (const TSharedPtr<FJsonValue>& Value : Root->GetArrayField(TEXT("log")))
+	{
+		const TSharedPtr<FJsonObject>& Object = Value->AsObject();
+		FCPM_FileChangeEntry& Entry = ChangeLog.AddDefaulted_GetRef();
+		Entry.Sequence = FCString::Strtoui64(*Object->GetStringField(TEXT("seq")), nullptr, 10);
+		Entry.Path = Object->GetStringField(TEXT("path"));
+		Entry.Change = ParseChange(Object->GetStringField(TEXT("change")));
+	}
+
+	const TSharedPtr<FJsonObject>* SnapshotsObject = nullptr;
+	if (Root->TryGetObjectField(TEXT("snapshots"), SnapshotsObject))
+	{
+		for (const TPair<FString, TSharedPtr<FJsonValue>>& Snapshot : (*SnapshotsObject)->Values)
+		{
+			Snapshots.Add(Snapshot.Key, FCString::Strtoui64(*Snapshot.Value->AsString(), nullptr, 10));
+		}
+	}
+}
+
+void FCPM_FileJournal::Save() const
+{
+	// Saves are serialized so an older copy never overwrites a newer one
+	FScopeLock SaveLock(&SaveMutex);
+
+	// Only the copy happens under Mutex, the watcher callback and MarkSnapshot never wait on the json and the disk
+	TArray<FCPM_FileRecord> RecordsCopy;
+	TArray<FCPM_FileChangeEntry> ChangeLogCopy;
+	TMap<FString, uint64> SnapshotsCopy;
+	uint64 SequenceCopy = 0;
+	{
+		FScopeLock Lock(&Mutex);
+		if (!bDirty)
+		{
+			return;
+		}
+		Records.GenerateValueArray(RecordsCopy);
+		ChangeLogCopy = ChangeLog;
+		SnapshotsCopy = Snapshots;
+		SequenceCopy = Sequence;
+		bDirty = false;
+	}
+
+	// 64 bit values do not survive a json double, they are written as strings
+	TArray<TSharedPtr<FJsonValue>> FileValues;
+	FileValues.Reserve(RecordsCopy.Num());
+	for (const FCPM_FileRecord& Record : RecordsCopy)
+	{
+		const TSharedPtr<FJsonObject> Object = MakeShared<FJsonObject>();
+		Object->SetStringField(TEXT("path"), Record.Path);
+		Object->SetStringField(TEXT("size"), LexToString(Record.Size));
+		Object->SetStringField(TEXT("mtime"), LexToString(Record.Timestamp.GetTicks()));
+		Object->SetStringField(TEXT("hash"), Record.Hash);
+		Object->SetStringField(TEXT("seq"), LexToString(Record.Sequence));
+		FileValues.Add(MakeShared<FJsonValueObject>(Object));
+	}
+
+	TArray<TSharedPtr<FJsonValue>> LogValues;
+	LogValues.Reserve(ChangeLogCopy.Num());
+	for (const FCPM_FileChangeEntry& Entry : ChangeLogCopy)
+	{
+		const TSharedPtr<FJsonObject> Object = MakeShared<FJsonObject>();
+		Object->SetStringField(TEXT("seq"), LexToString(Entry.Sequence));
+		Object->SetStringField(TEXT("path"), Entry.Path);
+		Object->SetStringField(TEXT("change"), LexChange(Entry.Change));
+		LogValues.Add(MakeShared<FJsonValueObject>(Object));
+	}
+
+	const TSharedPtr<FJsonObject> SnapshotsObject = MakeShared<FJsonObject>();
+	for (const TPair<FString, uint64>& Snapshot : SnapshotsCopy)
+	{
+		SnapshotsObject->SetStringField(Snapshot.Key, LexToString(Snapshot.Value));
+	}
+
+	const TSharedPtr<FJsonObject> Root = MakeShared<FJsonObject>();
+	Root->SetNumberField(TEXT("version"), JournalFormatVersion);
+	Root->SetStringField(TEXT("sequence"), LexToString(SequenceCopy));
+	Root->SetArrayField(TEXT("files"), FileValues);
+	Root->SetArrayField(TEXT("log"), LogValues);
+	Root->SetObjectField(TEXT("snapshots"), SnapshotsObject);
+
+	FString Output;
+	const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Output);
+	const bool bSaved = FJsonSerializer::Serialize(Root.ToSharedRef(), Writer) && FFileHelper::SaveStringToFile(Output, *GetJournalPath());
+
+	FScopeLock Lock(&Mutex);
+	if (bSaved)
+	{
+		LastSaveTime = FPlatformTime::Seconds();
+	}
+	else
+	{
+		bDirty = true;
+	}
+}
+
+void FCPM_FileJournal::SaveIfDue() const
+{
+	{
+		FScopeLock Lock(&Mutex);
+		if (FPlatformTime::Seconds() - LastSaveTime < SaveIntervalSeconds)
+		{
+			return;
+		}
+	}
+	Save();
+}
@@ -0,0 +1,195 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CPM_PackagingCache.h"
+#include "Utility/CPM_FileWalker.h"
+#include "Utility/CPM_UtilityLibrary.h"
+#include "ITurnkeySupportModule.h"
+#include "JsonObjectConverter.h"
+#include "Misc/EngineVersion.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "HAL/PlatformMemory.h"
+#include "HAL/PlatformMisc.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/JsonSerializer.h"
+
+namespace
+{
+	constexpr int32 SdkVerificationFormatVersion = 1;
+
+	FString GetSdkVerificationPath()
+	{
+		return FPaths::Combine(FCPM_PackagingCache::GetDirectory(), TEXT("SdkVerification.json"));
+	}
+
+	FString GetCookReportPath(const ECPM_Platform Platform)
+	{
+		return FPaths::Combine(FCPM_PackagingCache::GetDirectory(), TEXT("CookReport_")) + FCPM_PackagingCache::GetCookPlatformName(Platform) + TEXT(".json");
+	}
+}
+
+int32 UCPM_PackagingSettings::GetNumCookProcesses(const int32 NumPlatforms) const
+{
+	constexpr double GB = 1024.0 * 1024.0 * 1024.0;
+
+	const int32 CoreBudget = FMath::FloorToInt(FPlatformMisc::NumberOfCoresIncludingHyperthreads() * CpuBudgetPercent / 100.f);
+	const int32 ByCores = CoreBudget / FMath::Max(CoresPerCookProcess, 1);
+
+	const double MemoryBudget = MemoryBudgetGB > 0.f ? MemoryBudgetGB : FPlatformMemory::GetStats().AvailablePhysical / GB * 0.75;
+	const int32 ByMemory = FMath::FloorToInt(MemoryBudget / (FMath::Max(MemoryPerCookProcessGB, 1.f) * FMath::Max(NumPlatforms, 1)));
+
+	int32 NumProcesses = FMath::Min(ByCores, ByMemory);
+	if (MaxCookProcesses > 0)
+	{
+		NumProcesses = FMath::Min(NumProcesses, MaxCookProcesses);
+	}
+	return FMath::Max(NumProcesses, 1);
+}
+
+FString FCPM_PackagingCache::GetDirectory()
+{
+	return FPaths::Combine(UCPM_UtilityLibrary::CPM_GetCacheDirectory(), TEXT("Packaging"));
+}
+
+FString FCPM_PackagingCache::GetCookOutputDirectory()
+{
+	return FPaths::ConvertRelativePathToFull(FPaths::Combine(GetDirectory(), TEXT("Cooked")));
+}
+
+FString FCPM_PackagingCache::GetCookPlatformName(const ECPM_Platform Platform)
+{
+	switch (Platform)
+	{
+	case ECPM_Platform::Windows:
+		return FString(TEXT("Windows"));
+	case ECPM_Platform::Linux:
+		return FString(TEXT("Linux"));
+	default:
+		return FString();
+	}
+}
+
+FString FCPM_PackagingCache::GetInstalledSdkVersion(const FString& UatPlatform)
+{
+	// Not blocking, the editor queries every platform at startup and a missing answer only costs a VerifySdk run
+	const FTurnkeySdkInfo SdkInfo = ITurnkeySupportModule::Get().GetSdkInfo(FName(*UatPlatform), /*bBlockIfQuerying*/false);
+	if (SdkInfo.Status != ETurnkeyPlatformSdkStatus::Valid)
+	{
+		return FString();
+	}
+	return SdkInfo.InstalledVersion.IsEmpty() ? SdkInfo.AutoSDKVersion : SdkInfo.InstalledVersion;
+}
+
+TSharedPtr<FJsonObject> FCPM_PackagingCache::LoadSdkVerifications()
+{
+	FString Content;
+	TSharedPtr<FJsonObject> Root;
+	if (FFileHelper::LoadFileToString(Content, *GetSdkVerificationPath()))
+	{
+		const TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(Content);
+		if (!FJsonSerializer::Deserialize(Reader, Root) || !Root.IsValid() || Root->GetIntegerField(TEXT("version")) != SdkVerificationFormatVersion)
+		{
+			Root.Reset();
+		}
+	}
+
+	if (!Root.IsValid())
+	{
+		Root = MakeShared<FJsonObject>();
+		Root->SetNumberField(TEXT("version"), SdkVerificationFormatVersion);
+		Root->SetObjectField(TEXT("platforms"), MakeShared<FJsonObject>());
+	}
+	return Root;
+}
+
+bool FCPM_PackagingCache::IsSdkVerified(const FString& UatPlatform)
+{
+	const FString SdkVersion = GetInstalledSdkVersion(UatPlatform);
+	if (SdkVersion.IsEmpty())
+	{
+		return false;
+	}
+
+	const TSharedPtr<FJsonObject> Root = LoadSdkVerifications();
+	const TSharedPtr<FJsonObject>* Platforms = nullptr;
+	const TSharedPtr<FJsonObject>* Entry = nullptr;
+	if (!Root->TryGetObjectField(TEXT("platforms"), Platforms) || !(*Platforms)->TryGetObjectField(UatPlatform, Entry))
+	{
+		return false;
+	}
+
+	return (*Entry)->GetStringField(TEXT("engine_version")) == FEngineVersion::Current().ToString()
+		&& (*Entry)->GetStringField(TEXT("sdk_version")) == SdkVersion;
+}
+
+void FCPM_PackagingCache::MarkSdkVerified(const FString& UatPlatform)
+{
+	// A VerifySdk that updated the SDK leaves the old version here, the next run verifies once more and records the new one
+	const FString SdkVersion = GetInstalledSdkVersion(UatPlatform);
+	if (SdkVersion.IsEmpty())
+	{
+		return;
+	}
+
+	const TSharedPtr<FJsonObject> Root = LoadSdkVerifications();
+	const TSharedPtr<FJsonObject>* Platforms = nullptr;
+	if (!Root->TryGetObjectField(TEXT("platforms"), Platforms))
+	{
+		return;
+	}
+
+	const TSharedPtr<FJsonObject> Entry = MakeShared<FJsonObject>();
+	Entry->SetStringField(TEXT("engine_version"), FEngineVersion::Current().ToString());
+	Entry->SetStringField(TEXT("sdk_version"), SdkVersion);
+	Entry->SetStringField(TEXT("verified_at"), FDateTime::UtcNow().ToIso8601());
+	(*Platforms)->SetObjectField(UatPlatform, Entry);
+
+	FString Output;
+	const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Output);
+	if (FJsonSerializer::Serialize(Root.ToSharedRef(), Writer))
+	{
+		FFileHelper::SaveStringToFile(Output, *GetSdkVerificationPath());
+	}
+}
+
+void FCPM_PackagingCache::CountCookedPackages(const ECPM_Platform Platform, const FDateTime& Since, FCPM_CookReport& InOutReport)
+{
+	InOutReport.NumCookedPackages = 0;
+	InOutReport.NumRecookedPackages = 0;
+
+	const FString PlatformDirectory = FPaths::Combine(GetCookOutputDirectory(), GetCookPlatformName(Platform));
+	for (const FCPM_WalkedFile& File : FCPM_FileWalker::Walk({ PlatformDirectory }, {}, FCPM_IgnoreRules(), PlatformDirectory))
+	{
+		// Bulk data and .uexp files belong to a .uasset, counting those would count packages twice
+		const FString Extension = FPaths::GetExtension(File.Path);
+		if (Extension != TEXT("uasset") && Extension != TEXT("umap"))
+		{
+			continue;
+		}
+
+		InOutReport.NumCookedPackages++;
+		if (File.Timestamp >= Since)
+		{
+			InOutReport.NumRecookedPackages++;
+		}
+	}
+}
+
+void FCPM_PackagingCache::SaveCookReport(const FCPM_CookReport& Report)
+{
+	FString ReportString;
+	if (FJsonObjectConverter::UStructToJsonObjectString(Report, ReportString))
+	{
+		FFileHelper::SaveStringToFile(ReportString, *GetCookReportPath(Report.Platform));
+	}
+}
+
+bool FCPM_PackagingCache::LoadCookReport(const ECPM_Platform Platform, FCPM_CookReport& OutReport)
+{
+	FString ReportString;
+	return FFileHelper::LoadFileToString(ReportString, *GetCookReportPath(Platform))
+		&& FJsonObjectConverter::JsonObjectStringToUStruct(ReportString, &OutReport);
+}
@@ -0,0 +1,198 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CPM_PakBudget.h"
+#include "Dom/JsonObject.h"
+#include "Dom/JsonValue.h"
+#include "JsonObjectConverter.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+#include "Utility/CPM_UtilityLibrary.h"
+
+namespace
+{
+	constexpr int32 NumReportedEntries = 20;
+	constexpr int32 NumReportedBuckets = 10;
+
+	FString FormatMB(const int64 Bytes)
+	{
+		return FString::Printf(TEXT("%.1f MB"), Bytes / (1024.0 * 1024.0));
+	}
+
+	template <typename T>
+	TArray<T> FirstN(const TArray<T>& Source, const int32 Count)
+	{
+		return TArray<T>(Source.GetData(), FMath::Min(Count, Source.Num()));
+	}
+
+	FString GetHistoryFilePath(const FString& AssetID)
+	{
+		return FPaths::Combine(FCPM_PakBudgetGate::GetHistoryDirectory(), FPaths::MakeValidFileName(AssetID)) + TEXT(".json");
+	}
+
+	bool LoadHistory(const FString& AssetID, TArray<TSharedPtr<FJsonValue>>& OutHistory)
+	{
+		FString Content;
+		if (!FFileHelper::LoadFileToString(Content, *GetHistoryFilePath(AssetID)))
+		{
+			return false;
+		}
+
+		const TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(Content);
+		return FJsonSerializer::Deserialize(Reader, OutHistory);
+	}
+}
+
+UCPM_PakBudgetSettings::UCPM_PakBudgetSettings()
+{
+	constexpr int64 MB = 1024 * 1024;
+	Budgets.Add(ECPM_AssetType::Avatar, { 300 * MB, 64 * MB, 200 * MB });
+	Budgets.Add(ECPM_AssetType::Scene, { 2048 * MB, 512 * MB, 1024 * MB });
+}
+
+bool FCPM_PakBudgetGate::Evaluate(const FString& PakFilePath, const ECPM_AssetType AssetType, const FString& AssetID, FCPM_PakBudgetReport& OutReport)
+{
+	const UCPM_PakBudgetSettings* Settings = GetDefault<UCPM_PakBudgetSettings>();
+
+	OutReport = FCPM_PakBudgetReport();
+	OutReport.PakFilePath = PakFilePath;
+	OutReport.AssetID = AssetID;
+	OutReport.AssetType = AssetType;
+	if (const FCPM_PakBudget* Budget = Settings->Budgets.Find(AssetType))
+	{
+		OutReport.Budget = *Budget;
+	}
+
+	FCPM_PakInventory Inventory;
+	if (!FCPM_PakInventoryBuilder::Build(PakFilePath, Inventory))
+	{
+		OutReport.Violations.Add(FString::Printf(TEXT("Could not read pak index: %s"), *PakFilePath));
+		return false;
+	}
+
+	OutReport.TotalBytes = Inventory.FileSize;
+	for (const FCPM_PakInventoryEntry& Entry : Inventory.Entries)
+	{
+		if (Entry.AssetClass.StartsWith(TEXT("Texture")))
+		{
+			OutReport.TextureBytes += Entry.CompressedSize;
+		}
+	}
+	// Entries are sorted by size, largest first
+	if (Inventory.Entries.Num() > 0)
+	{
+		OutReport.LargestEntry = Inventory.Entries[0];
+	}
+	OutReport.TopEntries = FirstN(Inventory.Entries, NumReportedEntries);
+	OutReport.TopFolders = FirstN(Inventory.ByFolder, NumReportedBuckets);
+	OutReport.TopAssetClasses = FirstN(Inventory.ByAssetClass, NumReportedBuckets);
+
+	const FCPM_PakBudget& Budget = OutReport.Budget;
+	if (Budget.MaxTotalBytes > 0 && OutReport.TotalBytes > Budget.MaxTotalBytes)
+	{
+		OutReport.Violations.Add(FString::Printf(TEXT("Pak is %s, budget is %s"), *FormatMB(OutReport.TotalBytes), *FormatMB(Budget.MaxTotalBytes)));
+	}
+	if (Budget.MaxEntryBytes > 0 && OutReport.LargestEntry.CompressedSize > Budget.MaxEntryBytes)
+	{
+		OutReport.Violations.Add(FString::Printf(TEXT("%s is %s, single entry budget is %s"), *OutReport.LargestEntry.Filename,
+			*FormatMB(OutReport.LargestEntry.CompressedSize), *FormatMB(Budget.MaxEntryBytes)));
+	}
+	if (Budget.MaxTextureBytes > 0 && OutReport.TextureBytes > Budget.MaxTextureBytes)
+	{
+		OutReport.Violations.Add(FString::Printf(TEXT("Textures take %s, texture budget is %s"), *FormatMB(OutReport.TextureBytes), *FormatMB(Budget.MaxTextureBytes)));
+	}
+
+	if (!AssetID.IsEmpty())
+	{
+		OutReport.PreviousTotalBytes = LoadPreviousTotalBytes(AssetID);
+		const int64 Growth = OutReport.TotalBytes - OutReport.PreviousTotalBytes;
+		if (OutReport.PreviousTotalBytes > 0 && Growth * 100.0 > OutReport.PreviousTotalBytes * static_cast<double>(Settings->RegressionThresholdPercent))
+		{
+			const FString Message = FString::Printf(TEXT("Pak grew by %s (%.1f%%) since the previous build"), *FormatMB(Growth),
+				Growth * 100.0 / OutReport.PreviousTotalBytes);
+			(Settings->bFailOnRegression ? OutReport.Violations : OutReport.Warnings).Add(Message);
+		}
+	}
+
+	OutReport.bPassed = OutReport.Violations.Num() == 0;
+
+	// A rejected pak is not shipped, recording it would make the next build compare against it
+	if (!AssetID.IsEmpty() && OutReport.bPassed)
+	{
+		AppendHistory(OutReport, Settings->MaxHistoryEntries);
+	}
+
+	OutReport.ReportFilePath = FPaths::Combine(GetReportDirectory(), FPaths::GetBaseFilename(PakFilePath)) + TEXT(".json");
+	FString ReportString;
+	if (FJsonObjectConverter::UStructToJsonObjectString(OutReport, ReportString))
+	{
+		FFileHelper::SaveStringToFile(ReportString, *OutReport.ReportFilePath);
+	}
+
+	for (const FString& Violation : OutReport.Violations)
+	{
+		UCPM_UtilityLibrary::CPM_LogMessage(FString::Printf(TEXT("Pak budget violation: %s"), *Violation), ECPM_LogLevel::Error);
+	}
+	for (const FString& Warning : OutReport.Warnings)
+	{
+		UCPM_UtilityLibrary::CPM_LogMessage(FString::Printf(TEXT("Pak size warning: %s"), *Warning), ECPM_LogLevel::Warning);
+	}
+	return OutReport.bPassed;
+}
+
+FString FCPM_PakBudgetGate::GetHistoryDirectory()
+{
+	return FPaths::Combine(UCPM_UtilityLibrary::CPM_GetCacheDirectory(), TEXT("SizeHistory"));
+}
+
+FString FCPM_PakBudgetGate::GetReportDirectory()
+{
+	return FPaths::Combine(UCPM_UtilityLibrary::CPM_GetCacheDirectory(), TEXT("BudgetReports"));
+}
+
+int64 FCPM_PakBudgetGate::LoadPreviousTotalBytes(const FString& AssetID)
+{
+	TArray<TSharedPtr<FJsonValue>> History;
+	if (!LoadHistory(AssetID, History) || History.Num() == 0)
+	{
+		return 0;
+	}
+
+	const TSharedPtr<FJsonObject>* Last = nullptr;
+	int64 TotalBytes = 0;
+	if (History.Last()->TryGetObject(Last))
+	{
+		(*Last)->TryGetNumberField(TEXT("total_bytes"), TotalBytes);
+	}
+	return TotalBytes;
+}
+
+void FCPM_PakBudgetGate::AppendHistory(const FCPM_PakBudgetReport& Report, const int32 MaxEntries)
+{
+	TArray<TSharedPtr<FJsonValue>> History;
+	LoadHistory(Report.AssetID, History);
+
+	const TSharedPtr<FJsonObject> Record = MakeShared<FJsonObject>();
+	Record->SetStringField(TEXT("timestamp"), FDateTime::UtcNow().ToIso8601());
+	Record->SetStringField(TEXT("pak"), FPaths::GetCleanFilename(Report.PakFilePath));
+	Record->SetNumberField(TEXT("total_bytes"), Report.TotalBytes);
+	Record->SetNumberField(TEXT("texture_bytes"), Report.TextureBytes);
+	Record->SetNumberField(TEXT("largest_entry_bytes"), Report.LargestEntry.CompressedSize);
+	Record->SetStringField(TEXT("largest_entry"), Report.LargestEntry.Filename);
+	History.Add(MakeShared<FJsonValueObject>(Record));
+
+	if (History.Num() > MaxEntries)
+	{
+		History.RemoveAt(0, History.Num() - MaxEntries);
+	}
+
+	FString Output;
+	const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Output);
+	if (FJsonSerializer::Serialize(History, Writer))
+	{
+		FFileHelper::SaveStringToFile(Output, *GetHistoryFilePath(Report.AssetID));
+	}
+}
@@ -0,0 +1,599 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CPM_ZipBuilder.h"
+#include "Async/Async.h"
+#include "Utility/CPM_FileWalker.h"
+#include "Dom/JsonObject.h"
+#include "Dom/JsonValue.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+THIRD_PARTY_INCLUDES_START
+#include "zlib.h"
+#if CPM_WITH_ZSTD
+#include "zstd.h"
+#endif
+THIRD_PARTY_INCLUDES_END
+
+namespace
+{
+	/** Entries this large reserve a zip64 header, deflate can grow incompressible data slightly */
+	constexpr int64 Zip64Threshold = 0xF0000000ll;
+
+	struct FChunkJob
+	{
+		int32 FileIndex = INDEX_NONE;
+		int64 Offset = 0;
+		int64 Size = 0;
+		bool bLast = false;
+	};
+
+	bool DeflateChunk(const TArray<uint8>& Input, const bool bLastChunk, const int32 Level, TArray<uint8>& OutData)
+	{
+		z_stream Stream;
+		FMemory::Memzero(Stream);
+		// Negative window bits produce a raw deflate stream, which is what zip entries contain
+		if (deflateInit2(&Stream, Level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+		{
+			return false;
+		}
+
+		OutData.SetNumUninitialized(deflateBound(&Stream, Input.Num()) + 64);
+		Stream.next_in = const_cast<Bytef*>(Input.GetData());
+		Stream.avail_in = Input.Num();
+		Stream.next_out = OutData.GetData();
+		Stream.avail_out = OutData.Num();
+
+		// A full flush ends on a byte boundary with a fresh dictionary, so independently compressed
+		// chunks concatenate into one valid stream. Only the last chunk carries the final block.
+		const int Result = deflate(&Stream, bLastChunk ? Z_FINISH : Z_FULL_FLUSH);
+		const bool bSuccess = bLastChunk ? Result == Z_STREAM_END : (Result == Z_OK && Stream.avail_in == 0);
+		OutData.SetNum(Stream.total_out, false);
+		deflateEnd(&Stream);
+		return bSuccess;
+	}
+
+#if CPM_WITH_ZSTD
+	bool ZstdChunk(const TArray<uint8>& Input, const int32 Level, TArray<uint8>& OutData)
+	{
+		// Every chunk is its own frame, decoders read concatenated frames as one stream
+		OutData.SetNumUninitialized(ZSTD_compressBound(Input.Num()));
+		const size_t Size = ZSTD_compress(OutData.GetData(), OutData.Num(), Input.GetData(), Input.Num(), Level);
+		if (ZSTD_isError(Size))
+		{
+			return false;
+		}
+		OutData.SetNum(Size, false);
+		return true;
+	}
+#endif
+}
+
+void FCPM_ZipBuilder::AddFile(const FString& ArchivePath, const FString& SourceFilePath)
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	const int64 Size = PlatformFile.FileSize(*SourceFilePath);
+	if (Size < 0)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("File not found: %s"), *SourceFilePath);
+		return;
+	}
+	AddFile(ArchivePath, SourceFilePath, Size, PlatformFile.GetTimeStamp(*SourceFilePath));
+}
+
+void FCPM_ZipBuilder::AddFile(const FString& ArchivePath, const FString& SourceFilePath, const int64 Size, const FDateTime& Timestamp)
+{
+	Files.Add({ ArchivePath, SourceFilePath, Size, Timestamp });
+}
+
+void FCPM_ZipBuilder::AddProjectFiles(const TArray<FString>& InFiles, const TArray<FString>& InDirectories)
+{
+	const FString ProjectDir = FPaths::ConvertRelativePathToFull(FPaths::ProjectDir());
+
+	// One parallel pass lists every file with its size and timestamp, skipping whatever .convaiignore excludes
+	const TArray<FCPM_WalkedFile> WalkedFiles = FCPM_FileWalker::Walk(InDirectories, InFiles, FCPM_IgnoreRules::MakeForProject(), ProjectDir);
+	Files.Reserve(Files.Num() + WalkedFiles.Num());
+
+	for (const FCPM_WalkedFile& File : WalkedFiles)
+	{
+		// Create relative path
+		FString RelativePath = File.Path;
+		FPaths::MakePathRelativeTo(RelativePath, *ProjectDir);
+		
+		// Normalize path separators for zip compatibility and remove any leading slashes
+		RelativePath = FCPM_ZipWriter::NormalizeArchivePath(RelativePath);
+		
+		// Validate the relative path
+		if (RelativePath.IsEmpty() || RelativePath.Contains(TEXT("..")))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Invalid relative path for file: %s -> %s"), *File.Path, *RelativePath);
+			continue;
+		}
+
+		// Validate file data
+		if (File.Size <= 0)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Empty file: %s"), *File.Path);
+			continue;
+		}
+
+		AddFile(RelativePath, File.Path, File.Size, File.Timestamp);
+	}
+}
+
+int64 FCPM_ZipBuilder::GetTotalBytes() const
+{
+	int64 TotalBytes = 0;
+	for (const FFileToZip& File : Files)
+	{
+		TotalBytes += File.Size;
+	}
+	return TotalBytes;
+}
+
+bool FCPM_ZipBuilder::Write(const FString& ZipFilePath)
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	const double StartTime = FPlatformTime::Seconds();
+	const FString ManifestPath = GetManifestPath(ZipFilePath);
+	Stats = FStats();
+
+	// The previous archive is moved aside so unchanged entries can be copied out of it while the new one is written
+	TMap<FString, FManifestEntry> PreviousEntries;
+	const FString PreviousZipPath = ZipFilePath + TEXT(".prev");
+	const FString PreviousManifestPath = ManifestPath + TEXT(".prev");
+	TUniquePtr<IFileHandle> PreviousZip;
+	if (Settings.bIncremental && PlatformFile.FileExists(*ZipFilePath) && LoadManifest(ManifestPath, PreviousEntries))
+	{
+		PlatformFile.DeleteFile(*PreviousZipPath);
+		if (PlatformFile.MoveFile(*PreviousZipPath, *ZipFilePath))
+		{
+			PreviousZip.Reset(PlatformFile.OpenRead(*PreviousZipPath));
+		}
+	}
+	// Without a manifest that describes the new archive a later incremental run could copy stale offsets.
+	// It is kept aside so it can come back together with the previous archive if this build does not complete.
+	PlatformFile.DeleteFile(*PreviousManifestPath);
+	if (PreviousZip.IsValid())
+	{
+		PlatformFile.MoveFile(*PreviousManifestPath, *ManifestPath);
+	}
+	PlatformFile.DeleteFile(*ManifestPath);
+
+	auto RestorePrevious = [&]()
+	{
+		PreviousZip.Reset();
+		PlatformFile.DeleteFile(*ZipFilePath);
+		if (PlatformFile.FileExists(*PreviousZipPath))
+		{
+			// Keep the last good archive rather than a truncated one
+			PlatformFile.MoveFile(*ZipFilePath, *PreviousZipPath);
+			PlatformFile.MoveFile(*ManifestPath, *PreviousManifestPath);
+		}
+	};
+
+	IFileHandle* FileHandle = PlatformFile.OpenWrite(*ZipFilePath);
+	if (!FileHandle)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to create zip file: %s"), *ZipFilePath);
+		RestorePrevious();
+		return false;
+	}
+
+	bool bSuccess = true;
+	TArray<FFileToZip> FilesToCompress;
+	{
+		FCPM_ZipWriter Writer(FileHandle);
+
+		for (const FFileToZip& File : Files)
+		{
+			if (IsCancelled())
+			{
+				bSuccess = false;
+				break;
+			}
+
+			const FManifestEntry* Previous = PreviousZip.IsValid() ? PreviousEntries.Find(FCPM_ZipWriter::NormalizeArchivePath(File.ArchivePath)) : nullptr;
+			const bool bUnchanged = Previous && Previous->Size == File.Size && Previous->Timestamp == File.Timestamp
+				&& Previous->Method == GetMethodForFile(File.SourceFilePath);
+
+			if (bUnchanged && CopyEntry(Writer, *PreviousZip, File, *Previous))
+			{
+				++Stats.NumReused;
+				ReportProgress(File.Size, 1);
+			}
+			else if (Writer.HasError())
+			{
+				bSuccess = false;
+				break;
+			}
+			else
+			{
+				FilesToCompress.Add(File);
+			}
+		}
+
+		bSuccess = bSuccess && WriteFiles(Writer, FilesToCompress);
+		Stats.NumCompressed = FilesToCompress.Num();
+		Stats.WriteSeconds = FPlatformTime::Seconds() - StartTime;
+
+		const double FinalizeStartTime = FPlatformTime::Seconds();
+		bSuccess = Writer.Finalize() && bSuccess;
+		if (bSuccess && Settings.bIncremental)
+		{
+			SaveManifest(ManifestPath, Writer);
+		}
+		Stats.FinalizeSeconds = FPlatformTime::Seconds() - FinalizeStartTime;
+	}
+
+	if (bSuccess)
+	{
+		PreviousZip.Reset();
+		PlatformFile.DeleteFile(*PreviousZipPath);
+		PlatformFile.DeleteFile(*PreviousManifestPath);
+	}
+	else
+	{
+		RestorePrevious();
+	}
+
+	int64 TotalBytes = 0;
+	for (const FFileToZip& File : FilesToCompress)
+	{
+		TotalBytes += File.Size;
+	}
+	const double Elapsed = FPlatformTime::Seconds() - StartTime;
+	if (Stats.bCancelled)
+	{
+		UE_LOG(LogTemp, Log, TEXT("Zipping %s was cancelled after %.2fs"), *ZipFilePath, Elapsed);
+	}
+	else
+	{
+		UE_LOG(LogTemp, Log, TEXT("Zipped %d files into %s in %.2fs, %d reused, %d compressed (%.1f MB, %.1f MB/s)"), Files.Num(), *ZipFilePath, Elapsed,
+			Stats.NumReused, FilesToCompress.Num(), TotalBytes / (1024.0 * 1024.0), Elapsed > 0.0 ? TotalBytes / (1024.0 * 1024.0) / Elapsed : 0.0);
+	}
+	return bSuccess;
+}
+
+bool FCPM_ZipBuilder::WriteToStream(IFileHandle* Sink)
+{
+	const double StartTime = FPlatformTime::Seconds();
+	Stats = FStats();
+
+	bool bSuccess = false;
+	{
+		FCPM_ZipWriter Writer(Sink, 1024 * 1024, false);
+		bSuccess = WriteFiles(Writer, Files);
+		Stats.NumCompressed = Files.Num();
+		Stats.WriteSeconds = FPlatformTime::Seconds() - StartTime;
+
+		const double FinalizeStartTime = FPlatformTime::Seconds();
+		bSuccess = Writer.Finalize() && bSuccess;
+		Stats.FinalizeSeconds = FPlatformTime::Seconds() - FinalizeStartTime;
+	}
+	return bSuccess;
+}
+
+int64 FCPM_ZipBuilder::GetStreamedSize() const
+{
+	TArray<FCPM_ZipWriter::FStreamedEntry> StreamedEntries;
+	StreamedEntries.Reserve(Files.Num());
+	for (const FFileToZip& File : Files)
+	{
+		if (GetMethodForFile(File.SourceFilePath) != FCPM_ZipWriter::ECompressionMethod::Store)
+		{
+			return -1;
+		}
+		StreamedEntries.Add({ File.ArchivePath, static_cast<uint64>(File.Size), File.Size >= Zip64Threshold });
+	}
+	return FCPM_ZipWriter::ComputeStreamedStoredSize(StreamedEntries);
+}
+
+bool FCPM_ZipBuilder::IsCancelled()
+{
+	if (!Stats.bCancelled && Settings.ShouldCancel && Settings.ShouldCancel())
+	{
+		Stats.bCancelled = true;
+	}
+	return Stats.bCancelled;
+}
+
+void FCPM_ZipBuilder::ReportProgress(const int64 Bytes, const int32 NumFilesDone)
+{
+	Stats.BytesProcessed += Bytes;
+	Stats.FilesProcessed += NumFilesDone;
+	if (Settings.OnProgress)
+	{
+		Settings.OnProgress(Stats.BytesProcessed, Stats.FilesProcessed);
+	}
+}
+
+FString FCPM_ZipBuilder::GetManifestPath(const FString& ZipFilePath)
+{
+	return ZipFilePath + TEXT(".manifest.json");
+}
+
+FCPM_ZipWriter::ECompressionMethod FCPM_ZipBuilder::GetMethodForFile(const FString& SourceFilePath) const
+{
+	if (Settings.StoredExtensions.Contains(FPaths::GetExtension(SourceFilePath).ToLower()))
+	{
+		return FCPM_ZipWriter::ECompressionMethod::Store;
+	}
+
+#if !CPM_WITH_ZSTD
+	if (Settings.Method == FCPM_ZipWriter::ECompressionMethod::Zstd)
+	{
+		return FCPM_ZipWriter::ECompressionMethod::Deflate;
+	}
+#endif
+	return Settings.Method;
+}
+
+FCPM_ZipBuilder::FChunkResult FCPM_ZipBuilder::CompressChunk(const FString& SourceFilePath, const int64 Offset, const int64 Size,
+	const bool bLastChunk, const FCPM_ZipWriter::ECompressionMethod Method, const int32 Level)
+{
+	FChunkResult Result;
+	Result.UncompressedSize = Size;
+
+	TArray<uint8> Input;
+	Input.SetNumUninitialized(Size);
+	if (Size > 0)
+	{
+		const TUniquePtr<IFileHandle> Source(FPlatformFileManager::Get().GetPlatformFile().OpenRead(*SourceFilePath));
+		if (!Source.IsValid() || !Source->Seek(Offset) || !Source->Read(Input.GetData(), Size))
+		{
+			UE_LOG(LogTemp, Error, TEXT("Failed to read file: %s"), *SourceFilePath);
+			return Result;
+		}
+	}
+	Result.Crc = crc32(0, Input.GetData(), Input.Num());
+
+	switch (Method)
+	{
+	case FCPM_ZipWriter::ECompressionMethod::Deflate:
+		Result.bSuccess = DeflateChunk(Input, bLastChunk, Level, Result.Data);
+		break;
+#if CPM_WITH_ZSTD
+	case FCPM_ZipWriter::ECompressionMethod::Zstd:
+		Result.bSuccess = ZstdChunk(Input, Level, Result.Data);
+		break;
+#endif
+	default:
+		Result.Data = MoveTemp(Input);
+		Result.bSuccess = true;
+		break;
+	}
+	return Result;
+}
+
+bool FCPM_ZipBuilder::WriteFiles(FCPM_ZipWriter& Writer, const TArray<FFileToZip>& FilesToWrite)
+{
+	const int32 ChunkSize = FMath::Max(Settings.ChunkSize, 64 * 1024);
+	const int32 MaxInFlight = Settings.MaxChunksInFlight > 0 ? Settings.MaxChunksInFlight : FPlatformMisc::NumberOfCoresIncludingHyperthreads() * 2;
+
+	TArray<FCPM_ZipWriter::ECompressionMethod> Methods;
+	Methods.Reserve(FilesToWrite.Num());
+	for (const FFileToZip& File : FilesToWrite)
+	{
+		Methods.Add(GetMethodForFile(File.SourceFilePath));
+	}
+
+	// Next chunk to hand out
+	int32 NextFile = 0;
+	int64 NextOffset = 0;
+	auto TakeNextJob = [&](FChunkJob& OutJob) -> bool
+	{
+		if (NextFile >= FilesToWrite.Num())
+		{
+			return false;
+		}
+
+		const FFileToZip& File = FilesToWrite[NextFile];
+		OutJob.FileIndex = NextFile;
+		OutJob.Offset = NextOffset;
+		OutJob.Size = FMath::Min<int64>(ChunkSize, File.Size - NextOffset);
+		OutJob.bLast = NextOffset + OutJob.Size >= File.Size;
+
+		NextOffset += OutJob.Size;
+		if (OutJob.bLast)
+		{
+			++NextFile;
+			NextOffset = 0;
+		}
+		return true;
+	};
+
+	TArray<FChunkJob> InFlightJobs;
+	TArray<TFuture<FChunkResult>> InFlight;
+	uint32 EntryCrc = 0;
+	bool bSuccess = true;
+
+	while (bSuccess)
+	{
+		if (IsCancelled())
+		{
+			bSuccess = false;
+			break;
+		}
+
+		FChunkJob Job;
+		while (InFlight.Num() < MaxInFlight && TakeNextJob(Job))
+		{
+			const FString SourceFilePath = FilesToWrite[Job.FileIndex].SourceFilePath;
+			const FCPM_ZipWriter::ECompressionMethod Method = Methods[Job.FileIndex];
+			const int32 Level = Settings.Level;
+			auto Compress = [SourceFilePath, Job, Method, Level]()
+			{
+				return CompressChunk(SourceFilePath, Job.Offset, Job.Size, Job.bLast, Method, Level);
+			};
+			InFlight.Add(Settings.ThreadPool ? AsyncPool(*Settings.ThreadPool, MoveTemp(Compress)) : Async(EAsyncExecution::ThreadPool, MoveTemp(Compress)));
+			InFlightJobs.Add(Job);
+		}
+
+		if (InFlight.Num() == 0)
+		{
+			break;
+		}
+
+		// Results are consumed strictly in submission order, which keeps the archive layout deterministic
+		FChunkResult Result = InFlight[0].Consume();
+		Job = InFlightJobs[0];
+		InFlight.RemoveAt(0, 1, false);
+		InFlightJobs.RemoveAt(0, 1, false);
+
+		const FFileToZip& File = FilesToWrite[Job.FileIndex];
+		if (!Result.bSuccess)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Failed to compress %s"), *File.SourceFilePath);
+			bSuccess = false;
+			break;
+		}
+
+		if (Job.Offset == 0)
+		{
+			bSuccess = Writer.BeginEntry(File.ArchivePath, Methods[Job.FileIndex], File.Timestamp, File.Size >= Zip64Threshold);
+			EntryCrc = Result.Crc;
+		}
+		else
+		{
+			EntryCrc = crc32_combine(EntryCrc, Result.Crc, Result.UncompressedSize);
+		}
+
+		bSuccess = bSuccess && Writer.WriteEntryData(Result.Data.GetData(), Result.Data.Num());
+		if (bSuccess && Job.bLast)
+		{
+			bSuccess = Writer.EndEntry(EntryCrc, File.Size);
+		}
+		if (bSuccess)
+		{
+			ReportProgress(Result.UncompressedSize, Job.bLast ? 1 : 0);
+		}
+	}
+
+	// Let chunks that are still compressing finish before their results are dropped
+	for (TFuture<FChunkResult>& Future : InFlight)
+	{
+		Future.Wait();
+	}
+	return bSuccess;
+}
+
+bool FCPM_ZipBuilder::CopyEntry(FCPM_ZipWriter& Writer, IFileHandle& PreviousZip, const FFileToZip& File, const FManifestEntry& Previous)
+{
+	if (Previous.DataOffset + Previous.CompressedSize > static_cast<uint64>(PreviousZip.Size()) || !PreviousZip.Seek(Previous.DataOffset))
+	{
+		return false;
+	}
+
+	if (!Writer.BeginEntry(File.ArchivePath, Previous.Method, File.Timestamp, File.Size >= Zip64Threshold || Previous.CompressedSize >= Zip64Threshold))
+	{
+		return false;
+	}
+
+	TArray<uint8> Buffer;
+	Buffer.SetNumUninitialized(FMath::Max(Settings.ChunkSize, 64 * 1024));
+	for (uint64 Remaining = Previous.CompressedSize; Remaining > 0;)
+	{
+		const int64 ChunkSize = FMath::Min<uint64>(Remaining, Buffer.Num());
+		if (!PreviousZip.Read(Buffer.GetData(), ChunkSize) || !Writer.WriteEntryData(Buffer.GetData(), ChunkSize))
+		{
+			// The entry is already half written, the archive cannot be completed
+			UE_LOG(LogTemp, Error, TEXT("Failed to copy %s from the previous archive"), *File.ArchivePath);
+			Writer.Finalize();
+			return false;
+		}
+		Remaining -= ChunkSize;
+	}
+
+	return Writer.EndEntry(Previous.Crc, File.Size);
+}
+
+bool FCPM_ZipBuilder::LoadManifest(const FString& ManifestPath, TMap<FString, FManifestEntry>& OutEntries)
+{
+	FString Content;
+	if (!FFileHelper::LoadFileToString(Content, *ManifestPath))
+	{
+		return false;
+	}
+
+	TSharedPtr<FJsonObject> Root;
+	const TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(Content);
+	const TArray<TSharedPtr<FJsonValue>>* Entries = nullptr;
+	if (!FJsonSerializer::Deserialize(Reader, Root) || !Root.IsValid() || !Root->TryGetArrayField(TEXT("entries"), Entries))
+	{
+		return false;
+	}
+
+	for (const TSharedPtr<FJsonValue>& Value : *Entries)
+	{
+		const TSharedPtr<FJsonObject>* Object = nullptr;
+		if (!Value->TryGetObject(Object))
+		{
+			continue;
+		}
+
+		FString Path, Timestamp;
+		int64 Size = 0, CompressedSize = 0, DataOffset = 0;
+		uint32 Crc = 0, Method = 0;
+		if ((*Object)->TryGetStringField(TEXT("path"), Path)
+			&& (*Object)->TryGetStringField(TEXT("mtime"), Timestamp)
+			&& (*Object)->TryGetNumberField(TEXT("size"), Size)
+			&& (*Object)->TryGetNumberField(TEXT("compressed_size"), CompressedSize)
+			&& (*Object)->TryGetNumberField(TEXT("data_offset"), DataOffset)
+			&& (*Object)->TryGetNumberField(TEXT("crc"), Crc)
+			&& (*Object)->TryGetNumberField(TEXT("method"), Method))
+		{
+			FManifestEntry& Entry = OutEntries.Add(Path);
+			Entry.Size = Size;
+			Entry.Timestamp = FDateTime(FCString::Atoi64(*Timestamp));
+			Entry.Method = static_cast<FCPM_ZipWriter::ECompressionMethod>(Method);
+			Entry.Crc = Crc;
+			Entry.CompressedSize = CompressedSize;
+			Entry.DataOffset = DataOffset;
+		}
+	}
+	return true;
+}
+
+bool FCPM_ZipBuilder::SaveManifest(const FString& ManifestPath, const FCPM_ZipWriter& Writer) const
+{
+	TMap<FString, const FFileToZip*> FilesByPath;
+	for (const FFileToZip& File : Files)
+	{
+		FilesByPath.Add(FCPM_ZipWriter::NormalizeArchivePath(File.ArchivePath), &File);
+	}
+
+	TArray<TSharedPtr<FJsonValue>> Entries;
+	for (const FCPM_ZipWriter::FEntry& Entry : Writer.GetEntries())
+	{
+		const FFileToZip* const* File = FilesByPath.Find(Entry.Path);
+		if (!File)
+		{
+			continue;
+		}
+
+		const TSharedPtr<FJsonObject> Object = MakeShared<FJsonObject>();
+		Object->SetStringField(TEXT("path"), Entry.Path);
+		Object->SetNumberField(TEXT("size"), (*File)->Size);
+		// Ticks do not fit in a double, keep them as a string
+		Object->SetStringField(TEXT("mtime"), LexToString((*File)->Timestamp.GetTicks()));
+		Object->SetNumberField(TEXT("crc"), Entry.Crc);
+		Object->SetNumberField(TEXT("method"), static_cast<uint16>(Entry.Method));
+		Object->SetNumberField(TEXT("compressed_size"), Entry.CompressedSize);
+		Object->SetNumberField(TEXT("data_offset"), Entry.DataOffset);
+		Entries.Add(MakeShared<FJsonValueObject>(Object));
+	}
+
+	const TSharedPtr<FJsonObject> Root = MakeShared<FJsonObject>();
+	Root->SetNumberField(TEXT("version"), 1);
+	Root->SetArrayField(TEXT("entries"), Entries);
+
+	FString Output;
+	const TSharedRef<TJsonWriter<>> JsonWriter = TJsonWriterFactory<>::Create(&Output);
+	return FJsonSerializer::Serialize(Root.ToSharedRef(), JsonWriter) && FFileHelper::SaveStringToFile(Output, *ManifestPath);
+}
@@ -0,0 +1,663 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CPM_ZipJob.h"
+#include "CPM_ZipBuilder.h"
+#include "Utility/CPM_UtilityLibrary.h"
+#include "Async/Async.h"
+#include "CoreGlobals.h"
+#include "HAL/PlatformFileManager.h"
+#include "HttpModule.h"
+#include "Interfaces/IHttpRequest.h"
+#include "Interfaces/IHttpResponse.h"
+#include "Misc/Paths.h"
+#include "Misc/QueuedThreadPool.h"
+#include "Misc/ScopeLock.h"
+
+namespace
+{
+	/** Zip jobs that may run at once, each one already keeps every core busy compressing */
+	constexpr int32 MaxConcurrentZipJobs = 2;
+
+	FCriticalSection ZipPoolMutex;
+	FQueuedThreadPool* ZipPool = nullptr;
+
+	/** Jobs started and not completed yet, cancelled on shutdown so the pool is not left waiting on them */
+	TArray<TWeakPtr<FCPM_ZipJob>> LiveJobs;
+
+	/** Write side of the upload ring buffer, the zip writer sees it as a file that cannot seek */
+	class FRingBufferFileHandle : public IFileHandle
+	{
+	public:
+		explicit FRingBufferFileHandle(const TSharedRef<FCPM_RingBuffer, ESPMode::ThreadSafe>& InRingBuffer)
+			: RingBuffer(InRingBuffer)
+		{
+		}
+
+		virtual int64 Tell() override { return Position; }
+		virtual bool Seek(const int64 NewPosition) override { return NewPosition == Position; }
+		virtual bool SeekFromEnd(const int64 NewPositionRelativeToEnd) override { return NewPositionRelativeToEnd == 0; }
+		virtual bool Read(uint8* Destination, int64 BytesToRead) override { return false; }
+		virtual bool Flush(const bool bFullFlush = false) override { return !RingBuffer->IsAborted(); }
+		virtual bool Truncate(int64 NewSize) override { return false; }
+		virtual int64 Size() override { return Position; }
+
+		virtual bool Write(const uint8* Source, const int64 BytesToWrite) override
+		{
+			if (!RingBuffer->Write(Source, BytesToWrite))
+			{
+				return false;
+			}
+			Position += BytesToWrite;
+			return true;
+		}
+
+	private:
+		TSharedRef<FCPM_RingBuffer, ESPMode::ThreadSafe> RingBuffer;
+		int64 Position = 0;
+	};
+
+	/** Outcome of the upload request, shared with its completion callback */
+	struct FUploadState
+	{
+		FUploadState() : DoneEvent(FPlatformProcess::GetSynchEventFromPool(true)) {}
+		~FUploadState() { FPlatformProcess::ReturnSynchEventToPool(DoneEvent); }
+
+		FEvent* DoneEvent;
+		std::atomic<bool> bSucceeded { false };
+		std::atomic<int32> ResponseCode { 0 };
+
+		/** Resumable upload headers, only read once DoneEvent triggered */
+		FString Location;
+		FString Range;
+	};
+
+	/**
+	 * Completes Request on the http thread into UploadState. A streamed request that ends early aborts
+	 * RingBuffer, so the zip writer is never left blocked on a full buffer.
+	 */
+	void BindUploadState(const TSharedRef<IHttpRequest, ESPMode::ThreadSafe>& Request, const TSharedRef<FUploadState, ESPMode::ThreadSafe>& UploadState,
+		const TSharedPtr<FCPM_RingBuffer, ESPMode::ThreadSafe>& RingBuffer = nullptr)
+	{
+		Request->SetDelegateThreadPolicy(EHttpRequestDelegateThreadPolicy::CompleteOnHttpThread);
+		Request->OnProcessRequestComplete().BindLambda([UploadState, RingBuffer](FHttpRequestPtr, const FHttpResponsePtr Response, const bool bConnectedSuccessfully)
+		{
+			if (Response.IsValid())
+			{
+				UploadState->ResponseCode = Response->GetResponseCode();
+				UploadState->Location = Response->GetHeader(TEXT("Location"));
+				UploadState->Range = Response->GetHeader(TEXT("Range"));
+			}
+			UploadState->bSucceeded = bConnectedSuccessfully && EHttpResponseCodes::IsOk(UploadState->ResponseCode);
+			if (RingBuffer.IsValid())
+			{
+				RingBuffer->Abort();
+			}
+			UploadState->DoneEvent->Trigger();
+		});
+	}
+
+	/**
+	 * Waits for the upload to finish, or only until the job is cancelled. The request completes on the
+	 * http thread and its callback holds nothing but shared state, so a late completion is harmless.
+	 */
+	void WaitForUpload(const TSharedRef<IHttpRequest, ESPMode::ThreadSafe>& Request, const FUploadState& UploadState, const std::atomic<bool>& bCancelRequested)
+	{
+		while (!UploadState.DoneEvent->Wait(FTimespan::FromMilliseconds(100)))
+		{
+			if (bCancelRequested)
+			{
+				Request->CancelRequest();
+				return;
+			}
+		}
+	}
+}
+
+FCPM_ZipJob::FCPM_ZipJob(const FParams& InParams, FOnProgress InOnProgress, FOnCompleted InOnCompleted)
+	: Params(InParams)
+	, OnProgress(MoveTemp(InOnProgress))
+	, OnCompleted(MoveTemp(InOnCompleted))
+{
+}
+
+TSharedRef<FCPM_ZipJob> FCPM_ZipJob::Start(const FParams& InParams, FOnProgress InOnProgress, FOnCompleted InOnCompleted)
+{
+	TSharedRef<FCPM_ZipJob> Job = MakeShareable(new FCPM_ZipJob(InParams, MoveTemp(InOnProgress), MoveTemp(InOnCompleted)));
+	Job->StartTime = FPlatformTime::Seconds();
+	{
+		FScopeLock Lock(&ZipPoolMutex);
+		LiveJobs.Add(Job);
+	}
+
+	FQueuedThreadPool* Pool = GetPool();
+	if (Pool)
+	{
+		AsyncPool(*Pool, [Job]() { Job->Run(); });
+	}
+	else
+	{
+		Async(EAsyncExecution::Thread, [Job]() { Job->Run(); });
+	}
+	return Job;
+}
+
+FQueuedThreadPool* FCPM_ZipJob::GetPool()
+{
+	FScopeLock Lock(&ZipPoolMutex);
+	if (!ZipPool && FPlatformProcess::SupportsMultithreading())
+	{
+		ZipPool = FQueuedThreadPool::Allocate();
+		if (!ZipPool->Create(MaxConcurrentZipJobs, 128 * 1024, TPri_Lowest, TEXT("CPM_ZipPool")))
+		{
+			delete ZipPool;
+			ZipPool = nullptr;
+		}
+	}
+	return ZipPool;
+}
+
+void FCPM_ZipJob::Cancel()
+{
+	bCancelRequested = true;
+
+	// The zip writer may be blocked on a full upload buffer that the cancelled request no longer drains
+	FScopeLock Lock(&UploadBufferMutex);
+	if (UploadBuffer.IsValid())
+	{
+		UploadBuffer->Abort();
+	}
+}
+
+void FCPM_ZipJob::ShutdownPool()
+{
+	FQueuedThreadPool* Pool = nullptr;
+	TArray<TSharedPtr<FCPM_ZipJob>> Jobs;
+	{
+		FScopeLock Lock(&ZipPoolMutex);
+		Swap(Pool, ZipPool);
+		for (const TWeakPtr<FCPM_ZipJob>& LiveJob : LiveJobs)
+		{
+			if (TSharedPtr<FCPM_ZipJob> Job = LiveJob.Pin())
+			{
+				Jobs.Add(MoveTemp(Job));
+			}
+		}
+		LiveJobs.Empty();
+	}
+
+	// Running jobs finish on the pool threads, which also take ZipPoolMutex, so the pool is destroyed outside of it
+	for (const TSharedPtr<FCPM_ZipJob>& Job : Jobs)
+	{
+		Job->Cancel();
+	}
+	if (Pool)
+	{
+		Pool->Destroy();
+		delete Pool;
+	}
+}
+
+void FCPM_ZipJob::Run()
+{
+	FCPM_ZipJobResult Result;
+	Result.ZipFilePath = Params.ZipFilePath;
+	Result.QueuedSeconds = FPlatformTime::Seconds() - StartTime;
+
+	if (bCancelRequested)
+	{
+		Result.bCancelled = true;
+		Complete(Result);
+		return;
+	}
+
+	FCPM_ZipProgress Progress;
+
+	const bool bStreamUpload = !Params.UploadURL.IsEmpty() && (Params.bStreamStored || Params.bResumableUpload);
+
+	FCPM_ZipBuilder::FSettings ZipSettings;
+	ZipSettings.bIncremental = Params.bIncremental && !bStreamUpload;
+	if (bStreamUpload && Params.bStreamStored)
+	{
+		ZipSettings.Method = FCPM_ZipWriter::ECompressionMethod::Store;
+	}
+	// Compressing on the background pool keeps the normal priority workers free for the editor
+	ZipSettings.ThreadPool = GBackgroundPriorityThreadPool;
+	ZipSettings.ShouldCancel = [this]() { return bCancelRequested.load(); };
+	ZipSettings.OnProgress = [this, &Progress](const int64 BytesProcessed, const int32 FilesProcessed)
+	{
+		Progress.BytesProcessed = BytesProcessed;
+		Progress.FilesProcessed = FilesProcessed;
+		if (FPlatformTime::Seconds() - LastProgressTime >= Params.ProgressInterval)
+		{
+			PostProgress(Progress);
+		}
+	};
+	FCPM_ZipBuilder ZipBuilder(ZipSettings);
+
+	const double WalkStartTime = FPlatformTime::Seconds();
+	ZipBuilder.AddProjectFiles(Params.Files, Params.Directories);
+	Result.WalkSeconds = FPlatformTime::Seconds() - WalkStartTime;
+	Result.NumFiles = ZipBuilder.GetNumFiles();
+	Result.TotalBytes = ZipBuilder.GetTotalBytes();
+
+	Progress.TotalFiles = Result.NumFiles;
+	Progress.TotalBytes = Result.TotalBytes;
+	PostProgress(Progress);
+
+	bool bSuccess = false;
+	if (bStreamUpload)
+	{
+		bSuccess = Params.bResumableUpload ? RunResumableUpload(ZipBuilder, Result) : RunUpload(ZipBuilder, Result);
+	}
+	else
+	{
+		// A single deflated PUT goes through a file, the request needs the compressed size before it starts
+		const bool bTemporaryZip = !Params.UploadURL.IsEmpty() && Params.ZipFilePath.IsEmpty();
+		const FString ZipFilePath = bTemporaryZip
+			? FPaths::CreateTempFilename(*FPaths::Combine(UCPM_UtilityLibrary::CPM_GetCacheDirectory(), TEXT("Uploads")), TEXT("Upload"), TEXT(".zip"))
+			: Params.ZipFilePath;
+		if (bTemporaryZip)
+		{
+			FPlatformFileManager::Get().GetPlatformFile().CreateDirectoryTree(*FPaths::GetPath(ZipFilePath));
+		}
+
+		bSuccess = ZipBuilder.Write(ZipFilePath);
+		if (bSuccess)
+		{
+			Result.ZipFileSize = FPlatformFileManager::Get().GetPlatformFile().FileSize(*ZipFilePath);
+		}
+		if (bSuccess && !Params.UploadURL.IsEmpty())
+		{
+			bSuccess = UploadFile(ZipFilePath, Result);
+		}
+		if (bTemporaryZip)
+		{
+			FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*ZipFilePath);
+		}
+	}
+
+	const FCPM_ZipBuilder::FStats& Stats = ZipBuilder.GetStats();
+	Result.bSuccess = bSuccess;
+	Result.bCancelled = Stats.bCancelled || (!bSuccess && bCancelRequested);
+	Result.NumReused = Stats.NumReused;
+	Result.WriteSeconds = Stats.WriteSeconds;
+	Result.FinalizeSeconds = Stats.FinalizeSeconds;
+
+	Progress.FilesProcessed = Stats.FilesProcessed;
+	Progress.BytesProcessed = Stats.BytesProcessed;
+	PostProgress(Progress);
+	Complete(Result);
+}
+
+bool FCPM_ZipJob::RunUpload(FCPM_ZipBuilder& ZipBuilder, FCPM_ZipJobResult& Result)
+{
+	const int64 ArchiveSize = ZipBuilder.GetStreamedSize();
+	if (ArchiveSize < 0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Zip upload needs stored entries to know the archive size in advance"));
+		return false;
+	}
+	Result.ZipFileSize = ArchiveSize;
+
+	TSharedRef<FCPM_RingBuffer, ESPMode::ThreadSafe> RingBuffer = MakeShared<FCPM_RingBuffer, ESPMode::ThreadSafe>(Params.UploadBufferSize);
+	{
+		FScopeLock Lock(&UploadBufferMutex);
+		UploadBuffer = RingBuffer;
+	}
+	if (bCancelRequested)
+	{
+		RingBuffer->Abort();
+	}
+
+	TSharedRef<FUploadState, ESPMode::ThreadSafe> UploadState = MakeShared<FUploadState, ESPMode::ThreadSafe>();
+	const TSharedRef<IHttpRequest, ESPMode::ThreadSafe> Request = FHttpModule::Get().CreateRequest();
+	Request->SetURL(Params.UploadURL);
+	Request->SetVerb(TEXT("PUT"));
+	Request->SetHeader(TEXT("Content-Type"), TEXT("application/zip"));
+	Request->SetHeader(TEXT("x-goog-content-length-range"), TEXT("0,10485760000"));
+	Request->SetContentFromStream(MakeShared<FCPM_RingBufferReader, ESPMode::ThreadSafe>(RingBuffer, ArchiveSize));
+	BindUploadState(Request, UploadState, RingBuffer);
+
+	const double UploadStartTime = FPlatformTime::Seconds();
+	if (!Request->ProcessRequest())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to start the zip upload to %s"), *Params.UploadURL);
+		FScopeLock Lock(&UploadBufferMutex);
+		UploadBuffer.Reset();
+		return false;
+	}
+
+	// Compression runs here while the http thread drains the buffer
+	bool bZipped = ZipBuilder.WriteToStream(new FRingBufferFileHandle(RingBuffer));
+	if (bZipped)
+	{
+		RingBuffer->Close();
+	}
+	else
+	{
+		RingBuffer->Abort();
+		Request->CancelRequest();
+	}
+
+	WaitForUpload(Request, *UploadState, bCancelRequested);
+
+	Result.UploadSeconds = FPlatformTime::Seconds() - UploadStartTime;
+	Result.ResponseCode = UploadState->ResponseCode;
+	{
+		FScopeLock Lock(&UploadBufferMutex);
+		UploadBuffer.Reset();
+	}
+
+	if (bZipped && !UploadState->bSucceeded)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Zip upload failed with response code %d"), Result.ResponseCode);
+	}
+	return bZipped && UploadState->bSucceeded;
+}
+
+bool FCPM_ZipJob::RunResumableUpload(FCPM_ZipBuilder& ZipBuilder, FCPM_ZipJobResult& Result)
+{
+	const double UploadStartTime = FPlatformTime::Seconds();
+
+	FString SessionURL;
+	if (!StartUploadSession(SessionURL, Result))
+	{
+		return false;
+	}
+
+	TSharedRef<FCPM_RingBuffer, ESPMode::ThreadSafe> RingBuffer = MakeShared<FCPM_RingBuffer, ESPMode::ThreadSafe>(Params.UploadBufferSize);
+	{
+		FScopeLock Lock(&UploadBufferMutex);
+		UploadBuffer = RingBuffer;
+	}
+	if (bCancelRequested)
+	{
+		RingBuffer->Abort();
+	}
+
+	// Chunks are sent from their own thread while this one compresses, the buffer keeps the two at most its size apart
+	int64 UploadedSize = 0;
+	int32 ResponseCode = 0;
+	TFuture<bool> ChunksUploaded = Async(EAsyncExecution::Thread, [this, RingBuffer, &SessionURL, &UploadedSize, &ResponseCode]()
+	{
+		return UploadChunks(SessionURL, RingBuffer, UploadedSize, ResponseCode);
+	});
+
+	const bool bZipped = ZipBuilder.WriteToStream(new FRingBufferFileHandle(RingBuffer));
+	if (bZipped)
+	{
+		RingBuffer->Close();
+	}
+	else
+	{
+		RingBuffer->Abort();
+	}
+	const bool bUploaded = ChunksUploaded.Get();
+
+	Result.UploadSeconds = FPlatformTime::Seconds() - UploadStartTime;
+	Result.ResponseCode = ResponseCode;
+	Result.ZipFileSize = UploadedSize;
+	{
+		FScopeLock Lock(&UploadBufferMutex);
+		UploadBuffer.Reset();
+	}
+	return bZipped && bUploaded;
+}
+
+bool FCPM_ZipJob::StartUploadSession(FString& OutSessionURL, FCPM_ZipJobResult& Result)
+{
+	TSharedRef<FUploadState, ESPMode::ThreadSafe> UploadState = MakeShared<FUploadState, ESPMode::ThreadSafe>();
+	const TSharedRef<IHttpRequest, ESPMode::ThreadSafe> Request = FHttpModule::Get().CreateRequest();
+	Request->SetURL(Params.UploadURL);
+	Request->SetVerb(TEXT("POST"));
+	Request->SetHeader(TEXT("Content-Type"), TEXT("application/zip"));
+	Request->SetHeader(TEXT("x-goog-content-length-range"), TEXT("0,10485760000"));
+	Request->SetHeader(TEXT("x-goog-resumable"), TEXT("start"));
+	BindUploadState(Request, UploadState);
+
+	if (!Request->ProcessRequest())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to start the upload session at %s"), *Params.UploadURL);
+		return false;
+	}
+	WaitForUpload(Request, *UploadState, bCancelRequested);
+
+	Result.ResponseCode = UploadState->ResponseCode;
+	if (!UploadState->bSucceeded || UploadState->Location.IsEmpty())
+	{
+		if (!bCancelRequested)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Starting the upload session failed with response code %d"), Result.ResponseCode);
+		}
+		return false;
+	}
+	OutSessionURL = UploadState->Location;
+	return true;
+}
+
+bool FCPM_ZipJob::UploadChunks(const FString& SessionURL, const TSharedRef<FCPM_RingBuffer, ESPMode::ThreadSafe>& RingBuffer, int64& OutUploadedSize, int32& OutResponseCode)
+{
+	// Every chunk but the last one has to be a multiple of 256 KiB
+	constexpr int64 ChunkGranularity = 256 * 1024;
+	const int64 ChunkSize = FMath::Max(Align(Params.UploadChunkSize, ChunkGranularity), ChunkGranularity);
+
+	TArray<uint8> Chunk;
+	Chunk.SetNumUninitialized(ChunkSize);
+	int64 Offset = 0;
+	int64 NumBuffered = 0;
+	bool bEndOfArchive = false;
+
+	while (true)
+	{
+		while (!bEndOfArchive && NumBuffered < ChunkSize)
+		{
+			const int64 Read = RingBuffer->Read(Chunk.GetData() + NumBuffered, ChunkSize - NumBuffered);
+			if (Read > 0)
+			{
+				NumBuffered += Read;
+			}
+			else
+			{
+				bEndOfArchive = true;
+			}
+		}
+		if (RingBuffer->IsAborted())
+		{
+			return false;
+		}
+
+		// The total is only known with the last chunk, the ones before leave it open
+		const FString TotalSize = bEndOfArchive ? LexToString(Offset + NumBuffered) : FString(TEXT("*"));
+		TSharedRef<FUploadState, ESPMode::ThreadSafe> UploadState = MakeShared<FUploadState, ESPMode::ThreadSafe>();
+		const TSharedRef<IHttpRequest, ESPMode::ThreadSafe> Request = FHttpModule::Get().CreateRequest();
+		Request->SetURL(SessionURL);
+		Request->SetVerb(TEXT("PUT"));
+		Request->SetHeader(TEXT("Content-Range"), NumBuffered > 0
+			? FString::Printf(TEXT("bytes %lld-%lld/%s"), Offset, Offset + NumBuffered - 1, *TotalSize)
+			: FString::Printf(TEXT("bytes */%s"), *TotalSize));
+		Request->SetContent(TArray<uint8>(Chunk.GetData(), static_cast<int32>(NumBuffered)));
+		BindUploadState(Request, UploadState);
+
+		if (!Request->ProcessRequest())
+		{
+			UE_LOG(LogTemp, Error, TEXT("Failed to send an upload chunk to %s"), *SessionURL);
+			RingBuffer->Abort();
+			return false;
+		}
+		WaitForUpload(Request, *UploadState, bCancelRequested);
+
+		OutResponseCode = UploadState->ResponseCode;
+		if (bEndOfArchive && UploadState->bSucceeded)
+		{
+			OutUploadedSize = Offset + NumBuffered;
+			return true;
+		}
+
+		// 308 asks for the next chunk, its Range header holds what the session persisted, which may be less than was sent
+		int64 Persisted = 0;
+		FString LastPersisted;
+		if (UploadState->Range.Split(TEXT("-"), nullptr, &LastPersisted))
+		{
+			Persisted = FCString::Atoi64(*LastPersisted) + 1;
+		}
+		const int64 Accepted = Persisted - Offset;
+		if (UploadState->ResponseCode != 308 || Accepted <= 0 || Accepted > NumBuffered)
+		{
+			if (!bCancelRequested)
+			{
+				UE_LOG(LogTemp, Error, TEXT("Zip upload chunk at %lld failed with response code %d"), Offset, OutResponseCode);
+			}
+			RingBuffer->Abort();
+			return false;
+		}
+
+		FMemory::Memmove(Chunk.GetData(), Chunk.GetData() + Accepted, NumBuffered - Accepted);
+		NumBuffered -= Accepted;
+		Offset = Persisted;
+	}
+}
+
+bool FCPM_ZipJob::UploadFile(const FString& ZipFilePath, FCPM_ZipJobResult& Result)
+{
+	TSharedRef<FUploadState, ESPMode::ThreadSafe> UploadState = MakeShared<FUploadState, ESPMode::ThreadSafe>();
+	const TSharedRef<IHttpRequest, ESPMode::ThreadSafe> Request = FHttpModule::Get().CreateRequest();
+	Request->SetURL(Params.UploadURL);
+	Request->SetVerb(TEXT("PUT"));
+	Request->SetHeader(TEXT("Content-Type"), TEXT("application/zip"));
+	Request->SetHeader(TEXT("x-goog-content-length-range"), TEXT("0,10485760000"));
+	if (!Request->SetContentAsStreamedFile(ZipFilePath))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to open %s for the zip upload"), *ZipFilePath);
+		return false;
+	}
+	BindUploadState(Request, UploadState);
+
+	const double UploadStartTime = FPlatformTime::Seconds();
+	if (!Request->ProcessRequest())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to start the zip upload to %s"), *Params.UploadURL);
+		return false;
+	}
+
+	WaitForUpload(Request, *UploadState, bCancelRequested);
+
+	Result.UploadSeconds = FPlatformTime::Seconds() - UploadStartTime;
+	Result.ResponseCode = UploadState->ResponseCode;
+	if (!UploadState->bSucceeded)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Zip upload failed with response code %d"), Result.ResponseCode);
+	}
+	return UploadState->bSucceeded;
+}
+
+void FCPM_ZipJob::PostProgress(const FCPM_ZipProgress& InProgress)
+{
+	LastProgressTime = FPlatformTime::Seconds();
+	if (!OnProgress.IsBound())
+	{
+		return;
+	}
+
+	FCPM_ZipProgress Progress = InProgress;
+	{
+		FScopeLock Lock(&UploadBufferMutex);
+		if (UploadBuffer.IsValid())
+		{
+			Progress.BytesUploaded = UploadBuffer->GetTotalRead();
+		}
+	}
+	Progress.Progress = Progress.TotalBytes > 0 ? static_cast<float>(static_cast<double>(Progress.BytesProcessed) / Progress.TotalBytes) : 0.f;
+
+	TSharedRef<FCPM_ZipJob> Job = AsShared();
+	AsyncTask(ENamedThreads::GameThread, [Job, Progress]()
+	{
+		Job->OnProgress.ExecuteIfBound(Progress);
+	});
+}
+
+void FCPM_ZipJob::Complete(const FCPM_ZipJobResult& InResult)
+{
+	FCPM_ZipJobResult Result = InResult;
+	Result.TotalSeconds = FPlatformTime::Seconds() - StartTime;
+	Result.Result = Result.bSuccess ? TEXT("Success") : Result.bCancelled ? TEXT("Cancelled") : TEXT("Failed");
+	{
+		FScopeLock Lock(&ZipPoolMutex);
+		LiveJobs.RemoveAllSwap([this](const TWeakPtr<FCPM_ZipJob>& LiveJob) { return !LiveJob.IsValid() || LiveJob.HasSameObject(this); });
+	}
+
+	TSharedRef<FCPM_ZipJob> Job = AsShared();
+	AsyncTask(ENamedThreads::GameThread, [Job, Result]()
+	{
+		Job->OnCompleted.ExecuteIfBound(Result);
+	});
+}
+
+UCPM_CreateZipProxy* UCPM_CreateZipProxy::CreateZipProxy(const FString& ZipFilePath, const TArray<FString>& Files, const TArray<FString>& Directories, const bool bIncremental, UCPM_CreateZipProxy*& OutProxy)
+{
+	UCPM_CreateZipProxy* Proxy = NewObject<UCPM_CreateZipProxy>();
+	Proxy->M_Params.ZipFilePath = ZipFilePath;
+	Proxy->M_Params.Files = Files;
+	Proxy->M_Params.Directories = Directories;
+	Proxy->M_Params.bIncremental = bIncremental;
+	OutProxy = Proxy;
+	return Proxy;
+}
+
+UCPM_CreateZipProxy* UCPM_CreateZipProxy::ZipAndUploadProxy(const FString& UploadURL, const TArray<FString>& Files, const TArray<FString>& Directories, const bool bStreamStored, const bool bResumableUpload, UCPM_CreateZipProxy*& OutProxy)
+{
+	UCPM_CreateZipProxy* Proxy = NewObject<UCPM_CreateZipProxy>();
+	Proxy->M_Params.UploadURL = UploadURL;
+	Proxy->M_Params.bStreamStored = bStreamStored;
+	Proxy->M_Params.bResumableUpload = bResumableUpload;
+	Proxy->M_Params.Files = Files;
+	Proxy->M_Params.Directories = Directories;
+	OutProxy = Proxy;
+	return Proxy;
+}
+
+void UCPM_CreateZipProxy::Activate()
+{
+	AddToRoot();
+
+	TWeakObjectPtr<UCPM_CreateZipProxy> WeakThis(this);
+	M_Job = FCPM_ZipJob::Start(M_Params, FCPM_ZipJob::FOnProgress::CreateLambda([WeakThis](const FCPM_ZipProgress& Progress)
+	{
+		if (WeakThis.IsValid())
+		{
+			WeakThis->OnProgress.Broadcast(Progress);
+		}
+	}), FCPM_ZipJob::FOnCompleted::CreateLambda([WeakThis](const FCPM_ZipJobResult& Result)
+	{
+		if (!WeakThis.IsValid())
+		{
+			return;
+		}
+
+		UCPM_CreateZipProxy* Proxy = WeakThis.Get();
+		if (Result.bSuccess)
+		{
+			Proxy->OnSuccess.Broadcast(Result);
+		}
+		else if (Result.bCancelled)
+		{
+			Proxy->OnCancelled.Broadcast(Result);
+		}
+		else
+		{
+			Proxy->OnFailure.Broadcast(Result);
+		}
+
+		Proxy->M_Job.Reset();
+		Proxy->RemoveFromRoot();
+		Proxy->SetReadyToDestroy();
+	}));
+}
+
+void UCPM_CreateZipProxy::CancelZip()
+{
+	if (M_Job.IsValid())
+	{
+		M_Job->Cancel();
+	}
+}
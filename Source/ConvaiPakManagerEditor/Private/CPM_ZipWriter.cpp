@@ -0,0 +1,400 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CPM_ZipWriter.h"
+#include "Misc/Crc.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace
+{
+	constexpr uint32 LocalHeaderSignature = 0x04034b50;
+	constexpr uint32 CentralHeaderSignature = 0x02014b50;
+	constexpr uint32 EndOfCentralDirectorySignature = 0x06054b50;
+	constexpr uint32 Zip64EndOfCentralDirectorySignature = 0x06064b50;
+	constexpr uint32 Zip64LocatorSignature = 0x07064b50;
+	constexpr uint32 DataDescriptorSignature = 0x08074b50;
+
+	constexpr uint16 Zip64ExtraFieldId = 0x0001;
+	constexpr uint16 VersionDefault = 20;
+	constexpr uint16 VersionZip64 = 45;
+	constexpr uint16 FlagDataDescriptor = 1 << 3;
+	constexpr uint16 FlagUtf8Names = 1 << 11;
+
+	constexpr uint32 Max32 = 0xFFFFFFFF;
+	constexpr uint16 Max16 = 0xFFFF;
+
+	/** Offset of the crc field inside a local file header */
+	constexpr int64 LocalHeaderCrcOffset = 14;
+	constexpr int64 LocalHeaderFixedSize = 30;
+	constexpr int64 CentralHeaderFixedSize = 46;
+	constexpr int64 EndOfCentralDirectorySize = 22;
+	constexpr int64 Zip64EndOfCentralDirectorySize = 56;
+	constexpr int64 Zip64LocatorSize = 20;
+}
+
+FCPM_ZipWriter::FCPM_ZipWriter(IFileHandle* InFile, const int32 InBufferSize, const bool bInSeekable)
+	: File(InFile)
+	, bSeekable(bInSeekable)
+{
+	Buffer.SetNumUninitialized(FMath::Max(InBufferSize, 4096));
+	bError = !File.IsValid();
+}
+
+FCPM_ZipWriter::~FCPM_ZipWriter()
+{
+	if (!bFinalized)
+	{
+		Finalize();
+	}
+}
+
+bool FCPM_ZipWriter::AddFile(const FString& ArchivePath, const FString& SourceFilePath, const FDateTime& Timestamp)
+{
+	const TUniquePtr<IFileHandle> Source(FPlatformFileManager::Get().GetPlatformFile().OpenRead(*SourceFilePath));
+	if (!Source.IsValid())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to read file: %s"), *SourceFilePath);
+		return false;
+	}
+
+	const int64 FileSize = Source->Size();
+	if (!BeginEntry(ArchivePath, ECompressionMethod::Store, Timestamp, FileSize >= Max32))
+	{
+		return false;
+	}
+
+	uint32 Crc = 0;
+	for (int64 Remaining = FileSize; Remaining > 0;)
+	{
+		const int64 ChunkSize = FMath::Min<int64>(Remaining, Buffer.Num());
+		if (!Source->Read(Buffer.GetData(), ChunkSize))
+		{
+			UE_LOG(LogTemp, Error, TEXT("Failed to read file: %s"), *SourceFilePath);
+			bError = true;
+			return false;
+		}
+
+		Crc = FCrc::MemCrc32(Buffer.GetData(), ChunkSize, Crc);
+		if (!WriteEntryData(Buffer.GetData(), ChunkSize))
+		{
+			return false;
+		}
+		Remaining -= ChunkSize;
+	}
+
+	return EndEntry(Crc, FileSize);
+}
+
+bool FCPM_ZipWriter::BeginEntry(const FString& ArchivePath, const ECompressionMethod Method, const FDateTime& Timestamp, const bool bMayNeedZip64)
+{
+	if (bError || bInEntry || bFinalized)
+	{
+		return false;
+	}
+
+	FEntry& Entry = Entries.AddDefaulted_GetRef();
+	Entry.Path = NormalizeArchivePath(ArchivePath);
+	Entry.Method = Method;
+	Entry.DosTime = ToDosTime(Timestamp);
+	Entry.LocalHeaderOffset = File->Tell();
+	// Sizes are only known once the data is written, so reserve the zip64 extra field up front when they could overflow
+	Entry.bZip64 = bMayNeedZip64;
+
+	const FTCHARToUTF8 Name(*Entry.Path);
+
+	TArray<uint8> Header;
+	FMemoryWriter Writer(Header);
+	uint32 Signature = LocalHeaderSignature;
+	uint16 Version = Entry.bZip64 ? VersionZip64 : VersionDefault;
+	uint16 Flags = FlagUtf8Names | (bSeekable ? 0 : FlagDataDescriptor);
+	uint16 MethodId = static_cast<uint16>(Method);
+	uint32 DosTime = Entry.DosTime;
+	uint32 Crc = 0;
+	uint32 Size32 = Entry.bZip64 ? Max32 : 0;
+	uint16 NameLength = Name.Length();
+	uint16 ExtraLength = Entry.bZip64 ? 20 : 0;
+	Writer << Signature << Version << Flags << MethodId << DosTime << Crc << Size32 << Size32 << NameLength << ExtraLength;
+	Writer.Serialize(const_cast<ANSICHAR*>(Name.Get()), NameLength);
+	if (Entry.bZip64)
+	{
+		uint16 ExtraId = Zip64ExtraFieldId;
+		uint16 ExtraSize = 16;
+		uint64 Size64 = 0;
+		Writer << ExtraId << ExtraSize << Size64 << Size64;
+	}
+
+	Entry.DataOffset = Entry.LocalHeaderOffset + Header.Num();
+	bInEntry = Write(Header.GetData(), Header.Num());
+	return bInEntry;
+}
+
+bool FCPM_ZipWriter::WriteEntryData(const void* Data, const int64 Size)
+{
+	if (!bInEntry)
+	{
+		return false;
+	}
+
+	if (!Write(Data, Size))
+	{
+		return false;
+	}
+	Entries.Last().CompressedSize += Size;
+	return true;
+}
+
+bool FCPM_ZipWriter::EndEntry(const uint32 Crc, const uint64 UncompressedSize)
+{
+	if (!bInEntry)
+	{
+		return false;
+	}
+	bInEntry = false;
+
+	FEntry& Entry = Entries.Last();
+	Entry.Crc = Crc;
+	Entry.UncompressedSize = UncompressedSize;
+
+	if (!Entry.bZip64 && (Entry.CompressedSize >= Max32 || Entry.UncompressedSize >= Max32))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Zip entry %s grew past 4 GB without a zip64 header"), *Entry.Path);
+		bError = true;
+		return false;
+	}
+
+	if (!bSeekable)
+	{
+		// Crc and sizes follow the data, readers find them through the data descriptor flag
+		TArray<uint8> Descriptor;
+		FMemoryWriter Writer(Descriptor);
+		uint32 Signature = DataDescriptorSignature;
+		uint32 DescriptorCrc = Crc;
+		Writer << Signature << DescriptorCrc;
+		if (Entry.bZip64)
+		{
+			uint64 Compressed64 = Entry.CompressedSize;
+			uint64 Uncompressed64 = Entry.UncompressedSize;
+			Writer << Compressed64 << Uncompressed64;
+		}
+		else
+		{
+			uint32 Compressed32 = static_cast<uint32>(Entry.CompressedSize);
+			uint32 Uncompressed32 = static_cast<uint32>(Entry.UncompressedSize);
+			Writer << Compressed32 << Uncompressed32;
+		}
+		return Write(Descriptor.GetData(), Descriptor.Num());
+	}
+
+	// Patch crc and sizes in the local header, then come back to the end of the archive
+	const int64 EndOffset = File->Tell();
+	const int64 NameLength = FTCHARToUTF8(*Entry.Path).Length();
+
+	TArray<uint8> Patch;
+	FMemoryWriter Writer(Patch);
+	uint32 PatchedCrc = Crc;
+	Writer << PatchedCrc;
+	if (!Entry.bZip64)
+	{
+		uint32 Compressed32 = static_cast<uint32>(Entry.CompressedSize);
+		uint32 Uncompressed32 = static_cast<uint32>(Entry.UncompressedSize);
+		Writer << Compressed32 << Uncompressed32;
+	}
+
+	bool bPatched = File->Seek(Entry.LocalHeaderOffset + LocalHeaderCrcOffset) && Write(Patch.GetData(), Patch.Num());
+	if (bPatched && Entry.bZip64)
+	{
+		uint64 Uncompressed64 = Entry.UncompressedSize;
+		uint64 Compressed64 = Entry.CompressedSize;
+		bPatched = File->Seek(Entry.LocalHeaderOffset + LocalHeaderFixedSize + NameLength + 4)
+			&& Write(&Uncompressed64, sizeof(Uncompressed64))
+			&& Write(&Compressed64, sizeof(Compressed64));
+	}
+
+	if (!bPatched || !File->Seek(EndOffset))
+	{
+		bError = true;
+		return false;
+	}
+	return true;
+}
+
+uint64 FCPM_ZipWriter::ComputeStreamedStoredSize(const TArray<FStreamedEntry>& InEntries)
+{
+	// Mirrors BeginEntry, EndEntry and WriteCentralDirectory for a non seekable writer
+	uint64 Offset = 0;
+	uint64 CentralDirectorySize = 0;
+	for (const FStreamedEntry& Entry : InEntries)
+	{
+		const int64 NameLength = FTCHARToUTF8(*NormalizeArchivePath(Entry.Path)).Length();
+		const bool bSize64 = Entry.Size >= Max32;
+		const bool bOffset64 = Offset >= Max32;
+		const int64 CentralExtraSize = (bSize64 ? 16 : 0) + (bOffset64 ? 8 : 0);
+
+		CentralDirectorySize += CentralHeaderFixedSize + NameLength + (CentralExtraSize > 0 ? CentralExtraSize + 4 : 0);
+		Offset += LocalHeaderFixedSize + NameLength + (Entry.bZip64 ? 20 : 0) + Entry.Size + (Entry.bZip64 ? 24 : 16);
+	}
+
+	const bool bZip64Archive = InEntries.Num() >= Max16 || Offset >= Max32 || CentralDirectorySize >= Max32;
+	return Offset + CentralDirectorySize + (bZip64Archive ? Zip64EndOfCentralDirectorySize + Zip64LocatorSize : 0) + EndOfCentralDirectorySize;
+}
+
+bool FCPM_ZipWriter::Finalize()
+{
+	if (bFinalized)
+	{
+		return !bError;
+	}
+	bFinalized = true;
+
+	if (bInEntry)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Zip finalized with an unfinished entry"));
+		bError = true;
+	}
+
+	if (!bError)
+	{
+		WriteCentralDirectory();
+	}
+
+	if (File.IsValid())
+	{
+		bError |= !File->Flush();
+		File.Reset();
+	}
+	return !bError;
+}
+
+bool FCPM_ZipWriter::WriteCentralDirectory()
+{
+	const uint64 CentralDirectoryOffset = File->Tell();
+
+	TArray<uint8> Record;
+	for (const FEntry& Entry : Entries)
+	{
+		Record.Reset();
+		FMemoryWriter Writer(Record);
+
+		const FTCHARToUTF8 Name(*Entry.Path);
+		const bool bUncompressed64 = Entry.UncompressedSize >= Max32;
+		const bool bCompressed64 = Entry.CompressedSize >= Max32;
+		const bool bOffset64 = Entry.LocalHeaderOffset >= Max32;
+		const uint16 ExtraSize = (bUncompressed64 ? 8 : 0) + (bCompressed64 ? 8 : 0) + (bOffset64 ? 8 : 0);
+
+		uint32 Signature = CentralHeaderSignature;
+		uint16 VersionMadeBy = VersionZip64;
+		uint16 VersionNeeded = (ExtraSize > 0 || Entry.bZip64) ? VersionZip64 : VersionDefault;
+		uint16 Flags = FlagUtf8Names | (bSeekable ? 0 : FlagDataDescriptor);
+		uint16 MethodId = static_cast<uint16>(Entry.Method);
+		uint32 DosTime = Entry.DosTime;
+		uint32 Crc = Entry.Crc;
+		uint32 Compressed32 = bCompressed64 ? Max32 : static_cast<uint32>(Entry.CompressedSize);
+		uint32 Uncompressed32 = bUncompressed64 ? Max32 : static_cast<uint32>(Entry.UncompressedSize);
+		uint16 NameLength = Name.Length();
+		uint16 ExtraLength = ExtraSize > 0 ? ExtraSize + 4 : 0;
+		uint16 CommentLength = 0;
+		uint16 DiskStart = 0;
+		uint16 InternalAttributes = 0;
+		uint32 ExternalAttributes = 0;
+		uint32 Offset32 = bOffset64 ? Max32 : static_cast<uint32>(Entry.LocalHeaderOffset);
+
+		Writer << Signature << VersionMadeBy << VersionNeeded << Flags << MethodId << DosTime << Crc << Compressed32 << Uncompressed32
+			<< NameLength << ExtraLength << CommentLength << DiskStart << InternalAttributes << ExternalAttributes << Offset32;
+		Writer.Serialize(const_cast<ANSICHAR*>(Name.Get()), NameLength);
+
+		if (ExtraSize > 0)
+		{
+			uint16 ExtraId = Zip64ExtraFieldId;
+			uint16 ExtraDataSize = ExtraSize;
+			Writer << ExtraId << ExtraDataSize;
+
+			// Only the fields that overflowed are present, always in this order
+			uint64 Uncompressed64 = Entry.UncompressedSize;
+			uint64 Compressed64 = Entry.CompressedSize;
+			uint64 Offset64 = Entry.LocalHeaderOffset;
+			if (bUncompressed64) { Writer << Uncompressed64; }
+			if (bCompressed64) { Writer << Compressed64; }
+			if (bOffset64) { Writer << Offset64; }
+		}
+
+		if (!Write(Record.GetData(), Record.Num()))
+		{
+			return false;
+		}
+	}
+
+	const uint64 CentralDirectoryEnd = File->Tell();
+	const uint64 CentralDirectorySize = CentralDirectoryEnd - CentralDirectoryOffset;
+	const uint64 NumEntries = Entries.Num();
+	const bool bZip64Archive = NumEntries >= Max16 || CentralDirectoryOffset >= Max32 || CentralDirectorySize >= Max32;
+
+	Record.Reset();
+	FMemoryWriter Writer(Record);
+
+	if (bZip64Archive)
+	{
+		uint32 Signature = Zip64EndOfCentralDirectorySignature;
+		uint64 RecordSize = 44;
+		uint16 VersionMadeBy = VersionZip64;
+		uint16 VersionNeeded = VersionZip64;
+		uint32 Disk = 0;
+		uint32 CentralDirectoryDisk = 0;
+		uint64 EntriesOnDisk = NumEntries;
+		uint64 TotalEntries = NumEntries;
+		uint64 Size64 = CentralDirectorySize;
+		uint64 Offset64 = CentralDirectoryOffset;
+		Writer << Signature << RecordSize << VersionMadeBy << VersionNeeded << Disk << CentralDirectoryDisk << EntriesOnDisk << TotalEntries << Size64 << Offset64;
+
+		uint32 LocatorSignature = Zip64LocatorSignature;
+		uint32 LocatorDisk = 0;
+		uint64 Zip64RecordOffset = CentralDirectoryEnd;
+		uint32 TotalDisks = 1;
+		Writer << LocatorSignature << LocatorDisk << Zip64RecordOffset << TotalDisks;
+	}
+
+	uint32 Signature = EndOfCentralDirectorySignature;
+	uint16 Disk = 0;
+	uint16 CentralDirectoryDisk = 0;
+	uint16 Entries16 = bZip64Archive ? Max16 : static_cast<uint16>(NumEntries);
+	uint32 Size32 = bZip64Archive ? Max32 : static_cast<uint32>(CentralDirectorySize);
+	uint32 Offset32 = bZip64Archive ? Max32 : static_cast<uint32>(CentralDirectoryOffset);
+	uint16 CommentLength = 0;
+	Writer << Signature << Disk << CentralDirectoryDisk << Entries16 << Entries16 << Size32 << Offset32 << CommentLength;
+
+	return Write(Record.GetData(), Record.Num());
+}
+
+bool FCPM_ZipWriter::Write(const void* Data, const int64 Size)
+{
+	if (bError)
+	{
+		return false;
+	}
+
+	if (Size > 0 && !File->Write(static_cast<const uint8*>(Data), Size))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to write zip data"));
+		bError = true;
+		return false;
+	}
+	return true;
+}
+
+uint32 FCPM_ZipWriter::ToDosTime(const FDateTime& Timestamp)
+{
+	// Dos dates start in 1980, clamp anything older instead of wrapping
+	const FDateTime Clamped = FMath::Max(Timestamp, FDateTime(1980, 1, 1));
+	const uint32 Date = ((Clamped.GetYear() - 1980) << 9) | (Clamped.GetMonth() << 5) | Clamped.GetDay();
+	const uint32 Time = (Clamped.GetHour() << 11) | (Clamped.GetMinute() << 5) | (Clamped.GetSecond() >> 1);
+	return (Date << 16) | Time;
+}
+
+FString FCPM_ZipWriter::NormalizeArchivePath(const FString& Path)
+{
+	FString Result = Path.Replace(TEXT("\\"), TEXT("/")).TrimStartAndEnd();
+	while (Result.StartsWith(TEXT("/")))
+	{
+		Result.RightChopInline(1);
+	}
+	return Result;
+}
@@ -1,15 +1,23 @@
 // Copyright 2022 Convai Inc. All Rights Reserved.
 
 #include "ConvaiPakManagerEditor.h"
+#include "CPM_ZipJob.h"
+#include "CPM_FileJournal.h"
+#include "CPM_PackagingCache.h"
 #define LOCTEXT_NAMESPACE "FConvaiPakManagerEditorModule"
 
 void FConvaiPakManagerEditorModule::StartupModule()
 {
+	if (GetDefault<UCPM_PackagingSettings>()->bEnableFileJournal)
+	{
+		FCPM_FileJournal::Get().Start();
+	}
 }
 
 void FConvaiPakManagerEditorModule::ShutdownModule()
 {
-	
+	FCPM_FileJournal::Get().Stop();
+	FCPM_ZipJob::ShutdownPool();
 }
 
 #undef LOCTEXT_NAMESPACE
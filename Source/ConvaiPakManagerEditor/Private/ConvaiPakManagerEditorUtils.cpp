@@ -3,6 +3,9 @@
 
 #include "ConvaiPakManagerEditorUtils.h"
 #include "CPM_Defination.h"
+#include "CPM_PakBudget.h"
+#include "CPM_PackagingCache.h"
+#include "Utility/CPM_UtilityLibrary.h"
 #include "AssetRegistry/AssetRegistryModule.h"
 #include "Misc/PackageName.h"
 #include "UObject/Package.h"
@@ -15,12 +18,20 @@
 #include "IUATHelperModule.h"
 #include "Async/Async.h"
 #include "Misc/Paths.h"
+#include "HAL/FileManager.h"
 #include "Logging/LogMacros.h"
 #include "Settings/ContentBrowserSettings.h"
 #include "EditorViewportClient.h"               
 #include "ImageUtils.h"
 #include "Slate/SceneViewport.h"
-#include "FileUtilities/ZipArchiveWriter.h"
+#include "CPM_ZipBuilder.h"
+#include "CPM_ZipJob.h"
+#include "CPM_FileJournal.h"
+#include "CPM_DependencyWalker.h"
+#include "CPM_DependencyCacheSubsystem.h"
+#include "CPM_DependencyGraph.h"
+#include "Engine/AssetManager.h"
+#include "Engine/PrimaryAssetLabel.h"
 #include "Editor.h"
 #include "EngineUtils.h"
 #include "Engine/World.h"
@@ -89,61 +100,322 @@ void UConvaiPakManagerEditorUtils::CPM_TogglePlayMode()
 #endif
 }
 
-void UConvaiPakManagerEditorUtils::CPM_PackageProject(const FCPM_PackageParam& PackageParam, const FOnUatTaskResultCallack OnPackagingCompleted)
+/**
+ * Package of the primary asset label that assigns its assets to ChunkID, None when there is none.
+ * A label with bLabelAssetsInMyDirectory references nothing in its folder, OutCookDirectory is then
+ * that folder on disk so the cook picks up its assets. Assets a label only pulls in through an
+ * asset collection are not cooked, RootPackage has to reference those.
+ */
+static FName FindPrimaryAssetLabelForChunk(const FString& ChunkID, FString& OutCookDirectory)
 {
-	if (!PackageParam.IsValid())
+	OutCookDirectory.Reset();
+
+	int32 ChunkId = INDEX_NONE;
+	if (!LexTryParseString(ChunkId, *ChunkID) || !UAssetManager::IsInitialized())
+	{
+		return NAME_None;
+	}
+
+	UAssetManager& AssetManager = UAssetManager::Get();
+	TArray<FPrimaryAssetId> LabelIds;
+	AssetManager.GetPrimaryAssetIdList(UAssetManager::PrimaryAssetLabelType, LabelIds);
+	for (const FPrimaryAssetId& LabelId : LabelIds)
+	{
+		if (AssetManager.GetPrimaryAssetRules(LabelId).ChunkId == ChunkId)
+		{
+			const FSoftObjectPath LabelPath = AssetManager.GetPrimaryAssetPath(LabelId);
+			if (const UPrimaryAssetLabel* Label = Cast<UPrimaryAssetLabel>(LabelPath.TryLoad()); Label && Label->bLabelAssetsInMyDirectory)
+			{
+				const FString LabelFolder = FPackageName::GetLongPackagePath(LabelPath.GetLongPackageName());
+				OutCookDirectory = FPaths::ConvertRelativePathToFull(FPackageName::LongPackageNameToFilename(LabelFolder + TEXT("/")));
+			}
+			return LabelPath.GetLongPackageFName();
+		}
+	}
+	return NAME_None;
+}
+
+/**
+ * Pak of PackageParam's chunk as this run writes it. Staging (asset only) and archiving (full project)
+ * both lay the output out as <OutputDirectory>/<CookPlatform>/<Project>/Content/Paks.
+ */
+static FString GetPackagedPakPath(const FCPM_PackageParam& PackageParam, const FString& ProjectName)
+{
+    const FString CookPlatform = FCPM_PackagingCache::GetCookPlatformName(PackageParam.Platform);
+    return FPaths::Combine(PackageParam.OutputDirectory, CookPlatform, ProjectName, TEXT("Content"), TEXT("Paks"),
+        FString::Printf(TEXT("pakchunk%s-%s.pak"), *PackageParam.ChunkID, *CookPlatform));
+}
+
+/**
+ * The asset only cook is not limited to one chunk, staging writes a pak (with its .ucas, .utoc and
+ * .sig) for every chunk that got cooked content. Everything but PackageParam's chunk is removed.
+ */
+static void RemoveOtherChunkPaks(const FCPM_PackageParam& PackageParam, const FString& ProjectName)
+{
+    const FString PaksDirectory = FPaths::GetPath(GetPackagedPakPath(PackageParam, ProjectName));
+    const FString KeepPrefix = FString::Printf(TEXT("pakchunk%s-"), *PackageParam.ChunkID);
+
+    TArray<FString> ChunkFiles;
+    IFileManager::Get().FindFiles(ChunkFiles, *FPaths::Combine(PaksDirectory, TEXT("pakchunk*")), true, false);
+    for (const FString& ChunkFile : ChunkFiles)
     {
-        UE_LOG(LogTemp, Error, TEXT("PackageParam is not valid"));
-        return;
+        if (!ChunkFile.StartsWith(KeepPrefix) && !IFileManager::Get().Delete(*FPaths::Combine(PaksDirectory, ChunkFile), false, true, true))
+        {
+            UE_LOG(LogTemp, Warning, TEXT("Failed to remove %s from the staged paks"), *ChunkFile);
+        }
     }
+}
 
+/**
+ * Cooks and paks PackageParam for all Platforms in one UAT run, calling OnPlatformCompleted once per
+ * platform. The cooker loads every package once and saves it for each platform, so the platforms
+ * share the load, the DDC and everything else that does not depend on the target.
+ */
+static void LaunchPackaging(const FCPM_PackageParam& PackageParam, const TArray<ECPM_Platform>& Platforms, TFunction<void(ECPM_Platform, const FString&, double)> OnPlatformCompleted)
+{
     const FString ProjectFilePath = FPaths::ConvertRelativePathToFull(FPaths::GetProjectFilePath());
     const FString ProjectName = FPaths::GetBaseFilename(ProjectFilePath);
     const FString UnrealExe = FPlatformProcess::ExecutablePath();
 
-    const FString CommandLine = FString::Printf(
-        TEXT(
-          "-ScriptsForProject=\"%s\" "
-          "Turnkey -command=VerifySdk -platform=%s -UpdateIfNeeded "
-          "-EditorIO -EditorIOPort=55342 "
-          "-project=\"%s\" "
-          "BuildCookRun "
-            "-nop4 -utf8output -nocompileeditor -skipbuildeditor "
-            "-cook -project=\"%s\" -target=%s "
-            "-unrealexe=\"%s\" -platform=%s -installed "
-            "-stage -archive -package -build -pak -compressed -prereqs "
-            "-archivedirectory=\"%s\" -manifests "
-            "-clientconfig=%s -nodebuginfo"
-        ),
-        *ProjectFilePath,              // -ScriptsForProject
-        *PackageParam.GetPlatform(),        // -platform=Win64
-        *ProjectFilePath,              // first -project for VerifySdk
-        *ProjectFilePath,              // second -project for BuildCookRun
-        *ProjectName,                  // -target=Blank_53
-        *UnrealExe,                    // -unrealexe="...Editor-Cmd.exe"
-        *PackageParam.GetPlatform(),        // -platform=Win64
-        *PackageParam.OutputDirectory, // -archivedirectory="D:/UEProjects/..."
-        *PackageParam.Configuration    // -clientconfig=Shipping
-    );
+    const bool bAssetOnly = PackageParam.PackageMode == ECPM_PackageMode::AssetOnly;
+
+    // VerifySdk only runs again for platforms whose engine or installed SDK changed since it last passed
+    TArray<FCPM_PackageParam> PlatformParams;
+    TArray<FString> UnverifiedPlatforms;
+    for (const ECPM_Platform Platform : Platforms)
+    {
+        FCPM_PackageParam& PlatformParam = PlatformParams.Add_GetRef(PackageParam);
+        PlatformParam.Platform = Platform;
+        if (!bAssetOnly && !FCPM_PackagingCache::IsSdkVerified(PlatformParam.GetPlatform()))
+        {
+            UnverifiedPlatforms.Add(PlatformParam.GetPlatform());
+        }
+    }
+    const FString UatPlatforms = FString::JoinBy(PlatformParams, TEXT("+"), [](const FCPM_PackageParam& PlatformParam) { return PlatformParam.GetPlatform(); });
+    const FString SdkStep = UnverifiedPlatforms.Num() > 0
+        ? FString::Printf(TEXT("Turnkey -command=VerifySdk -platform=%s -UpdateIfNeeded -EditorIO -EditorIOPort=55342 -project=\"%s\" "), *FString::Join(UnverifiedPlatforms, TEXT("+")), *ProjectFilePath)
+        : FString();
+
+    // The cook output outlives the run so -iterate can skip every package whose inputs did not change
+    const UCPM_PackagingSettings* Settings = GetDefault<UCPM_PackagingSettings>();
+    const FString CookOutputDirectory = FCPM_PackagingCache::GetCookOutputDirectory();
+    FString CookOptions = FString::Printf(TEXT("-CookOutputDir=\"%s\"%s"), *CookOutputDirectory, PackageParam.bIterativeCook ? TEXT(" -iterate") : TEXT(""));
+    const int32 NumCookProcesses = Settings->bMultiprocessCook ? Settings->GetNumCookProcesses(PlatformParams.Num()) : 1;
+    if (NumCookProcesses > 1)
+    {
+        CookOptions += FString::Printf(TEXT(" -AdditionalCookerOptions=-cookprocesscount=%d"), NumCookProcesses);
+    }
+    if (!Settings->SharedDDC.IsEmpty())
+    {
+        CookOptions += FString::Printf(TEXT(" -ddc=%s"), *Settings->SharedDDC);
+    }
+    const FDateTime CookStartTime = FDateTime::UtcNow();
+
+    FString CommandLine;
+    if (bAssetOnly)
+    {
+        FString CookDirectory;
+        const FName RootPackage = !PackageParam.RootPackage.IsNone() ? PackageParam.RootPackage : FindPrimaryAssetLabelForChunk(PackageParam.ChunkID, CookDirectory);
+        if (RootPackage.IsNone())
+        {
+            UE_LOG(LogTemp, Error, TEXT("No primary asset label assigns assets to chunk %s, set RootPackage"), *PackageParam.ChunkID);
+            for (const FCPM_PackageParam& PlatformParam : PlatformParams)
+            {
+                OnPlatformCompleted(PlatformParam.Platform, TEXT("Failed"), 0.0);
+            }
+            return;
+        }
+        if (!CookDirectory.IsEmpty())
+        {
+            CookOptions += FString::Printf(TEXT(" -cookdir=\"%s\""), *CookDirectory);
+        }
+
+        // -map only adds the label to what gets cooked, it does not limit the cook to its closure: the
+        // asset manager still adds every AlwaysCook primary asset, every primary asset label included,
+        // and -cookdir adds the label's whole folder. Staging then writes a pak for every chunk, the ones
+        // of other chunks are removed once it completed. Without -build, -archive, -package and -prereqs
+        // UAT only copies the prebuilt runtime next to the paks.
+        CommandLine = FString::Printf(
+            TEXT(
+              "-ScriptsForProject=\"%s\" "
+              "BuildCookRun "
+                "-nop4 -utf8output -nocompileeditor -skipbuildeditor -nocompile -nocompileuat "
+                "-cook %s -skipcookingeditorcontent -map=%s "
+                "-project=\"%s\" -target=%s "
+                "-unrealexe=\"%s\" -platform=%s -installed "
+                "-stage -pak -compressed "
+                "-stagingdirectory=\"%s\" -manifests "
+                "-clientconfig=%s -nodebuginfo"
+            ),
+            *ProjectFilePath,
+            *CookOptions,
+            *RootPackage.ToString(),
+            *ProjectFilePath,
+            *ProjectName,
+            *UnrealExe,
+            *UatPlatforms,
+            *PackageParam.OutputDirectory,
+            *PackageParam.Configuration
+        );
+    }
+    else
+    {
+        CommandLine = FString::Printf(
+            TEXT(
+              "-ScriptsForProject=\"%s\" "
+              "%s"
+              "BuildCookRun "
+                "-nop4 -utf8output -nocompileeditor -skipbuildeditor "
+                "-cook %s -project=\"%s\" -target=%s "
+                "-unrealexe=\"%s\" -platform=%s -installed "
+                "-stage -archive -package -build -pak -compressed -prereqs "
+                "-archivedirectory=\"%s\" -manifests "
+                "-clientconfig=%s -nodebuginfo"
+            ),
+            *ProjectFilePath,              // -ScriptsForProject
+            *SdkStep,                      // Turnkey VerifySdk, empty when cached
+            *CookOptions,                  // -CookOutputDir, -iterate, cook processes and DDC
+            *ProjectFilePath,              // -project for BuildCookRun
+            *ProjectName,                  // -target=Blank_53
+            *UnrealExe,                    // -unrealexe="...Editor-Cmd.exe"
+            *UatPlatforms,                 // -platform=Win64+Linux
+            *PackageParam.OutputDirectory, // -archivedirectory="D:/UEProjects/..."
+            *PackageParam.Configuration    // -clientconfig=Shipping
+        );
+    }
 
     IUATHelperModule::Get().CreateUatTask(
         CommandLine,
-        FText::FromString(PackageParam.GetPlatform()),              // PlatformDisplayName
-        FText::FromString(TEXT("Packaging Project")),               // TaskName
-        FText::FromString(TEXT("Packaging")),                       // TaskShortName
+        FText::FromString(UatPlatforms),                            // PlatformDisplayName
+        FText::FromString(bAssetOnly ? TEXT("Cooking Asset") : TEXT("Packaging Project")), // TaskName
+        FText::FromString(bAssetOnly ? TEXT("Cooking") : TEXT("Packaging")),               // TaskShortName
         nullptr,                                                    // TaskIcon
         /*OptionalAnalyticsParamArray=*/ nullptr,                   // Analytics params (UE5.3+)
         [=](FString Result, double Runtime)
         {
+            TArray<FCPM_CookReport> CookReports;
+            for (const FCPM_PackageParam& PlatformParam : PlatformParams)
+            {
+                FCPM_CookReport& CookReport = CookReports.AddDefaulted_GetRef();
+                CookReport.Platform = PlatformParam.Platform;
+                CookReport.bIterative = PackageParam.bIterativeCook;
+                CookReport.bSdkVerificationSkipped = !bAssetOnly && !UnverifiedPlatforms.Contains(PlatformParam.GetPlatform());
+                CookReport.CookOutputDirectory = CookOutputDirectory;
+                CookReport.FinishedAt = FDateTime::UtcNow();
+                if (Result == TEXT("Completed"))
+                {
+                    FCPM_PackagingCache::CountCookedPackages(PlatformParam.Platform, CookStartTime, CookReport);
+                }
+            }
+
             AsyncTask(ENamedThreads::GameThread, [=]()
             {
-                OnPackagingCompleted.ExecuteIfBound(Result, Runtime);
+                for (int32 Index = 0; Index < PlatformParams.Num(); ++Index)
+                {
+                    const FCPM_PackageParam& PlatformParam = PlatformParams[Index];
+                    const FCPM_CookReport& CookReport = CookReports[Index];
+
+                    // The run's result covers every platform, one that left no output still failed
+                    FString FinalResult = Result;
+                    const FString PlatformOutput = PlatformParam.ChunkID.IsEmpty()
+                        ? FPaths::Combine(PlatformParam.OutputDirectory, FCPM_PackagingCache::GetCookPlatformName(PlatformParam.Platform))
+                        : GetPackagedPakPath(PlatformParam, ProjectName);
+                    if (Result == TEXT("Completed") && !FPaths::FileExists(PlatformOutput) && !FPaths::DirectoryExists(PlatformOutput))
+                    {
+                        UE_LOG(LogTemp, Error, TEXT("Packaging completed but %s is missing"), *PlatformOutput);
+                        FinalResult = TEXT("Failed");
+                    }
+                    else if (Result == TEXT("Completed"))
+                    {
+                        if (bAssetOnly && !PlatformParam.ChunkID.IsEmpty())
+                        {
+                            RemoveOtherChunkPaks(PlatformParam, ProjectName);
+                        }
+                        if (UnverifiedPlatforms.Contains(PlatformParam.GetPlatform()))
+                        {
+                            FCPM_PackagingCache::MarkSdkVerified(PlatformParam.GetPlatform());
+                        }
+                        FCPM_PackagingCache::SaveCookReport(CookReport);
+                        UE_LOG(LogTemp, Log, TEXT("Cooked %s: %d of %d packages recooked%s%s"), *PlatformParam.GetPlatform(), CookReport.NumRecookedPackages,
+                            CookReport.NumCookedPackages, CookReport.bIterative ? TEXT(", iterative") : TEXT(""), CookReport.bSdkVerificationSkipped ? TEXT(", SDK verification cached") : TEXT(""));
+                    }
+
+                    if (FinalResult == TEXT("Completed") && !PlatformParam.ChunkID.IsEmpty() && GetDefault<UCPM_PakBudgetSettings>()->bEnforceBudgets)
+                    {
+                        FString AssetID = PlatformParam.AssetID;
+                        if (AssetID.IsEmpty())
+                        {
+                            UCPM_UtilityLibrary::GetAssetID(AssetID);
+                        }
+                        const ECPM_AssetType AssetType = PlatformParam.AssetType != ECPM_AssetType::Max ? PlatformParam.AssetType : UCPM_UtilityLibrary::GetAssetType();
+
+                        FCPM_PakBudgetReport Report;
+                        const FString PakFilePath = GetPackagedPakPath(PlatformParam, ProjectName);
+                        if (!FCPM_PakBudgetGate::Evaluate(PakFilePath, AssetType, AssetID, Report))
+                        {
+                            UE_LOG(LogTemp, Error, TEXT("Pak exceeds its size budget, see %s"), *Report.ReportFilePath);
+                            FinalResult = TEXT("BudgetExceeded");
+                        }
+                    }
+                    OnPlatformCompleted(PlatformParam.Platform, FinalResult, Runtime);
+                }
             });
         },
         FString()                                                   // ResultLocation
     );
 }
 
+void UConvaiPakManagerEditorUtils::CPM_PackageProject(const FCPM_PackageParam& PackageParam, const FOnUatTaskResultCallack OnPackagingCompleted)
+{
+	if (!PackageParam.IsValid())
+    {
+        UE_LOG(LogTemp, Error, TEXT("PackageParam is not valid"));
+        return;
+    }
+
+    LaunchPackaging(PackageParam, { PackageParam.Platform }, [OnPackagingCompleted](ECPM_Platform, const FString& Result, const double Runtime)
+    {
+        OnPackagingCompleted.ExecuteIfBound(Result, Runtime);
+    });
+}
+
+void UConvaiPakManagerEditorUtils::CPM_PackageProjectForPlatforms(const FCPM_PackageParam& PackageParam, const TSet<ECPM_Platform>& Platforms, const FOnUatTaskResultCallack OnPlatformCompleted)
+{
+    TArray<ECPM_Platform> PlatformList;
+    for (const ECPM_Platform Platform : Platforms)
+    {
+        FCPM_PackageParam PlatformParam = PackageParam;
+        PlatformParam.Platform = Platform;
+        if (!PlatformParam.IsValid())
+        {
+            UE_LOG(LogTemp, Error, TEXT("PackageParam is not valid for platform %s"), *UEnum::GetValueAsString(Platform));
+            return;
+        }
+        PlatformList.Add(Platform);
+    }
+
+    if (PlatformList.Num() == 0)
+    {
+        UE_LOG(LogTemp, Error, TEXT("No platform to package"));
+        return;
+    }
+
+    LaunchPackaging(PackageParam, PlatformList, [OnPlatformCompleted](const ECPM_Platform Platform, const FString& Result, const double Runtime)
+    {
+        OnPlatformCompleted.ExecuteIfBound(FString::Printf(TEXT("%s:%s"), *FCPM_PackagingCache::GetCookPlatformName(Platform), *Result), Runtime);
+    });
+}
+
+bool UConvaiPakManagerEditorUtils::CPM_GetLastCookReport(const ECPM_Platform Platform, FCPM_CookReport& OutReport)
+{
+	return FCPM_PackagingCache::LoadCookReport(Platform, OutReport);
+}
+
+bool UConvaiPakManagerEditorUtils::CPM_EvaluatePakBudget(const FString& PakFilePath, const ECPM_AssetType AssetType, const FString& AssetID, FCPM_PakBudgetReport& OutReport)
+{
+	return FCPM_PakBudgetGate::Evaluate(PakFilePath, AssetType, AssetID, OutReport);
+}
+
 void UConvaiPakManagerEditorUtils::CPM_ToggleLiveCoding(const bool Enable)
 {
 	if (ILiveCodingModule* LiveCoding = FModuleManager::GetModulePtr<ILiveCodingModule>(LIVE_CODING_MODULE_NAME))
@@ -283,112 +555,68 @@ bool UConvaiPakManagerEditorUtils::CPM_TakeViewportScreenshot(const FString& Fil
 	return true;
 }
 
-bool UConvaiPakManagerEditorUtils::CPM_CreateZip(const FString& ZipFilePath, const TArray<FString>& Files, const TArray<FString>& Directories)
+bool UConvaiPakManagerEditorUtils::CPM_CreateZip(const FString& ZipFilePath, const TArray<FString>& Files, const TArray<FString>& Directories, const bool bIncremental)
 {
-	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
-	IFileHandle* FileHandle = PlatformFile.OpenWrite(*ZipFilePath);
-	if (!FileHandle)
+	// Entries are compressed in parallel and streamed in fixed size chunks, memory use does not depend on the size of the project
+	FCPM_ZipBuilder::FSettings ZipSettings;
+	ZipSettings.bIncremental = bIncremental;
+	FCPM_ZipBuilder ZipBuilder(ZipSettings);
+	ZipBuilder.AddProjectFiles(Files, Directories);
+	
+	if (!ZipBuilder.Write(ZipFilePath))
 	{
-		UE_LOG(LogTemp, Error, TEXT("Failed to create zip file: %s"), *ZipFilePath);
+		UE_LOG(LogTemp, Error, TEXT("Failed to write zip file: %s"), *ZipFilePath);
 		return false;
 	}
+	return true;
+}
 
-	FZipArchiveWriter ZipWriter(FileHandle);
-	const FString ProjectDir = FPaths::ProjectDir();
-
-	// Helper function to safely create relative path and add to zip
-	auto SafeAddFileToZip = [&](const FString& FilePath) -> bool
-	{
-		// Validate file exists
-		if (!PlatformFile.FileExists(*FilePath))
-		{
-			UE_LOG(LogTemp, Warning, TEXT("File not found: %s"), *FilePath);
-			return false;
-		}
-
-		// Create relative path
-		FString RelativePath = FilePath;
-		FPaths::MakePathRelativeTo(RelativePath, *ProjectDir);
-		
-		// Normalize path separators for zip compatibility
-		RelativePath = RelativePath.Replace(TEXT("\\"), TEXT("/"));
-		
-		// Remove any leading slashes
-		RelativePath = RelativePath.TrimStartAndEnd();
-		while (RelativePath.StartsWith(TEXT("/")))
-		{
-			RelativePath = RelativePath.RightChop(1);
-		}
-		
-		// Validate the relative path
-		if (RelativePath.IsEmpty() || RelativePath.Contains(TEXT("..")))
-		{
-			UE_LOG(LogTemp, Warning, TEXT("Invalid relative path for file: %s -> %s"), *FilePath, *RelativePath);
-			return false;
-		}
-
-		// Load file data
-		TArray<uint8> FileData;
-		if (!FFileHelper::LoadFileToArray(FileData, *FilePath))
-		{
-			UE_LOG(LogTemp, Error, TEXT("Failed to read file: %s"), *FilePath);
-			return false;
-		}
-
-		// Validate file data
-		if (FileData.Num() == 0)
-		{
-			UE_LOG(LogTemp, Warning, TEXT("Empty file: %s"), *FilePath);
-			return false;
-		}
-
-		// Add to zip
-		ZipWriter.AddFile(RelativePath, FileData, PlatformFile.GetTimeStamp(*FilePath));
-		return true;
-	};
+void UConvaiPakManagerEditorUtils::CPM_CreateZipAsync(const FString& ZipFilePath, const TArray<FString>& Files,
+	const TArray<FString>& Directories, const FOnUatTaskResultCallack OnZippingCompleted, const bool bIncremental)
+{
+	FCPM_ZipJob::FParams Params;
+	Params.ZipFilePath = ZipFilePath;
+	Params.Files = Files;
+	Params.Directories = Directories;
+	Params.bIncremental = bIncremental;
 
-	// Process directories
-	for (const FString& Directory : Directories)
+	FCPM_ZipJob::Start(Params, FCPM_ZipJob::FOnProgress(), FCPM_ZipJob::FOnCompleted::CreateLambda([OnZippingCompleted](const FCPM_ZipJobResult& Result)
 	{
-		if (!PlatformFile.DirectoryExists(*Directory))
-		{
-			UE_LOG(LogTemp, Warning, TEXT("Directory not found: %s"), *Directory);
-			continue;
-		}
-
-		TArray<FString> L_Files;
-		PlatformFile.FindFilesRecursively(L_Files, *Directory, nullptr);
-
-		for (const FString& FilePath : L_Files)
-		{
-			SafeAddFileToZip(FilePath);
-		}
-	}
+		OnZippingCompleted.ExecuteIfBound(Result.Result, Result.TotalSeconds);
+	}));
+}
 
-	// Process individual files
-	for (const FString& FilePath : Files)
+bool UConvaiPakManagerEditorUtils::CPM_MarkProjectSnapshot(const FString& Name)
+{
+	// Reconciling a large project takes a while, the caller retries instead of the editor freezing
+	if (!FCPM_FileJournal::Get().IsReconciled())
 	{
-		SafeAddFileToZip(FilePath);
+		UE_LOG(LogTemp, Warning, TEXT("File journal is not ready, snapshot %s was not recorded"), *Name);
+		return false;
 	}
-	
+	FCPM_FileJournal::Get().MarkSnapshot(Name);
 	return true;
 }
 
-void UConvaiPakManagerEditorUtils::CPM_CreateZipAsync(const FString& ZipFilePath, const TArray<FString>& Files,
-	const TArray<FString>& Directories, const FOnUatTaskResultCallack OnZippingCompleted)
+bool UConvaiPakManagerEditorUtils::CPM_GetProjectChangesSince(const FString& Name, TArray<FString>& ChangedFiles, TArray<FString>& RemovedFiles)
 {
-	Async(EAsyncExecution::Thread, [=]()
+	if (!FCPM_FileJournal::Get().IsReconciled())
 	{
-		const double StartTime = FPlatformTime::Seconds();
-		const bool bSuccess = CPM_CreateZip(ZipFilePath, Files, Directories);
-		const FString ResultMessage = bSuccess ? TEXT("Success") : TEXT("Failed");
-		const double Runtime = FPlatformTime::Seconds() - StartTime;
+		UE_LOG(LogTemp, Warning, TEXT("File journal is not ready, changes since %s are unknown"), *Name);
+		return false;
+	}
 
-		AsyncTask(ENamedThreads::GameThread, [=]()
-		{
-			OnZippingCompleted.ExecuteIfBound(ResultMessage, Runtime);
-		});
-	});
+	TArray<FCPM_FileChangeEntry> Changes;
+	if (!FCPM_FileJournal::Get().GetChangesSinceSnapshot(Name, Changes))
+	{
+		return false;
+	}
+
+	for (const FCPM_FileChangeEntry& Change : Changes)
+	{
+		(Change.Change == ECPM_FileChange::Removed ? RemovedFiles : ChangedFiles).Add(Change.Path);
+	}
+	return true;
 }
 
 AActor* UConvaiPakManagerEditorUtils::SpawnAndSnapActorToView(UClass* ActorClass)
@@ -520,7 +748,7 @@ AActor* UConvaiPakManagerEditorUtils::SpawnAndSnapActorToView(UClass* ActorClass
 }
 
 bool UConvaiPakManagerEditorUtils::GetPackageDependencies(const FName& PackageName, const TArray<FString>& FilterPaths, 
-	TSet<FName>& AllDependencies, TSet<FString>& ExternalObjectsPaths, TSet<FName>& ExcludedDependencies)
+	TSet<FName>& AllDependencies, TSet<FString>& ExternalObjectsPaths, TSet<FName>& ExcludedDependencies, const bool bDeterministicOrder)
 {
 	if (PackageName.IsNone())
 	{
@@ -528,134 +756,179 @@ bool UConvaiPakManagerEditorUtils::GetPackageDependencies(const FName& PackageNa
 	}
 
 	// Derive the mount point safely (preferred over manual splitting)
-	const FName MountPoint = FPackageName::GetPackageMountPoint(PackageName.ToString());
-	if (MountPoint.IsNone())
+	if (FPackageName::GetPackageMountPoint(PackageName.ToString()).IsNone())
 	{
 		return false; // malformed package path
 	}
-	const FString Root = TEXT("/") + MountPoint.ToString() + TEXT("/"); // e.g. "/ConvaiPluginContent/"
 
-	// We don't want to miss any violations, so never early-stop recursion.
-	auto NeverExclude = [FilterPaths](FName Dep) -> bool
-	{
-		const FString S = Dep.ToString();
-		for (const auto& It : FilterPaths)
-		{
-			if (!S.IsEmpty() && S.StartsWith(It))
-			{
-				return true;
-			}
-		}
-		return false;
-	};
-	
 	// Make sure outputs are clean before we fill them
 	// (comment out the Resets if you want to accumulate across multiple calls)
 	AllDependencies.Reset();
 	ExternalObjectsPaths.Reset();
-	
-	RecursiveGetDependencies(
-		PackageName,
-		AllDependencies,
-		ExternalObjectsPaths,
-		ExcludedDependencies,
-		NeverExclude
-	);
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	// Cached closures are always in deterministic order, they assume no exclusions carried over from a previous call
+	UCPM_DependencyCacheSubsystem* DependencyCache = GEditor ? GEditor->GetEditorSubsystem<UCPM_DependencyCacheSubsystem>() : nullptr;
+	if (DependencyCache && ExcludedDependencies.IsEmpty())
+	{
+		DependencyCache->GetDependencies(PackageName, FilterPaths, AllDependencies, ExternalObjectsPaths, ExcludedDependencies);
+		UE_LOG(LogTemp, Log, TEXT("Dependencies of %s: %d packages, %d excluded, %d external object paths in %.3fs (cache)"), *PackageName.ToString(),
+			AllDependencies.Num(), ExcludedDependencies.Num(), ExternalObjectsPaths.Num(), FPlatformTime::Seconds() - StartTime);
+	}
+	else
+	{
+		FCPM_DependencyWalker::FSettings WalkerSettings;
+		WalkerSettings.bDeterministicOrder = bDeterministicOrder;
+		FCPM_DependencyWalker Walker(IAssetRegistry::GetChecked(), WalkerSettings);
+		Walker.Walk(PackageName, AllDependencies, ExternalObjectsPaths, ExcludedDependencies, FCPM_DependencyWalker::MakeFilterPathsExclude(FilterPaths));
+		UE_LOG(LogTemp, Log, TEXT("Dependencies of %s: %d packages, %d excluded, %d processed, %d external object paths in %d scans, %.3fs (%s, %d levels)"), *PackageName.ToString(),
+			AllDependencies.Num(), ExcludedDependencies.Num(), Walker.GetNumProcessed(), ExternalObjectsPaths.Num(), Walker.GetNumScans(), FPlatformTime::Seconds() - StartTime,
+			Walker.WasParallel() ? TEXT("parallel") : TEXT("serial"), Walker.GetNumLevels());
+	}
 
 	// Check if every dependency sits under the same root
-	auto IsUnderAnyIgnoredRoot = [](const FString& PackagePath, const TArray<FString>& IgnoredRoots) -> bool
+	return FCPM_DependencyWalker::AreUnderSameMountPoint(PackageName, AllDependencies);
+}
+
+bool UConvaiPakManagerEditorUtils::GetPackageDependencySizes(const FName& PackageName, const TArray<FString>& FilterPaths, FCPM_DependencySizeReport& OutReport)
+{
+	OutReport = FCPM_DependencySizeReport();
+	if (PackageName.IsNone() || FPackageName::GetPackageMountPoint(PackageName.ToString()).IsNone())
 	{
-		for (const FString& InRoot : IgnoredRoots)
-		{
-			if (!InRoot.IsEmpty() && PackagePath.StartsWith(InRoot))
-			{
-				return true;
-			}
-		}
 		return false;
-	};
-	
-	bool bAllInsideSameRoot = true;
-	for (const FName& Dep : AllDependencies)
-	{
-		const FString DepStr = Dep.ToString();
-		if (!DepStr.StartsWith(Root))
-		{
-			bAllInsideSameRoot = false;
-			break;
-		}
 	}
 
-	return bAllInsideSameRoot;
+	const double StartTime = FPlatformTime::Seconds();
+	IAssetRegistry& AssetRegistry = IAssetRegistry::GetChecked();
+
+	// Chains need the walker's referencers, so this does not go through the dependency cache
+	FCPM_DependencyWalker::FSettings WalkerSettings;
+	WalkerSettings.bDeterministicOrder = true;
+	WalkerSettings.bRecordReferencers = true;
+	FCPM_DependencyWalker Walker(AssetRegistry, WalkerSettings);
+
+	TSet<FName> AllDependencies;
+	TSet<FString> ExternalObjectsPaths;
+	TSet<FName> ExcludedDependencies;
+	Walker.Walk(PackageName, AllDependencies, ExternalObjectsPaths, ExcludedDependencies, FCPM_DependencyWalker::MakeFilterPathsExclude(FilterPaths));
+
+	FCPM_DependencyAttribution::Build(AssetRegistry, PackageName, AllDependencies, &Walker, OutReport);
+	UE_LOG(LogTemp, Log, TEXT("Dependency sizes of %s: %d packages, %.1f MB on disk, %d without package data in %.3fs"), *PackageName.ToString(),
+		OutReport.Packages.Num(), OutReport.TotalDiskSize / (1024.0 * 1024.0), OutReport.NumWithoutPackageData, FPlatformTime::Seconds() - StartTime);
+
+	return FCPM_DependencyWalker::AreUnderSameMountPoint(PackageName, AllDependencies);
 }
 
-void UConvaiPakManagerEditorUtils::RecursiveGetDependencies(const FName& PackageName, TSet<FName>& AllDependencies, TSet<FString>& OutExternalObjectsPaths, TSet<FName>& ExcludedDependencies, const TFunction<bool (FName)>& ShouldExcludeFromDependenciesSearch)
+bool UConvaiPakManagerEditorUtils::GetBatchPackageDependencies(const TArray<FName>& RootPackages, const TArray<FString>& FilterPaths, FCPM_BatchDependencyResult& OutResult)
 {
-	FAssetRegistryModule& AssetRegistryModule = FModuleManager::Get().LoadModuleChecked<FAssetRegistryModule>(TEXT("AssetRegistry"));
-	TArray<FName> Dependencies;
-	IAssetRegistry& AssetRegistry = AssetRegistryModule.Get();
-	AssetRegistry.GetDependencies(PackageName, Dependencies);
-	
-	for (TArray<FName>::TConstIterator DependsIt = Dependencies.CreateConstIterator(); DependsIt; ++DependsIt)
+	OutResult = FCPM_BatchDependencyResult();
+	for (const FName RootPackage : RootPackages)
 	{
-		FString DependencyName = (*DependsIt).ToString();
+		if (RootPackage.IsNone() || FPackageName::GetPackageMountPoint(RootPackage.ToString()).IsNone())
+		{
+			UE_LOG(LogTemp, Warning, TEXT("GetBatchPackageDependencies: invalid root package '%s'"), *RootPackage.ToString());
+			return false;
+		}
+	}
 
-		const bool bIsScriptPackage = DependencyName.StartsWith(TEXT("/Script"));
+	const double StartTime = FPlatformTime::Seconds();
+	FCPM_DependencyGraph Graph;
+	Graph.Build(RootPackages, FCPM_DependencyWalker::MakeFilterPathsExclude(FilterPaths));
 
-		// The asset registry can give some reference to some deleted assets. We don't want to migrate these.
-		const bool bAssetExist = AssetRegistry.GetAssetPackageDataCopy(*DependsIt).IsSet();
+	OutResult.Packages = Graph.GetPackages();
+	OutResult.Roots.SetNum(Graph.GetNumRoots());
+	OutResult.RootCounts.SetNumZeroed(Graph.GetNumPackages());
+	Graph.ForEachClosure([&OutResult, &Graph](const int32 RootNumber, const TArray<int32>& Dependencies, const TArray<int32>& ExcludedDependencies)
+	{
+		FCPM_RootDependencies& Root = OutResult.Roots[RootNumber];
+		Root.RootPackage = Graph.GetRootPackage(RootNumber);
+		Root.Dependencies = Dependencies;
+		Root.ExcludedDependencies = ExcludedDependencies;
 
-		if (!bIsScriptPackage && bAssetExist)
+		const FString MountRoot = TEXT("/") + FPackageName::GetPackageMountPoint(Root.RootPackage.ToString()).ToString() + TEXT("/");
+		Root.bAllInsideSameRoot = !Dependencies.ContainsByPredicate([&Graph, &MountRoot](const int32 PackageIndex)
 		{
-			uint32 DependsHash = GetTypeHash(*DependsIt);
-			if (!AllDependencies.ContainsByHash(DependsHash, *DependsIt) && !ExcludedDependencies.ContainsByHash(DependsHash, *DependsIt))
-			{
-				// Early stop the dependency search
-				if (ShouldExcludeFromDependenciesSearch(*DependsIt))
-				{
-					ExcludedDependencies.AddByHash(DependsHash, *DependsIt);
-					continue;
-				}
+			return !FCPM_DependencyWalker::NameStartsWith(Graph.GetPackage(PackageIndex), MountRoot);
+		});
 
-				AllDependencies.AddByHash(DependsHash, *DependsIt);
+		for (const int32 PackageIndex : Dependencies)
+		{
+			OutResult.RootCounts[PackageIndex]++;
+		}
+	});
 
-				RecursiveGetDependencies(*DependsIt, AllDependencies, OutExternalObjectsPaths, ExcludedDependencies, ShouldExcludeFromDependenciesSearch);
-			}
+	for (FCPM_RootDependencies& Root : OutResult.Roots)
+	{
+		for (const int32 PackageIndex : Root.Dependencies)
+		{
+			Root.NumShared += OutResult.RootCounts[PackageIndex] > 1 ? 1 : 0;
 		}
 	}
+	for (const int32 RootCount : OutResult.RootCounts)
+	{
+		OutResult.NumSharedPackages += RootCount > 1 ? 1 : 0;
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("Dependencies of %d roots: %d packages in the shared table, %d processed, %d shared by several roots in %.3fs"),
+		Graph.GetNumRoots(), Graph.GetNumPackages(), Graph.GetNumProcessed(), OutResult.NumSharedPackages, FPlatformTime::Seconds() - StartTime);
+	return true;
+}
+
+bool UConvaiPakManagerEditorUtils::CheckPackageMountRoot(const FName& PackageName, const TArray<FString>& FilterPaths, FCPM_MountRootCheckResult& OutResult,
+	const int32 MaxViolations, const float TimeLimitSeconds)
+{
+	OutResult = FCPM_MountRootCheckResult();
+	const FName MountPoint = PackageName.IsNone() ? NAME_None : FPackageName::GetPackageMountPoint(PackageName.ToString());
+	if (MountPoint.IsNone())
+	{
+		return false;
+	}
+	OutResult.MountRoot = TEXT("/") + MountPoint.ToString() + TEXT("/");
 
-	// Handle Specific External Objects use case (only used for the Migrate path for now)
-	// todo: revisit how to handle those in a more generic way. Should the FExternalActorAssetDependencyGatherer handle the external objects reference also?
-	TArray<FAssetData> Assets;
+	const double StartTime = FPlatformTime::Seconds();
+	TArray<FName> Violations;
 
-	// The migration only work on the saved version of the assets so no need to scan the for the in memory only assets. This also greatly improve the performance of the migration when a lot assets are loaded in the editor.
-	const bool bOnlyIncludeOnDiskAssets = true;
-	if (AssetRegistryModule.Get().GetAssetsByPackageName(PackageName, Assets, bOnlyIncludeOnDiskAssets))
+	FCPM_DependencyWalker::FSettings WalkerSettings;
+	WalkerSettings.bRecordReferencers = true;
+	WalkerSettings.TimeLimitSeconds = TimeLimitSeconds;
+	WalkerSettings.StopAt = [&Violations, &OutResult, MaxViolations](const FName Dependency)
 	{
-		for (const FAssetData& AssetData : Assets)
+		if (FCPM_DependencyWalker::NameStartsWith(Dependency, OutResult.MountRoot))
 		{
-			if (AssetData.GetClass() && AssetData.GetClass()->IsChildOf<UWorld>())
-			{
-				TArray<FString> ExternalObjectsPaths = ULevel::GetExternalObjectsPaths(PackageName.ToString());
-				for (const FString& ExternalObjectsPath : ExternalObjectsPaths)
-				{
-					if (!ExternalObjectsPath.IsEmpty() && !OutExternalObjectsPaths.Contains(ExternalObjectsPath))
-					{
-						OutExternalObjectsPaths.Add(ExternalObjectsPath);
-						AssetRegistryModule.Get().ScanPathsSynchronous({ ExternalObjectsPath }, /*bForceRescan*/true, /*bIgnoreDenyListScanFilters*/true);
-
-						TArray<FAssetData> ExternalObjectAssets;
-						AssetRegistryModule.Get().GetAssetsByPath(FName(*ExternalObjectsPath), ExternalObjectAssets, /*bRecursive*/true, bOnlyIncludeOnDiskAssets);
-
-						for (const FAssetData& ExternalObjectAsset : ExternalObjectAssets)
-						{
-							// We don't expose the early dependency search exit to the external objects/actors since to the users their are same the outer package that own these objects
-							AllDependencies.Add(ExternalObjectAsset.PackageName);
-							RecursiveGetDependencies(ExternalObjectAsset.PackageName, AllDependencies, OutExternalObjectsPaths, ExcludedDependencies, ShouldExcludeFromDependenciesSearch);
-						}
-					}
-				}
-			}
+			return false;
 		}
+		Violations.Add(Dependency);
+		return MaxViolations > 0 && Violations.Num() >= MaxViolations;
+	};
+	FCPM_DependencyWalker Walker(IAssetRegistry::GetChecked(), WalkerSettings);
+
+	TSet<FName> AllDependencies;
+	TSet<FString> ExternalObjectsPaths;
+	TSet<FName> ExcludedDependencies;
+	Walker.Walk(PackageName, AllDependencies, ExternalObjectsPaths, ExcludedDependencies, FCPM_DependencyWalker::MakeFilterPathsExclude(FilterPaths));
+
+	for (const FName Violation : Violations)
+	{
+		FCPM_MountRootViolation& Entry = OutResult.Violations.AddDefaulted_GetRef();
+		Entry.PackageName = Violation;
+		Walker.GetReferencerChain(Violation, Entry.ReferencerChain);
 	}
+	OutResult.bComplete = !Walker.WasStopped();
+	OutResult.bPassed = OutResult.bComplete && Violations.Num() == 0;
+	OutResult.NumProcessed = Walker.GetNumProcessed();
+	OutResult.TotalSeconds = FPlatformTime::Seconds() - StartTime;
+
+	UE_LOG(LogTemp, Log, TEXT("Mount root check of %s: %s, %d violations, %d processed in %.3fs"), *PackageName.ToString(),
+		OutResult.bPassed ? TEXT("passed") : (OutResult.bComplete ? TEXT("failed") : TEXT("stopped early")), Violations.Num(), OutResult.NumProcessed, OutResult.TotalSeconds);
+	return OutResult.bPassed;
+}
+
+void UConvaiPakManagerEditorUtils::RecursiveGetDependencies(const FName& PackageName, TSet<FName>& AllDependencies, TSet<FString>& OutExternalObjectsPaths, TSet<FName>& ExcludedDependencies, const TFunction<bool (FName)>& ShouldExcludeFromDependenciesSearch)
+{
+	// Kept for existing callers, the walk itself is iterative. Serial, as existing exclude callbacks
+	// were written for the game thread and the parallel walk calls them from workers.
+	FCPM_DependencyWalker::FSettings Settings;
+	Settings.bParallel = false;
+	FCPM_DependencyWalker(IAssetRegistry::GetChecked(), Settings).Walk(PackageName, AllDependencies, OutExternalObjectsPaths, ExcludedDependencies, ShouldExcludeFromDependenciesSearch);
 }
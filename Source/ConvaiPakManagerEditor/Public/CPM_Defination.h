@@ -1,9 +1,18 @@
-﻿
+
 #pragma once
 
 #include "CoreMinimal.h"
 #include "CPM_Defination.generated.h"
 
+UENUM(BlueprintType)
+enum class ECPM_PackageMode : uint8
+{
+	/** BuildCookRun of the whole game, archived to OutputDirectory */
+	FullProject		UMETA(DisplayName = "Full Project"),
+	/** Cooks only the closure of RootPackage and paks it, no game binaries, archive or prerequisites */
+	AssetOnly		UMETA(DisplayName = "Asset Only")
+};
+
 USTRUCT(BlueprintType)
 struct FCPM_PackageParam
 {
@@ -18,11 +27,35 @@ struct FCPM_PackageParam
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Convai|PakManager")
 	FString OutputDirectory;
 
+	/** Chunk the asset is cooked into, when set the built pak is checked against the size budgets */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Convai|PakManager")
+	FString ChunkID;
+
+	/** Selects the budget, falls back to the project's modding metadata when left to None */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Convai|PakManager")
+	ECPM_AssetType AssetType = ECPM_AssetType::Max;
+
+	/** Key for the size history, falls back to the created asset id when empty */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Convai|PakManager")
+	FString AssetID;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Convai|PakManager")
+	ECPM_PackageMode PackageMode = ECPM_PackageMode::FullProject;
+
+	/** AssetOnly cooks the dependency closure of this package, defaults to the primary asset label of ChunkID and the folder it labels */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Convai|PakManager")
+	FName RootPackage;
+
+	/** Cooks into the persistent cook output under the cache directory and only recooks what changed since the last run */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Convai|PakManager")
+	bool bIterativeCook = true;
+
 	bool IsValid() const
 	{		
 		return !GetPlatform().IsEmpty()
 			&& !Configuration.IsEmpty()
-			&& !OutputDirectory.IsEmpty();
+			&& !OutputDirectory.IsEmpty()
+			&& (PackageMode != ECPM_PackageMode::AssetOnly || !ChunkID.IsEmpty() || !RootPackage.IsNone());
 	}
 
 	FString GetPlatform() const
@@ -0,0 +1,99 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "EditorSubsystem.h"
+#include "CPM_DependencyCacheSubsystem.generated.h"
+
+struct FAssetData;
+class UPackage;
+class FObjectPostSaveContext;
+
+/**
+ * Keeps the dependency closures GetPackageDependencies computes, keyed by root package and filter
+ * paths, so querying an unchanged scene again is a lookup. Asset registry events and package saves
+ * drop only the closures that contain the changed package, or whose world owns the external
+ * objects folder it lives in. Closures are saved to <Cache>/DependencyCache/DependencyCache.json
+ * with the saved hash of every package they contain, and checked against the registry before a
+ * closure loaded from disk is used for the first time.
+ */
+UCLASS()
+class CONVAIPAKMANAGEREDITOR_API UCPM_DependencyCacheSubsystem : public UEditorSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/** Same sets as FCPM_DependencyWalker, in deterministic order, computed only when nothing valid is cached */
+	void GetDependencies(FName RootPackage, const TArray<FString>& FilterPaths, TSet<FName>& AllDependencies,
+		TSet<FString>& ExternalObjectsPaths, TSet<FName>& ExcludedDependencies);
+
+	/** Drops every closure that depends on the package */
+	UFUNCTION(BlueprintCallable, Category = "Convai|PakManager")
+	void InvalidatePackage(FName PackageName);
+
+	UFUNCTION(BlueprintCallable, Category = "Convai|PakManager")
+	void ClearCache();
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Convai|PakManager")
+	int32 GetNumCachedClosures() const { return Closures.Num(); }
+
+	/** Writes the cache to disk if it changed since the last save */
+	UFUNCTION(BlueprintCallable, Category = "Convai|PakManager")
+	void SaveCache();
+
+	static FString GetCachePath();
+
+private:
+	struct FClosure
+	{
+		FName RootPackage;
+		TArray<FString> FilterPaths;
+		TArray<FName> AllDependencies;
+		TArray<FName> ExcludedDependencies;
+		TArray<FString> ExternalObjectsPaths;
+
+		/**
+		 * Saved hash and size of the root and of every package above, also the membership test for invalidation.
+		 * Referenced packages missing on disk are in here with an empty fingerprint, so adding one invalidates.
+		 */
+		TMap<FName, FString> Fingerprints;
+
+		/** False for closures loaded from disk until their fingerprints were compared with the registry */
+		bool bVerified = false;
+	};
+
+	static FString MakeKey(FName RootPackage, const TArray<FString>& FilterPaths);
+	FString GetFingerprint(FName PackageName) const;
+
+	void ComputeClosure(FClosure& Closure) const;
+
+	/** Whether a closure loaded from disk still matches the packages on disk */
+	bool IsStillValid(const FClosure& Closure) const;
+	bool DependsOn(const FClosure& Closure, FName PackageName) const;
+
+	void OnAssetAdded(const FAssetData& AssetData);
+	void OnAssetRemoved(const FAssetData& AssetData);
+	void OnAssetUpdated(const FAssetData& AssetData);
+	void OnAssetRenamed(const FAssetData& AssetData, const FString& OldObjectPath);
+	void OnPackageSaved(const FString& PackageFilename, UPackage* Package, FObjectPostSaveContext SaveContext);
+
+	/** Registry events during the initial scan describe the existing project, not changes */
+	bool ShouldHandleRegistryEvents() const;
+
+	void LoadCache();
+
+	TMap<FString, FClosure> Closures;
+	bool bDirty = false;
+	int32 NumHits = 0;
+	int32 NumMisses = 0;
+
+	FDelegateHandle AssetAddedHandle;
+	FDelegateHandle AssetRemovedHandle;
+	FDelegateHandle AssetUpdatedHandle;
+	FDelegateHandle AssetRenamedHandle;
+	FDelegateHandle PackageSavedHandle;
+};
@@ -0,0 +1,126 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CPM_DependencyGraph.generated.h"
+
+class IAssetRegistry;
+
+USTRUCT(BlueprintType)
+struct FCPM_RootDependencies
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	FName RootPackage;
+
+	/** Indices into FCPM_BatchDependencyResult::Packages, the AllDependencies of GetPackageDependencies */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	TArray<int32> Dependencies;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	TArray<int32> ExcludedDependencies;
+
+	/** Dependencies that are also in the closure of another root */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int32 NumShared = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	bool bAllInsideSameRoot = false;
+};
+
+USTRUCT(BlueprintType)
+struct FCPM_BatchDependencyResult
+{
+	GENERATED_BODY()
+
+	/** Every package reached from any root, shared by all closures */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	TArray<FName> Packages;
+
+	/** For each package, in how many root closures it is a dependency */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	TArray<int32> RootCounts;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	TArray<FCPM_RootDependencies> Roots;
+
+	/** Packages in the closure of more than one root */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int32 NumSharedPackages = 0;
+};
+
+/**
+ * Dependency graph of many roots at once. The asset registry is walked once for the union of
+ * everything the roots reach, into a package table and compact adjacency lists, and each root's
+ * closure is then a traversal of that in memory graph. Shared engine and plugin content is only
+ * queried once however many roots use it, and visiting closures one at a time reuses a single
+ * scratch buffer, so memory does not grow with the number of roots.
+ * A closure holds the same packages FCPM_DependencyWalker would find for that root alone.
+ */
+class CONVAIPAKMANAGEREDITOR_API FCPM_DependencyGraph
+{
+public:
+	FCPM_DependencyGraph();
+	explicit FCPM_DependencyGraph(IAssetRegistry& InAssetRegistry);
+
+	/** Packages whose dependencies were queried while building */
+	int32 GetNumProcessed() const { return NumProcessed; }
+
+	/**
+	 * The exclude callback applies to every root, it is called once per package on the calling thread.
+	 * Expands on worker threads only once the asset registry has finished loading.
+	 */
+	void Build(const TArray<FName>& RootPackages, const TFunction<bool(FName)>& ShouldExcludeFromDependenciesSearch);
+
+	int32 GetNumPackages() const { return Packages.Num(); }
+	FName GetPackage(int32 PackageIndex) const { return Packages[PackageIndex]; }
+	const TArray<FName>& GetPackages() const { return Packages; }
+	int32 FindPackage(FName PackageName) const;
+
+	int32 GetNumRoots() const { return RootIndices.Num(); }
+	FName GetRootPackage(int32 RootNumber) const { return Packages[RootIndices[RootNumber]]; }
+
+	using FClosureVisitor = TFunctionRef<void(int32 RootNumber, const TArray<int32>& Dependencies, const TArray<int32>& ExcludedDependencies)>;
+
+	/** Calls Visitor with each root's closure as package indices, the arrays are reused between roots */
+	void ForEachClosure(FClosureVisitor Visitor) const;
+
+	/** One root's closure as bitsets over the package table */
+	void GetClosure(int32 RootNumber, TBitArray<>& OutDependencies, TBitArray<>& OutExcludedDependencies) const;
+
+	/** External objects folders of the root's world and of every world in its closure */
+	void GetExternalObjectsPaths(int32 RootNumber, const TArray<int32>& Dependencies, TSet<FString>& OutPaths) const;
+
+	/** For every package, in how many root closures it is a dependency */
+	TArray<int32> CountRootsPerPackage() const;
+
+	/** Packages in both closures */
+	static int32 CountOverlap(const TBitArray<>& A, const TBitArray<>& B);
+
+private:
+	/** Traversal of one root with caller owned scratch space */
+	void VisitClosure(int32 RootNumber, TBitArray<>& Visited, TArray<int32>& Stack, TArray<int32>& OutDependencies, TArray<int32>& OutExcluded) const;
+
+	IAssetRegistry& AssetRegistry;
+
+	TArray<FName> Packages;
+	TMap<FName, int32> PackageIndices;
+
+	/** Packages the exclude callback stops at */
+	TBitArray<> Excluded;
+	TArray<int32> RootIndices;
+
+	/** Compressed adjacency: the edges of package i are Edges[EdgeOffsets[i] .. EdgeOffsets[i + 1]) */
+	TArray<int32> EdgeOffsets;
+	TArray<int32> Edges;
+
+	/** One bit per edge, set for the edges from a world to its external objects, which are followed even into excluded packages */
+	TBitArray<> ExternalEdges;
+
+	/** External objects folders of each world package */
+	TMap<int32, TArray<FString>> WorldExternalObjectsPaths;
+
+	int32 NumProcessed = 0;
+};
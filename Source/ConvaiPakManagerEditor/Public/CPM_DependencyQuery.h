@@ -0,0 +1,92 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Kismet/BlueprintAsyncActionBase.h"
+#include "CPM_DependencyReport.h"
+#include "CPM_DependencyQuery.generated.h"
+
+USTRUCT(BlueprintType)
+struct FCPM_DependencyQueryResult
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	bool bSuccess = false;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	FName PackageName;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	TArray<FName> AllDependencies;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	TArray<FString> ExternalObjectsPaths;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	TArray<FName> ExcludedDependencies;
+
+	/** Same meaning as the return value of GetPackageDependencies */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	bool bAllInsideSameRoot = false;
+
+	/** Batched external objects scans the walk waited for */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int32 NumScans = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	double TotalSeconds = 0.0;
+
+	/** Only filled when the query was started with bWithSizes */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	FCPM_DependencySizeReport SizeReport;
+};
+
+/**
+ * GetPackageDependencies without blocking the editor. The walk runs on the thread pool and hands
+ * its batched external objects scans to the game thread, expanding the rest of the graph while a
+ * scan is in progress. Started while the asset registry is still loading, the walk waits for
+ * it to finish. Completion is delivered on the game thread.
+ */
+class CONVAIPAKMANAGEREDITOR_API FCPM_DependencyQuery
+{
+public:
+	DECLARE_DELEGATE_OneParam(FOnCompleted, const FCPM_DependencyQueryResult&);
+
+	/** bWithSizes also attributes the closure's on-disk size, see FCPM_DependencyAttribution */
+	static void Start(FName PackageName, const TArray<FString>& FilterPaths, bool bDeterministicOrder, bool bWithSizes, FOnCompleted InOnCompleted);
+
+private:
+	/** Runs the walk on the thread pool, the asset registry must be done loading */
+	static void Dispatch(FCPM_DependencyQueryResult&& Result, const TArray<FString>& FilterPaths, bool bDeterministicOrder, bool bWithSizes, FOnCompleted&& InOnCompleted);
+
+	static TFuture<void> ScanOnGameThread(const TArray<FString>& Paths, bool bForceRescan);
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FCPM_DependencyQueryDelegate, const FCPM_DependencyQueryResult&, Result);
+
+/** Runs GetPackageDependencies as an FCPM_DependencyQuery */
+UCLASS()
+class CONVAIPAKMANAGEREDITOR_API UCPM_GetPackageDependenciesProxy : public UBlueprintAsyncActionBase
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(BlueprintAssignable)
+	FCPM_DependencyQueryDelegate OnSuccess;
+
+	UPROPERTY(BlueprintAssignable)
+	FCPM_DependencyQueryDelegate OnFailure;
+
+	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = "true", DisplayName = "Convai Get Package Dependencies Async"), Category = "Convai|PakManager")
+	static UCPM_GetPackageDependenciesProxy* GetPackageDependenciesProxy(const FName& PackageName, const TArray<FString>& FilterPaths, const bool bDeterministicOrder = false, const bool bWithSizes = false);
+
+	virtual void Activate() override;
+
+private:
+	FName M_PackageName;
+	TArray<FString> M_FilterPaths;
+	bool M_bDeterministicOrder = false;
+	bool M_bWithSizes = false;
+};
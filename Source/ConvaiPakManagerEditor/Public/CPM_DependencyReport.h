@@ -0,0 +1,135 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CPM_DependencyReport.generated.h"
+
+class IAssetRegistry;
+class FCPM_DependencyWalker;
+
+USTRUCT(BlueprintType)
+struct FCPM_DependencySizeEntry
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	FName PackageName;
+
+	/** Class of the package's main asset, e.g. "Texture2D" */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	FString AssetClass;
+
+	/** Size of the package file(s) as last saved, -1 when the registry has no package data */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int64 DiskSize = 0;
+
+	/** From the queried root down to this package, each one referencing the next */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	TArray<FName> ReferencerChain;
+};
+
+USTRUCT(BlueprintType)
+struct FCPM_DependencySizeBucket
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	FString Key;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int32 NumPackages = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int64 DiskSize = 0;
+};
+
+USTRUCT(BlueprintType)
+struct FCPM_DependencySizeReport
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	FName RootPackage;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int64 TotalDiskSize = 0;
+
+	/** Packages the registry had no size for, counted in no bucket */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int32 NumWithoutPackageData = 0;
+
+	/** Every package of the closure, largest first */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	TArray<FCPM_DependencySizeEntry> Packages;
+
+	/** By mount point, e.g. "/Game/", largest first */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	TArray<FCPM_DependencySizeBucket> ByRoot;
+
+	/** By the package's folder, largest first */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	TArray<FCPM_DependencySizeBucket> ByFolder;
+
+	/** Largest first */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	TArray<FCPM_DependencySizeBucket> ByAssetClass;
+};
+
+USTRUCT(BlueprintType)
+struct FCPM_MountRootViolation
+{
+	GENERATED_BODY()
+
+	/** Dependency outside the root package's mount point */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	FName PackageName;
+
+	/** From the checked root down to the offending package, each one referencing the next */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	TArray<FName> ReferencerChain;
+};
+
+USTRUCT(BlueprintType)
+struct FCPM_MountRootCheckResult
+{
+	GENERATED_BODY()
+
+	/** No violation and the whole closure was checked */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	bool bPassed = false;
+
+	/** False when the check stopped at the violation limit or the time limit before seeing every dependency */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	bool bComplete = false;
+
+	/** e.g. "/ConvaiPluginContent/" */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	FString MountRoot;
+
+	/** In the order they were found, closest to the root first */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	TArray<FCPM_MountRootViolation> Violations;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int32 NumProcessed = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	double TotalSeconds = 0.0;
+};
+
+/**
+ * Attributes the on-disk size of a dependency closure to packages, mount points, folders and
+ * asset classes from the asset registry's package data, without loading anything. Safe to call
+ * off the game thread.
+ */
+class CONVAIPAKMANAGEREDITOR_API FCPM_DependencyAttribution
+{
+public:
+	/** Walker is optional, when it recorded referencers every entry gets its referencer chain */
+	static void Build(IAssetRegistry& AssetRegistry, FName RootPackage, const TSet<FName>& Packages, const FCPM_DependencyWalker* Walker,
+		FCPM_DependencySizeReport& OutReport);
+
+	/** Class name of the package's main asset, the one named like the package when there are several */
+	static FString GetPackageAssetClass(IAssetRegistry& AssetRegistry, FName PackageName);
+};
@@ -0,0 +1,183 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+
+class IAssetRegistry;
+struct FAssetData;
+
+/**
+ * Breadth first walk over package dependencies with an explicit worklist, so depth is no longer
+ * bounded by the stack. Produces the same sets as the recursive walk it replaces: dependencies that
+ * exist and are not /Script packages, minus the ones the exclude callback stops at, plus the
+ * packages of external objects (one file per actor) of every world that is reached.
+ * The asset registry is looked up once and lookup buffers are reused for every package.
+ *
+ * Once the registry has finished loading, the walk can expand one BFS level at a time across worker
+ * threads: registry reads are thread safe, a sharded visited set hands every package to exactly one
+ * worker, and external objects folders are only scanned between levels.
+ *
+ * External objects folders are not scanned one world at a time. New folders are collected while
+ * the walk goes on, and scanned in one batch once there is nothing else to expand, or as soon as
+ * they are found when the scan runs elsewhere (see FSettings::ScanPaths). The scan is only forced
+ * while the registry has not finished its initial scan.
+ */
+class CONVAIPAKMANAGEREDITOR_API FCPM_DependencyWalker
+{
+public:
+	struct FSettings
+	{
+		/** Expand each level in parallel, ignored while the asset registry is still loading */
+		bool bParallel = true;
+
+		/**
+		 * Adds the packages found on each level sorted by name, so the output sets iterate in the same
+		 * order on every run and reports can be diffed. Costs one sort per level.
+		 */
+		bool bDeterministicOrder = false;
+
+		/** Levels smaller than this are expanded on the calling thread */
+		int32 MinParallelFrontier = 32;
+
+		/** Rescan external objects folders even when the registry is up to date */
+		bool bForceRescan = false;
+
+		/** Remember which package pulled in each dependency, for GetReferencerChain */
+		bool bRecordReferencers = false;
+
+		/** Remember the dependencies skipped because they are not on disk, for GetMissingDependencies */
+		bool bRecordMissing = false;
+
+		/** Called on the walking thread for every package added to AllDependencies, returning true ends the walk there */
+		TFunction<bool(FName)> StopAt;
+
+		/** Ends the walk once it has run this long, 0 for no limit. Checked between packages. */
+		double TimeLimitSeconds = 0.0;
+
+		/**
+		 * Scans a batch of external objects folders. Unset, the walk scans synchronously on its own thread.
+		 * A walk on a worker thread hands the scan to the game thread here and keeps expanding the rest
+		 * of the graph until it runs out of work and has to wait for the result.
+		 */
+		TFunction<TFuture<void>(const TArray<FString>& Paths, bool bForceRescan)> ScanPaths;
+	};
+
+	FCPM_DependencyWalker();
+	explicit FCPM_DependencyWalker(IAssetRegistry& InAssetRegistry);
+	FCPM_DependencyWalker(IAssetRegistry& InAssetRegistry, const FSettings& InSettings);
+
+	/**
+	 * Root itself is only added to AllDependencies if something it depends on refers back to it.
+	 * The exclude callback is called from worker threads when the walk runs in parallel.
+	 */
+	void Walk(FName RootPackage, TSet<FName>& AllDependencies, TSet<FString>& ExternalObjectsPaths, TSet<FName>& ExcludedDependencies,
+		const TFunction<bool(FName)>& ShouldExcludeFromDependenciesSearch);
+
+	/** Packages whose dependencies were queried during the last walk */
+	int32 GetNumProcessed() const { return NumProcessed; }
+
+	/** BFS levels of the last parallel walk, the serial walk does not track levels */
+	int32 GetNumLevels() const { return NumLevels; }
+
+	/** Whether the last walk expanded levels on worker threads */
+	bool WasParallel() const { return bWasParallel; }
+
+	/** Batched external objects scans of the last walk */
+	int32 GetNumScans() const { return NumScans; }
+
+	/** Referenced packages the last walk skipped because they are not on disk, needs bRecordMissing */
+	const TSet<FName>& GetMissingDependencies() const { return Missing; }
+
+	/** Whether StopAt or the time limit ended the last walk before the closure was complete */
+	bool WasStopped() const { return bStopped; }
+
+	/**
+	 * Packages from the root down to Package, each one referencing the next, needs bRecordReferencers.
+	 * External objects are referenced by the world that owns them. The chain is one of the shortest.
+	 */
+	bool GetReferencerChain(FName PackageName, TArray<FName>& OutChain) const;
+
+	/** "/Script..." prefix check on the name's characters without building an FString */
+	static bool IsScriptPackage(FName PackageName);
+
+	/** Prefix check on the name's characters without building an FString */
+	static bool NameStartsWith(FName Name, FStringView Prefix);
+
+	/** Exclude callback that stops the walk at packages under any of the given paths */
+	static TFunction<bool(FName)> MakeFilterPathsExclude(const TArray<FString>& FilterPaths);
+
+	/** Whether every package sits under the root package's mount point, e.g. "/ConvaiPluginContent/" */
+	static bool AreUnderSameMountPoint(FName RootPackage, const TSet<FName>& Packages);
+
+	/** Whether the package holds a world saved on disk, uses OutAssets as scratch space so callers can reuse a buffer */
+	static bool IsWorldPackage(IAssetRegistry& AssetRegistry, FName PackageName, TArray<FAssetData>& OutAssets);
+
+private:
+	/** Visited set split into independently locked shards, picked by name hash */
+	class FShardedNameSet
+	{
+	public:
+		/** Returns true for the one caller that adds the name */
+		bool TryAdd(FName Name);
+
+		void Reset();
+
+	private:
+		static constexpr int32 NumShards = 64;
+
+		struct FShard
+		{
+			FCriticalSection Mutex;
+			TSet<FName> Names;
+		};
+		FShard Shards[NumShards];
+	};
+
+	/** Drains the worklist, including everything it adds to it */
+	void ExpandSerial(TSet<FName>& AllDependencies, TSet<FString>& ExternalObjectsPaths, TSet<FName>& ExcludedDependencies,
+		const TFunction<bool(FName)>& ShouldExcludeFromDependenciesSearch);
+
+	/** Expands the worklist as one level in parallel, leaving the next level in the worklist */
+	void ExpandLevel(TSet<FName>& AllDependencies, TSet<FString>& ExternalObjectsPaths, TSet<FName>& ExcludedDependencies,
+		const TFunction<bool(FName)>& ShouldExcludeFromDependenciesSearch);
+
+	/** Queues the external objects folders of a world package that were not seen yet for the next scan */
+	void CollectExternalObjectsPaths(FName PackageName, TSet<FString>& ExternalObjectsPaths);
+
+	void StartScan();
+
+	/** Waits for the scan in flight and adds the external objects it found */
+	void FinishScan(TSet<FName>& AllDependencies);
+	void Enqueue(FName PackageName);
+	void RecordReferencer(FName PackageName, FName Referencer);
+
+	/** Adds a dependency that is not excluded, false when the walk has to stop */
+	bool AddDependency(FName PackageName, TSet<FName>& AllDependencies);
+	bool IsPastDeadline() const;
+
+	IAssetRegistry& AssetRegistry;
+	FSettings Settings;
+	TArray<FName> Worklist;
+	TSet<FName> Processed;
+	TArray<FName> DependencyBuffer;
+	TArray<FAssetData> AssetBuffer;
+	FShardedNameSet Seen;
+	FName Root;
+	TMap<FName, FName> Referencers;
+	TSet<FName> Missing;
+	TMap<FString, FName> ExternalPathOwners;
+
+	TArray<FString> PendingPaths;
+	TArray<FString> ScanningPaths;
+	TFuture<void> ScanFuture;
+	bool bForceScan = false;
+
+	int32 NumProcessed = 0;
+	int32 NumLevels = 0;
+	int32 NumScans = 0;
+	bool bWasParallel = false;
+	bool bStopped = false;
+	double Deadline = 0.0;
+};
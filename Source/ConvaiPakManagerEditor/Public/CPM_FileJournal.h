@@ -0,0 +1,130 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+#include "Utility/CPM_FileWalker.h"
+#include <atomic>
+
+struct FFileChangeData;
+class FQueuedThreadPool;
+
+enum class ECPM_FileChange : uint8
+{
+	Added,
+	Modified,
+	Removed,
+};
+
+struct FCPM_FileRecord
+{
+	/** Relative to the project directory, forward slashes */
+	FString Path;
+	int64 Size = 0;
+	FDateTime Timestamp;
+
+	/** Lower case hex SHA1 of the content */
+	FString Hash;
+
+	/** Sequence number of the last change to this file */
+	uint64 Sequence = 0;
+};
+
+struct FCPM_FileChangeEntry
+{
+	uint64 Sequence = 0;
+	FString Path;
+	ECPM_FileChange Change = ECPM_FileChange::Modified;
+};
+
+/**
+ * Persistent index of the files the project zip contains (GetProjectDirectoriesToZip,
+ * GetProjectFilesToZip and .convaiignore), with size, timestamp and content hash.
+ * Every content change gets the next sequence number in an append only change log, so asking
+ * what changed since a named snapshot only touches the log entries after it. The index is kept
+ * current by the directory watcher, and on startup by comparing size and timestamp of every
+ * file, hashing only the ones that differ on a thread of the lowest priority. Stored in <Cache>/FileJournal/Journal.json, at most
+ * every SaveIntervalSeconds while changes come in, and right away for snapshots and on Stop.
+ */
+class CONVAIPAKMANAGEREDITOR_API FCPM_FileJournal
+{
+public:
+	static FCPM_FileJournal& Get();
+
+	/** Loads the journal, reconciles it in the background and starts watching the project */
+	void Start();
+
+	/** Stops watching, waits for pending work and saves */
+	void Stop();
+
+	/** Waits until reconciliation and queued watcher changes are processed */
+	void Flush();
+
+	/** Started and done comparing the journal with the disk, changes from then on come from the watcher */
+	bool IsReconciled() const;
+
+	uint64 GetCurrentSequence() const;
+
+	/** Remembers the current sequence under Name (e.g. "LastPublish") and returns it */
+	uint64 MarkSnapshot(const FString& Name);
+	bool GetSnapshotSequence(const FString& Name, uint64& OutSequence) const;
+
+	/** The latest change of every file changed after Sequence, ordered by sequence */
+	TArray<FCPM_FileChangeEntry> GetChangesSince(uint64 Sequence) const;
+
+	/** Fails when no snapshot of that name exists, callers should then treat every file as changed */
+	bool GetChangesSinceSnapshot(const FString& Name, TArray<FCPM_FileChangeEntry>& OutChanges) const;
+
+	bool FindRecord(const FString& RelativePath, FCPM_FileRecord& OutRecord) const;
+
+	static FString GetJournalPath();
+
+private:
+	FCPM_FileJournal() = default;
+
+	void Reconcile();
+	void OnDirectoryChanged(const TArray<FFileChangeData>& FileChanges);
+	void ProcessPendingPaths();
+
+	/** Re-stats and if needed re-hashes one file, appends to the log when its content changed */
+	void RefreshFile(const FString& RelativePath);
+	void RemoveRecordsLocked(const FString& RelativePath);
+	void AppendChangeLocked(const FString& RelativePath, ECPM_FileChange Change);
+	void CompactLogLocked();
+
+	bool IsTracked(const FString& RelativePath, bool bIsDirectory) const;
+	FString ToRelativePath(const FString& FullPath) const;
+	FString ToFullPath(const FString& RelativePath) const;
+
+	void Load();
+	void Save() const;
+
+	/** Save, unless the last one was less than SaveIntervalSeconds ago */
+	void SaveIfDue() const;
+
+	static constexpr double SaveIntervalSeconds = 30.0;
+
+	mutable FCriticalSection Mutex;
+	mutable FCriticalSection SaveMutex;
+	TMap<FString, FCPM_FileRecord> Records;
+	TArray<FCPM_FileChangeEntry> ChangeLog;
+	TMap<FString, uint64> Snapshots;
+	uint64 Sequence = 0;
+	mutable bool bDirty = false;
+	mutable double LastSaveTime = 0.0;
+
+	FString ProjectDir;
+	TArray<FString> TrackedDirectories;
+	TSet<FString> TrackedFiles;
+	FCPM_IgnoreRules IgnoreRules;
+
+	TArray<TPair<FString, FDelegateHandle>> WatcherHandles;
+	TSet<FString> PendingPaths;
+	bool bProcessing = false;
+	FQueuedThreadPool* ReconcilePool = nullptr;
+	TFuture<void> ReconcileFuture;
+	std::atomic<bool> bStopRequested { false };
+	TFuture<void> ProcessFuture;
+	bool bStarted = false;
+};
@@ -0,0 +1,121 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DeveloperSettings.h"
+#include "Utility/CPM_Utils.h"
+#include "CPM_PackagingCache.generated.h"
+
+class FJsonObject;
+
+UCLASS(Config = Game, DefaultConfig, meta = (DisplayName = "Convai Packaging"))
+class CONVAIPAKMANAGEREDITOR_API UCPM_PackagingSettings : public UDeveloperSettings
+{
+	GENERATED_BODY()
+
+public:
+	virtual FName GetCategoryName() const override { return TEXT("Plugins"); }
+
+	/**
+	 * Split the cook over several processes, sized by the budgets below. Off by default, multiprocess
+	 * cooking is still experimental in the engine and some projects' assets do not cook correctly with it.
+	 */
+	UPROPERTY(Config, EditAnywhere, Category = "Cook")
+	bool bMultiprocessCook = false;
+
+	/** Share of the logical cores the cooker may use */
+	UPROPERTY(Config, EditAnywhere, Category = "Cook", meta = (ClampMin = "1", ClampMax = "100"))
+	float CpuBudgetPercent = 75.f;
+
+	UPROPERTY(Config, EditAnywhere, Category = "Cook", meta = (ClampMin = "1"))
+	int32 CoresPerCookProcess = 4;
+
+	/** Memory the cooker may use, 0 uses three quarters of the physical memory available when packaging starts */
+	UPROPERTY(Config, EditAnywhere, Category = "Cook", meta = (ClampMin = "0"))
+	float MemoryBudgetGB = 0.f;
+
+	/** Per cook process and target platform, a process cooking two platforms keeps both in memory */
+	UPROPERTY(Config, EditAnywhere, Category = "Cook", meta = (ClampMin = "1"))
+	float MemoryPerCookProcessGB = 6.f;
+
+	/** Upper limit whatever the budgets allow, 0 for none */
+	UPROPERTY(Config, EditAnywhere, Category = "Cook", meta = (ClampMin = "0"))
+	int32 MaxCookProcesses = 0;
+
+	/** DDC graph passed to the cook with -ddc, e.g. a shared network DDC. Empty keeps the project default. */
+	UPROPERTY(Config, EditAnywhere, Category = "Cook")
+	FString SharedDDC;
+
+	/** Keep a journal of the project files from editor startup on, needed by CPM_MarkProjectSnapshot and CPM_GetProjectChangesSince */
+	UPROPERTY(Config, EditAnywhere, Category = "File Journal")
+	bool bEnableFileJournal = true;
+
+	/** Cook processes the budgets allow for one cook of NumPlatforms target platforms, at least 1 */
+	int32 GetNumCookProcesses(int32 NumPlatforms) const;
+};
+
+USTRUCT(BlueprintType)
+struct FCPM_CookReport
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	ECPM_Platform Platform = ECPM_Platform::None;
+
+	/** The cook reused the output of previous runs */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	bool bIterative = false;
+
+	/** Turnkey VerifySdk was skipped because this platform and engine version were already verified */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	bool bSdkVerificationSkipped = false;
+
+	/** Packages written by this run */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int32 NumRecookedPackages = 0;
+
+	/** Packages in the cook output, recooked or not */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int32 NumCookedPackages = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	FString CookOutputDirectory;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	FDateTime FinishedAt;
+};
+
+/**
+ * State kept between packaging runs under <Cache>/Packaging: which platforms passed Turnkey's
+ * VerifySdk with which engine and SDK version, the persistent cook output iterative cooks
+ * build on, and the cook report of the last run per platform. Game thread only, except for
+ * CountCookedPackages which only reads the cook output.
+ */
+class CONVAIPAKMANAGEREDITOR_API FCPM_PackagingCache
+{
+public:
+	static FString GetDirectory();
+
+	/** Root of the per platform cooked folders, handed to UAT as -CookOutputDir */
+	static FString GetCookOutputDirectory();
+
+	/** Cooked platform folder name, e.g. "Windows" for Win64, empty for platforms that are not cooked */
+	static FString GetCookPlatformName(ECPM_Platform Platform);
+
+	/** True when UatPlatform passed VerifySdk with the current engine version and installed SDK */
+	static bool IsSdkVerified(const FString& UatPlatform);
+	static void MarkSdkVerified(const FString& UatPlatform);
+
+	/** Counts the cooked packages of the platform and those written at or after Since */
+	static void CountCookedPackages(ECPM_Platform Platform, const FDateTime& Since, FCPM_CookReport& InOutReport);
+
+	static void SaveCookReport(const FCPM_CookReport& Report);
+	static bool LoadCookReport(ECPM_Platform Platform, FCPM_CookReport& OutReport);
+
+private:
+	/** As reported by Turnkey, empty while it is still querying or has no SDK for the platform */
+	static FString GetInstalledSdkVersion(const FString& UatPlatform);
+
+	static TSharedPtr<FJsonObject> LoadSdkVerifications();
+};
@@ -0,0 +1,124 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DeveloperSettings.h"
+#include "Pak/CPM_PakInventory.h"
+#include "Utility/CPM_Utils.h"
+#include "CPM_PakBudget.generated.h"
+
+/** Size limits for one asset type, 0 disables a limit */
+USTRUCT(BlueprintType)
+struct FCPM_PakBudget
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Convai|PakManager", meta = (ClampMin = "0"))
+	int64 MaxTotalBytes = 0;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Convai|PakManager", meta = (ClampMin = "0"))
+	int64 MaxEntryBytes = 0;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Convai|PakManager", meta = (ClampMin = "0"))
+	int64 MaxTextureBytes = 0;
+};
+
+UCLASS(Config = Game, DefaultConfig, meta = (DisplayName = "Convai Pak Budgets"))
+class CONVAIPAKMANAGEREDITOR_API UCPM_PakBudgetSettings : public UDeveloperSettings
+{
+	GENERATED_BODY()
+
+public:
+	UCPM_PakBudgetSettings();
+
+	virtual FName GetCategoryName() const override { return TEXT("Plugins"); }
+
+	UPROPERTY(Config, EditAnywhere, Category = "Budgets")
+	bool bEnforceBudgets = true;
+
+	UPROPERTY(Config, EditAnywhere, Category = "Budgets")
+	TMap<ECPM_AssetType, FCPM_PakBudget> Budgets;
+
+	/** Growth against the previous build of the same asset that gets flagged as a regression */
+	UPROPERTY(Config, EditAnywhere, Category = "History", meta = (ClampMin = "0"))
+	float RegressionThresholdPercent = 10.f;
+
+	/** Fail the gate on regressions instead of only reporting them */
+	UPROPERTY(Config, EditAnywhere, Category = "History")
+	bool bFailOnRegression = false;
+
+	/** Number of builds kept per asset id */
+	UPROPERTY(Config, EditAnywhere, Category = "History", meta = (ClampMin = "1"))
+	int32 MaxHistoryEntries = 50;
+};
+
+USTRUCT(BlueprintType)
+struct FCPM_PakBudgetReport
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	bool bPassed = false;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	FString PakFilePath;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	FString AssetID;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	ECPM_AssetType AssetType = ECPM_AssetType::Max;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	FCPM_PakBudget Budget;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int64 TotalBytes = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int64 TextureBytes = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	FCPM_PakInventoryEntry LargestEntry;
+
+	/** Size of the previous build of the same asset id, 0 when there is none */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int64 PreviousTotalBytes = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	TArray<FString> Violations;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	TArray<FString> Warnings;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	TArray<FCPM_PakInventoryEntry> TopEntries;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	TArray<FCPM_PakSizeBucket> TopFolders;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	TArray<FCPM_PakSizeBucket> TopAssetClasses;
+
+	/** Where the json copy of this report was written */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	FString ReportFilePath;
+};
+
+/**
+ * Checks a freshly built pak against the budgets of its asset type, using the pak index only.
+ * Every evaluation is appended to a per asset id size history under the cache directory.
+ */
+class CONVAIPAKMANAGEREDITOR_API FCPM_PakBudgetGate
+{
+public:
+	static bool Evaluate(const FString& PakFilePath, ECPM_AssetType AssetType, const FString& AssetID, FCPM_PakBudgetReport& OutReport);
+
+	static FString GetHistoryDirectory();
+	static FString GetReportDirectory();
+
+private:
+	static int64 LoadPreviousTotalBytes(const FString& AssetID);
+	static void AppendHistory(const FCPM_PakBudgetReport& Report, int32 MaxEntries);
+};
@@ -0,0 +1,136 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CPM_ZipWriter.h"
+
+class FQueuedThreadPool;
+
+/**
+ * Builds a zip with entries compressed in parallel. Files are split into fixed size chunks that
+ * are compressed independently on the thread pool (deflate with full flushes, or one zstd frame
+ * per chunk), while the calling thread appends the results in order through FCPM_ZipWriter.
+ * At most MaxChunksInFlight chunks exist at once, so memory stays bounded for any file size.
+ */
+class CONVAIPAKMANAGEREDITOR_API FCPM_ZipBuilder
+{
+public:
+	struct FSettings
+	{
+		/** Zstd is only available when the module is built with CPM_WITH_ZSTD, deflate is used otherwise */
+		FCPM_ZipWriter::ECompressionMethod Method = FCPM_ZipWriter::ECompressionMethod::Deflate;
+		int32 Level = 6;
+		int32 ChunkSize = 4 * 1024 * 1024;
+
+		/** 0 picks twice the number of worker threads */
+		int32 MaxChunksInFlight = 0;
+
+		/**
+		 * Keeps a manifest next to the zip and copies the compressed data of files whose size and
+		 * timestamp did not change straight from the previous archive instead of recompressing them
+		 */
+		bool bIncremental = false;
+
+		/** Extensions (without dot) of formats that are already compressed and are stored as is */
+		TSet<FString> StoredExtensions = { TEXT("pak"), TEXT("utoc"), TEXT("ucas"), TEXT("png"), TEXT("jpg"), TEXT("jpeg"),
+			TEXT("zip"), TEXT("7z"), TEXT("gz"), TEXT("ubulk"), TEXT("uptnl"), TEXT("mp4"), TEXT("mp3"), TEXT("ogg"), TEXT("bk2") };
+
+		/** Pool the chunks are compressed on, the global thread pool when null */
+		FQueuedThreadPool* ThreadPool = nullptr;
+
+		/** Polled between chunks, returning true stops the build and removes the partial archive */
+		TFunction<bool()> ShouldCancel;
+
+		/** Called on the writing thread with the uncompressed bytes and files written so far */
+		TFunction<void(int64 BytesProcessed, int32 FilesProcessed)> OnProgress;
+	};
+
+	struct FStats
+	{
+		int32 NumReused = 0;
+		int32 NumCompressed = 0;
+		int64 BytesProcessed = 0;
+		int32 FilesProcessed = 0;
+		double WriteSeconds = 0.0;
+		double FinalizeSeconds = 0.0;
+		bool bCancelled = false;
+	};
+
+	FCPM_ZipBuilder() = default;
+	explicit FCPM_ZipBuilder(const FSettings& InSettings) : Settings(InSettings) {}
+
+	void AddFile(const FString& ArchivePath, const FString& SourceFilePath);
+
+	/** Same as above for callers that already have the file's size and timestamp */
+	void AddFile(const FString& ArchivePath, const FString& SourceFilePath, int64 Size, const FDateTime& Timestamp);
+
+	/** Walks the given project directories and files, adding everything that is not ignored with a path relative to the project */
+	void AddProjectFiles(const TArray<FString>& InFiles, const TArray<FString>& InDirectories);
+
+	int32 GetNumFiles() const { return Files.Num(); }
+	int64 GetTotalBytes() const;
+
+	/** Compresses and writes every added file, blocking until the archive is complete */
+	bool Write(const FString& ZipFilePath);
+
+	/** Writes the archive to a sink that is only appended to, such as an upload stream. Takes ownership of the sink. */
+	bool WriteToStream(IFileHandle* Sink);
+
+	/** Exact size WriteToStream produces, -1 when an entry is compressed and its size is not known in advance */
+	int64 GetStreamedSize() const;
+
+	FCPM_ZipWriter::ECompressionMethod GetMethodForFile(const FString& SourceFilePath) const;
+
+	static FString GetManifestPath(const FString& ZipFilePath);
+
+	/** Statistics of the last Write */
+	const FStats& GetStats() const { return Stats; }
+
+protected:
+	struct FFileToZip
+	{
+		FString ArchivePath;
+		FString SourceFilePath;
+		int64 Size = 0;
+		FDateTime Timestamp;
+	};
+
+	/** What the manifest remembers about an entry of the previous archive */
+	struct FManifestEntry
+	{
+		int64 Size = 0;
+		FDateTime Timestamp;
+		FCPM_ZipWriter::ECompressionMethod Method = FCPM_ZipWriter::ECompressionMethod::Store;
+		uint32 Crc = 0;
+		uint64 CompressedSize = 0;
+		uint64 DataOffset = 0;
+	};
+
+	struct FChunkResult
+	{
+		TArray<uint8> Data;
+		uint32 Crc = 0;
+		int64 UncompressedSize = 0;
+		bool bSuccess = false;
+	};
+
+	/** Reads and compresses one chunk, runs on the thread pool */
+	static FChunkResult CompressChunk(const FString& SourceFilePath, int64 Offset, int64 Size, bool bLastChunk, FCPM_ZipWriter::ECompressionMethod Method, int32 Level);
+
+	/** Streams a list of files into an open writer */
+	bool WriteFiles(FCPM_ZipWriter& Writer, const TArray<FFileToZip>& FilesToWrite);
+
+	/** Copies an entry's compressed bytes from the previous archive without touching the source file */
+	bool CopyEntry(FCPM_ZipWriter& Writer, IFileHandle& PreviousZip, const FFileToZip& File, const FManifestEntry& Previous);
+
+	bool IsCancelled();
+	void ReportProgress(int64 Bytes, int32 NumFilesDone);
+
+	static bool LoadManifest(const FString& ManifestPath, TMap<FString, FManifestEntry>& OutEntries);
+	bool SaveManifest(const FString& ManifestPath, const FCPM_ZipWriter& Writer) const;
+
+	FSettings Settings;
+	TArray<FFileToZip> Files;
+	FStats Stats;
+};
@@ -0,0 +1,213 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Kismet/BlueprintAsyncActionBase.h"
+#include <atomic>
+#include "Utility/CPM_RingBuffer.h"
+#include "CPM_ZipJob.generated.h"
+
+class FCPM_ZipBuilder;
+
+USTRUCT(BlueprintType)
+struct FCPM_ZipProgress
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int32 FilesProcessed = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int32 TotalFiles = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int64 BytesProcessed = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int64 TotalBytes = 0;
+
+	/** Archive bytes handed to the upload request when streaming to an upload url */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int64 BytesUploaded = 0;
+
+	/** 0 to 1, by uncompressed bytes */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	float Progress = 0.f;
+};
+
+USTRUCT(BlueprintType)
+struct FCPM_ZipJobResult
+{
+	GENERATED_BODY()
+
+	/** "Success", "Failed" or "Cancelled" */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	FString Result;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	bool bSuccess = false;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	bool bCancelled = false;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	FString ZipFilePath;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int32 NumFiles = 0;
+
+	/** Entries copied from the previous archive in incremental mode */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int32 NumReused = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int64 TotalBytes = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int64 ZipFileSize = 0;
+
+	/** Time spent waiting for a free slot in the zip pool */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	double QueuedSeconds = 0.0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	double WalkSeconds = 0.0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	double WriteSeconds = 0.0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	double FinalizeSeconds = 0.0;
+
+	/** Until the upload request completed, from the start of writing when streamed (overlapping WriteSeconds) or after it */
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	double UploadSeconds = 0.0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	int32 ResponseCode = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Convai|PakManager")
+	double TotalSeconds = 0.0;
+};
+
+/**
+ * Zips project files on a small dedicated pool of low priority threads, so no more than a couple
+ * of zip jobs compete with the editor at once, while their chunks are compressed on the background
+ * priority pool. Progress is throttled and, like completion, delivered on the game thread.
+ */
+class CONVAIPAKMANAGEREDITOR_API FCPM_ZipJob : public TSharedFromThis<FCPM_ZipJob>
+{
+public:
+	struct FParams
+	{
+		FString ZipFilePath;
+		TArray<FString> Files;
+		TArray<FString> Directories;
+		bool bIncremental = false;
+
+		/** When set, the archive is uploaded with a PUT to this url once written, to ZipFilePath or a temporary file when empty */
+		FString UploadURL;
+
+		/**
+		 * Streams the archive straight into the upload instead, nothing is written to disk. A single request
+		 * needs its length up front, so the entries are stored rather than compressed and the upload is larger.
+		 */
+		bool bStreamStored = false;
+
+		/**
+		 * UploadURL starts a resumable upload session (a POST with x-goog-resumable: start, e.g. a url signed
+		 * for it). The deflated archive is then sent in UploadChunkSize chunks while it is being written, so
+		 * compression and upload overlap without the archive going to disk or its length being known.
+		 */
+		bool bResumableUpload = false;
+
+		/** How far the zip writer may get ahead of the upload */
+		int64 UploadBufferSize = 64 * 1024 * 1024;
+
+		/** Size of one resumable upload request, rounded up to a multiple of 256 KiB */
+		int64 UploadChunkSize = 8 * 1024 * 1024;
+
+		/** Minimum time between two progress updates */
+		float ProgressInterval = 0.1f;
+	};
+
+	DECLARE_DELEGATE_OneParam(FOnProgress, const FCPM_ZipProgress&);
+	DECLARE_DELEGATE_OneParam(FOnCompleted, const FCPM_ZipJobResult&);
+
+	static TSharedRef<FCPM_ZipJob> Start(const FParams& InParams, FOnProgress InOnProgress, FOnCompleted InOnCompleted);
+
+	/** Stops the job at the next chunk boundary, the partial archive is removed and a previous one restored */
+	void Cancel();
+	bool IsCancelRequested() const { return bCancelRequested; }
+
+	/** Called on module shutdown, cancels running jobs, waits for them to stop and drops queued ones */
+	static void ShutdownPool();
+
+private:
+	FCPM_ZipJob(const FParams& InParams, FOnProgress InOnProgress, FOnCompleted InOnCompleted);
+
+	void Run();
+	bool RunUpload(FCPM_ZipBuilder& ZipBuilder, FCPM_ZipJobResult& Result);
+	bool RunResumableUpload(FCPM_ZipBuilder& ZipBuilder, FCPM_ZipJobResult& Result);
+	bool StartUploadSession(FString& OutSessionURL, FCPM_ZipJobResult& Result);
+
+	/** Sends what the zip writer puts into RingBuffer as resumable upload chunks, runs next to the writer */
+	bool UploadChunks(const FString& SessionURL, const TSharedRef<FCPM_RingBuffer, ESPMode::ThreadSafe>& RingBuffer, int64& OutUploadedSize, int32& OutResponseCode);
+	bool UploadFile(const FString& ZipFilePath, FCPM_ZipJobResult& Result);
+	void PostProgress(const FCPM_ZipProgress& InProgress);
+	void Complete(const FCPM_ZipJobResult& Result);
+
+	static FQueuedThreadPool* GetPool();
+
+	FParams Params;
+	FOnProgress OnProgress;
+	FOnCompleted OnCompleted;
+	double StartTime = 0.0;
+	double LastProgressTime = 0.0;
+	std::atomic<bool> bCancelRequested { false };
+	FCriticalSection UploadBufferMutex;
+	TSharedPtr<FCPM_RingBuffer, ESPMode::ThreadSafe> UploadBuffer;
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FCPM_ZipProgressDelegate, const FCPM_ZipProgress&, Progress);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FCPM_ZipResultDelegate, const FCPM_ZipJobResult&, Result);
+
+/** Runs CPM_CreateZip as an FCPM_ZipJob with progress and cancellation */
+UCLASS()
+class CONVAIPAKMANAGEREDITOR_API UCPM_CreateZipProxy : public UBlueprintAsyncActionBase
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(BlueprintAssignable)
+	FCPM_ZipProgressDelegate OnProgress;
+
+	UPROPERTY(BlueprintAssignable)
+	FCPM_ZipResultDelegate OnSuccess;
+
+	UPROPERTY(BlueprintAssignable)
+	FCPM_ZipResultDelegate OnFailure;
+
+	UPROPERTY(BlueprintAssignable)
+	FCPM_ZipResultDelegate OnCancelled;
+
+	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = "true", DisplayName = "Convai Create Zip"), Category = "Convai|PakManager")
+	static UCPM_CreateZipProxy* CreateZipProxy(const FString& ZipFilePath, const TArray<FString>& Files, const TArray<FString>& Directories, const bool bIncremental, UCPM_CreateZipProxy*& OutProxy);
+
+	/**
+	 * Zips to a temporary file and uploads it with a PUT. bResumableUpload (UploadURL starts a resumable session)
+	 * compresses and uploads in one pass, bStreamStored does so with a single PUT but without compression.
+	 */
+	UFUNCTION(BlueprintCallable, meta = (BlueprintInternalUseOnly = "true", DisplayName = "Convai Zip And Upload"), Category = "Convai|PakManager")
+	static UCPM_CreateZipProxy* ZipAndUploadProxy(const FString& UploadURL, const TArray<FString>& Files, const TArray<FString>& Directories, const bool bStreamStored, const bool bResumableUpload, UCPM_CreateZipProxy*& OutProxy);
+
+	UFUNCTION(BlueprintCallable, Category = "Convai|PakManager")
+	void CancelZip();
+
+	virtual void Activate() override;
+
+private:
+	FCPM_ZipJob::FParams M_Params;
+	TSharedPtr<FCPM_ZipJob> M_Job;
+};
@@ -0,0 +1,84 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/PlatformFileManager.h"
+
+/**
+ * Zip writer that never holds a whole file in memory. Entries are streamed through a fixed
+ * size buffer with an incremental CRC32, the local header is patched by seeking back once the
+ * entry is complete, or followed by a data descriptor when the output cannot seek.
+ * Zip64 records are written for entries, offsets and archives past 4 GB.
+ */
+class CONVAIPAKMANAGEREDITOR_API FCPM_ZipWriter
+{
+public:
+	enum class ECompressionMethod : uint16
+	{
+		Store = 0,
+		Deflate = 8,
+		Zstd = 93,
+	};
+
+	struct FEntry
+	{
+		FString Path;
+		ECompressionMethod Method = ECompressionMethod::Store;
+		uint32 Crc = 0;
+		uint64 CompressedSize = 0;
+		uint64 UncompressedSize = 0;
+		uint64 LocalHeaderOffset = 0;
+
+		/** Where the entry's (compressed) data starts, right after the local header */
+		uint64 DataOffset = 0;
+		uint32 DosTime = 0;
+		bool bZip64 = false;
+	};
+
+	/** What the size of a streamed archive depends on */
+	struct FStreamedEntry
+	{
+		FString Path;
+		uint64 Size = 0;
+		bool bZip64 = false;
+	};
+
+	/** Takes ownership of the handle. A handle that is not seekable is only ever appended to. */
+	explicit FCPM_ZipWriter(IFileHandle* InFile, int32 InBufferSize = 1024 * 1024, bool bInSeekable = true);
+	~FCPM_ZipWriter();
+
+	/** Streams a file from disk into the archive without compressing it */
+	bool AddFile(const FString& ArchivePath, const FString& SourceFilePath, const FDateTime& Timestamp);
+
+	/** Low level entry api: BeginEntry, any number of WriteEntryData calls, EndEntry */
+	bool BeginEntry(const FString& ArchivePath, ECompressionMethod Method, const FDateTime& Timestamp, bool bMayNeedZip64);
+	bool WriteEntryData(const void* Data, int64 Size);
+	bool EndEntry(uint32 Crc, uint64 UncompressedSize);
+
+	/** Writes the central directory and closes the file */
+	bool Finalize();
+
+	bool HasError() const { return bError; }
+	const TArray<FEntry>& GetEntries() const { return Entries; }
+
+	static uint32 ToDosTime(const FDateTime& Timestamp);
+
+	/** Exact size of a non seekable archive of stored entries, in the given order */
+	static uint64 ComputeStreamedStoredSize(const TArray<FStreamedEntry>& InEntries);
+
+	/** Cleans up a path the way every entry name in the archive is stored: forward slashes, no leading slash */
+	static FString NormalizeArchivePath(const FString& Path);
+
+private:
+	bool Write(const void* Data, int64 Size);
+	bool WriteCentralDirectory();
+
+	TUniquePtr<IFileHandle> File;
+	TArray<uint8> Buffer;
+	TArray<FEntry> Entries;
+	bool bSeekable = true;
+	bool bInEntry = false;
+	bool bError = false;
+	bool bFinalized = false;
+};
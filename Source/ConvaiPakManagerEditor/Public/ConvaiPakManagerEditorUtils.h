@@ -5,6 +5,10 @@
 #include "CoreMinimal.h"
 #include "Kismet/BlueprintFunctionLibrary.h"
 #include "Utility/CPM_Utils.h"
+#include "CPM_PakBudget.h"
+#include "CPM_DependencyReport.h"
+#include "CPM_DependencyGraph.h"
+#include "CPM_PackagingCache.h"
 #include "ConvaiPakManagerEditorUtils.generated.h"
 
 struct FCPM_PackageParam;
@@ -28,6 +32,24 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Convai|PakManagerEditor")
 	static void CPM_PackageProject(const FCPM_PackageParam& PackageParam, FOnUatTaskResultCallack OnPackagingCompleted);
 
+	/**
+	 * CPM_PackageProject for several platforms in one run, PackageParam.Platform is ignored. The cook is shared,
+	 * and with bMultiprocessCook in the packaging settings split over as many processes as their budgets allow.
+	 * OnPlatformCompleted is called once per platform with "<Platform>:<Result>", e.g. "Linux:Completed".
+	 * UAT reports one result for the whole run: every platform gets it, except that a platform whose output
+	 * is missing after a completed run reports "Failed".
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Convai|PakManagerEditor")
+	static void CPM_PackageProjectForPlatforms(const FCPM_PackageParam& PackageParam, const TSet<ECPM_Platform>& Platforms, FOnUatTaskResultCallack OnPlatformCompleted);
+
+	/** How many packages the last successful CPM_PackageProject for Platform recooked, false when there was none */
+	UFUNCTION(BlueprintCallable, Category = "Convai|PakManagerEditor")
+	static bool CPM_GetLastCookReport(const ECPM_Platform Platform, FCPM_CookReport& OutReport);
+
+	/** Checks a built pak against the size budget of its asset type and records it in the size history */
+	UFUNCTION(BlueprintCallable, Category = "Convai|PakManagerEditor")
+	static bool CPM_EvaluatePakBudget(const FString& PakFilePath, const ECPM_AssetType AssetType, const FString& AssetID, FCPM_PakBudgetReport& OutReport);
+
 	UFUNCTION(BlueprintCallable, Category = "Convai|PakManagerEditor")
 	static void CPM_ToggleLiveCoding(const bool Enable = false);
 
@@ -40,17 +62,50 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Convai|PakManager")
 	static bool CPM_TakeViewportScreenshot(const FString& FilePath);
 
+	/** With bIncremental, entries of files that did not change since the last zip are copied from it instead of recompressed */
+	UFUNCTION(BlueprintCallable, Category = "Convai|PakManager")
+	static bool CPM_CreateZip(const FString& ZipFilePath, const TArray<FString>& Files, const TArray<FString>& Directories, const bool bIncremental = false);
+
 	UFUNCTION(BlueprintCallable, Category = "Convai|PakManager")
-	static bool CPM_CreateZip(const FString& ZipFilePath, const TArray<FString>& Files, const TArray<FString>& Directories);
+	static void CPM_CreateZipAsync(const FString& ZipFilePath, const TArray<FString>& Files, const TArray<FString>& Directories, FOnUatTaskResultCallack OnZippingCompleted, const bool bIncremental = false);
 
+	/** Records the current state of the project files under Name, e.g. right after a publish. Fails while the file journal is not reconciled yet. */
 	UFUNCTION(BlueprintCallable, Category = "Convai|PakManager")
-	static void CPM_CreateZipAsync(const FString& ZipFilePath, const TArray<FString>& Files, const TArray<FString>& Directories, FOnUatTaskResultCallack OnZippingCompleted);
+	static bool CPM_MarkProjectSnapshot(const FString& Name);
+
+	/** Project files changed since the snapshot Name, paths relative to the project. Fails if there is no such snapshot or the file journal is not reconciled yet. */
+	UFUNCTION(BlueprintCallable, Category = "Convai|PakManager")
+	static bool CPM_GetProjectChangesSince(const FString& Name, TArray<FString>& ChangedFiles, TArray<FString>& RemovedFiles);
 
 	UFUNCTION(BlueprintCallable, Category = "Convai|PakManager")
 	static AActor* SpawnAndSnapActorToView(UClass* ActorClass);
 
+	/** bDeterministicOrder makes the output sets iterate in the same order on every run, for reports that get diffed */
+	UFUNCTION(BlueprintCallable, Category = "Convai|PakManager")
+	static bool GetPackageDependencies(const FName& PackageName, const TArray<FString>& FilterPaths, TSet<FName>& AllDependencies, TSet<FString>& ExternalObjectsPaths, TSet<FName>& ExcludedDependencies, const bool bDeterministicOrder = false);
+
+	/**
+	 * Closure of PackageName with the on-disk size, class and referencer chain of every package, and
+	 * totals by mount point, folder and class. Read from the asset registry, nothing is loaded.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Convai|PakManager")
+	static bool GetPackageDependencySizes(const FName& PackageName, const TArray<FString>& FilterPaths, FCPM_DependencySizeReport& OutReport);
+
+	/**
+	 * GetPackageDependencies for many roots over one walk of the asset registry. Closures are index
+	 * lists into a package table shared by all roots, with how many roots use each package.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Convai|PakManager")
+	static bool GetBatchPackageDependencies(const TArray<FName>& RootPackages, const TArray<FString>& FilterPaths, FCPM_BatchDependencyResult& OutResult);
+
+	/**
+	 * Pre-flight version of GetPackageDependencies' mount root check. The walk is breadth first and
+	 * stops after MaxViolations dependencies outside the root's mount point, or after TimeLimitSeconds,
+	 * and each violation comes with the chain of packages that pulled it in. 0 disables either limit,
+	 * so the full closure is only walked when the caller asks for it.
+	 */
 	UFUNCTION(BlueprintCallable, Category = "Convai|PakManager")
-	static bool GetPackageDependencies(const FName& PackageName, const TArray<FString>& FilterPaths, TSet<FName>& AllDependencies, TSet<FString>& ExternalObjectsPaths, TSet<FName>& ExcludedDependencies);
+	static bool CheckPackageMountRoot(const FName& PackageName, const TArray<FString>& FilterPaths, FCPM_MountRootCheckResult& OutResult, const int32 MaxViolations = 1, const float TimeLimitSeconds = 1.f);
 
 	static void RecursiveGetDependencies(const FName& PackageName, TSet<FName>& AllDependencies, TSet<FString>& ExternalObjectsPaths, TSet<FName>& ExcludedDependencies, const TFunction<bool(FName)>& ShouldExcludeFromDependenciesSearch);
 };